@@ -1,3 +1,7 @@
+import gzip
+import hashlib
+import os
+
 Import("env")
 env.Append(CXXFLAGS=["-Wno-volatile", "-fpermissive"])
 
@@ -5,4 +9,42 @@ board_config = env.BoardConfig()
 # array of VID:PID pairs
 board_config.update("build.hwids", [
   ["0x303A", "0x82E5"]
-])
\ No newline at end of file
+])
+
+# Web assets: uploadfs takes data/ as staged into .pio/data, every file that
+# compresses as <name>.gz, plus /assets.txt with a content-hash ETag per
+# asset (read by src/web_assets_manager.cpp). Unchanged files are not
+# rewritten, and gzip output carries no timestamp, so the image is stable.
+def write_if_changed(path, content):
+    if os.path.exists(path):
+        with open(path, "rb") as existing:
+            if existing.read() == content:
+                return
+    with open(path, "wb") as target:
+        target.write(content)
+
+def stage_web_assets(source_dir, staged_dir):
+    os.makedirs(staged_dir, exist_ok=True)
+    staged = {"assets.txt"}
+    manifest = []
+    for name in sorted(os.listdir(source_dir)):
+        source_path = os.path.join(source_dir, name)
+        if not os.path.isfile(source_path):
+            continue
+        with open(source_path, "rb") as source:
+            content = source.read()
+        etag = hashlib.sha256(content).hexdigest()[:16]
+        compressed = gzip.compress(content, 9, mtime=0)
+        gzipped = len(compressed) < len(content) * 0.9 # Images barely shrink, keep them as they are
+        stored_name = name + ".gz" if gzipped else name
+        write_if_changed(os.path.join(staged_dir, stored_name), compressed if gzipped else content)
+        staged.add(stored_name)
+        manifest.append("/%s %d %s\n" % (name, int(gzipped), etag))
+    write_if_changed(os.path.join(staged_dir, "assets.txt"), "".join(manifest).encode())
+    for name in os.listdir(staged_dir):
+        if name not in staged:
+            os.remove(os.path.join(staged_dir, name))
+
+staged_data_dir = os.path.join(env.subst("$PROJECT_DIR"), ".pio", "data")
+stage_web_assets(env.subst("$PROJECT_DATA_DIR"), staged_data_dir)
+env.Replace(PROJECT_DATA_DIR=staged_data_dir)
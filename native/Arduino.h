@@ -0,0 +1,73 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// Host stand-in for the few Arduino core types the portable modules use
+// (String and Serial). Only built by [env:native]; hardware access goes
+// through hal.h, never through this header.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+typedef uint8_t byte;
+
+class String {
+public:
+    String() {}
+    String(const char* str) : m_Value(str ? str : "") {}
+    String(const std::string& str) : m_Value(str) {}
+    explicit String(int value) : m_Value(std::to_string(value)) {}
+    explicit String(unsigned long value) : m_Value(std::to_string(value)) {}
+    String(double value, unsigned int decimal_places) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.*f", decimal_places, value);
+        m_Value = buffer;
+    }
+
+    const char* c_str() const { return m_Value.c_str(); }
+    unsigned int length() const { return m_Value.length(); }
+    long toInt() const { return atol(m_Value.c_str()); }
+    float toFloat() const { return static_cast<float>(atof(m_Value.c_str())); }
+    String substring(unsigned int from) const { return from < m_Value.size() ? String(m_Value.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const { return from < m_Value.size() ? String(m_Value.substr(from, to - from)) : String(); }
+
+    String& operator+=(const String& other) { m_Value += other.m_Value; return *this; }
+    String& operator+=(const char* other) { m_Value += other; return *this; }
+    bool operator==(const String& other) const { return m_Value == other.m_Value; }
+    bool operator==(const char* other) const { return m_Value == other; }
+    bool operator!=(const String& other) const { return m_Value != other.m_Value; }
+    bool operator!=(const char* other) const { return m_Value != other; }
+
+    friend String operator+(const String& lhs, const String& rhs) { return String(lhs.m_Value + rhs.m_Value); }
+    friend String operator+(const String& lhs, const char* rhs) { return String(lhs.m_Value + rhs); }
+    friend String operator+(const char* lhs, const String& rhs) { return String(lhs + rhs.m_Value); }
+
+private:
+    std::string m_Value;
+};
+
+class HostSerial {
+public:
+    void begin(unsigned long) {}
+    size_t print(const char* text) { return fputs(text, stdout) < 0 ? 0 : strlen(text); }
+    size_t print(const String& text) { return print(text.c_str()); }
+    size_t println(const char* text = "") { size_t n = print(text); putchar('\n'); return n + 1; }
+    size_t println(const String& text) { return println(text.c_str()); }
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, format);
+        int n = vprintf(format, args);
+        va_end(args);
+        return n < 0 ? 0 : n;
+    }
+};
+
+extern HostSerial Serial;
+
+#define F(text) (text)
+
+#endif // NATIVE_ARDUINO_H
@@ -0,0 +1,60 @@
+#ifndef NATIVE_FASTLED_H
+#define NATIVE_FASTLED_H
+
+// Host stand-in for the FastLED pixel type and the handful of colour helpers
+// led_manager.cpp uses. Frames are pushed through HalLedShow(), so there is no
+// controller object here.
+
+#include <stdint.h>
+#include "hal.h"
+
+typedef uint8_t fract8;
+
+struct CRGB {
+    uint8_t r = 0;
+    uint8_t g = 0;
+    uint8_t b = 0;
+
+    CRGB() {}
+    CRGB(uint32_t color) : r((color >> 16) & 0xFF), g((color >> 8) & 0xFF), b(color & 0xFF) {}
+    CRGB(uint8_t red, uint8_t green, uint8_t blue) : r(red), g(green), b(blue) {}
+};
+
+inline uint8_t lerp8by8(uint8_t a, uint8_t b, fract8 frac) {
+    return (b > a) ? a + (((b - a) * frac) >> 8) : a - (((a - b) * frac) >> 8);
+}
+
+inline CRGB blend(const CRGB& p1, const CRGB& p2, fract8 amount_of_p2) {
+    return CRGB(lerp8by8(p1.r, p2.r, amount_of_p2), lerp8by8(p1.g, p2.g, amount_of_p2), lerp8by8(p1.b, p2.b, amount_of_p2));
+}
+
+inline uint8_t beat8(uint16_t beats_per_minute, uint32_t timebase = 0) {
+    // Same fixed-point scheme as FastLED's beat16(): bpm in Q8.8, 280/65536 ~= 1/234.
+    uint32_t bpm88 = (beats_per_minute < 256) ? (uint32_t)beats_per_minute << 8 : beats_per_minute;
+    return (uint8_t)((((HalMillis() - timebase) * bpm88 * 280) >> 16) >> 8);
+}
+
+inline CRGB HueToRgb(uint8_t hue) {
+    uint8_t region = hue / 43;
+    uint8_t rem = (hue - region * 43) * 6;
+    uint8_t rising = rem;
+    uint8_t falling = 255 - rem;
+    switch (region) {
+        case 0: return CRGB(255, rising, 0);
+        case 1: return CRGB(falling, 255, 0);
+        case 2: return CRGB(0, 255, rising);
+        case 3: return CRGB(0, falling, 255);
+        case 4: return CRGB(rising, 0, 255);
+        default: return CRGB(255, 0, falling);
+    }
+}
+
+inline void fill_rainbow(CRGB* leds, int num_leds, uint8_t initial_hue, uint8_t delta_hue = 5) {
+    uint8_t hue = initial_hue;
+    for (int i = 0; i < num_leds; i++) {
+        leds[i] = HueToRgb(hue);
+        hue += delta_hue;
+    }
+}
+
+#endif // NATIVE_FASTLED_H
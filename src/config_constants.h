@@ -1,10 +1,29 @@
 #ifndef CONFIG_CONSTANTS_H
 #define CONFIG_CONSTANTS_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 // --- MQTT ---
 constexpr int MQTT_DEFAULT_PORT = 1883;
 constexpr int MQTT_CLIENT_BUFFER_SIZE = 10240;
 constexpr int MQTT_SOCKET_TIMEOUT_SECS = 60;
+constexpr uint32_t MQTT_CONNECT_TIMEOUT_MS = 3000; // TCP connect, then the same again for CONNACK
+constexpr unsigned long MQTT_LOOP_INTERVAL_MS = 50;
+constexpr unsigned long MQTT_BACKOFF_MIN_MS = 1000; // Doubles per failed connect
+constexpr unsigned long MQTT_BACKOFF_MAX_MS = 60000;
+constexpr int MQTT_QUEUE_SAMPLES = 8192; // ~68 h of offline samples at the default 30 s interval, 192 KB of PSRAM
+constexpr int MQTT_QUEUE_BATCH_SAMPLES = 20; // Samples per backlog message
+constexpr int MQTT_QUEUE_BATCH_MAX_BYTES = 4096;
+constexpr unsigned long MQTT_QUEUE_DRAIN_INTERVAL_MS = 250; // One backlog message per interval while connected
+constexpr int MQTT_ACK_MAX_BYTES = 192;
+
+// --- WiFi ---
+constexpr unsigned long WIFI_STATE_INTERVAL_MS = 250;
+constexpr unsigned long WIFI_CONNECT_TIMEOUT_MS = 15000; // One association attempt
+constexpr unsigned long WIFI_BACKOFF_MIN_MS = 1000; // Doubles per failed attempt
+constexpr unsigned long WIFI_BACKOFF_MAX_MS = 60000;
+constexpr unsigned long WIFI_AP_FALLBACK_MS = 120000; // Offline this long opens the setup AP alongside the retries
 
 // --- System Behaviour ---
 constexpr bool FORMAT_FS_ON_FAIL = true;
@@ -12,13 +31,60 @@ constexpr bool DEBUG_ENABLED = true;
 constexpr bool DEBUG_MQTT_ENABLED = true;
 constexpr bool DEBUG_DATA_ENABLED = false;
 constexpr unsigned long TELEMETRY_INTERVAL_MS = 30000;
+constexpr int TELEMETRY_PAYLOAD_MAX_BYTES = 256; // Largest telemetry JSON is ~170 bytes
+constexpr int TELEMETRY_SINK_COUNT = 4; // See TelemetrySink
+constexpr int TELEMETRY_SNAPSHOT_POOL_SIZE = 4; // Cached tick, plus ticks still held by slow sinks
+constexpr unsigned long TELEMETRY_CHANGE_CHECK_MS = 1000; // MQTT deltas between full payloads, alarm edges do not wait
+constexpr double TELEMETRY_DEADBAND_CELSIUS = 0.1;
+constexpr unsigned long TELEMETRY_DEADBAND_RPM_PERCENT = 2;
+constexpr unsigned long TELEMETRY_DEADBAND_RPM_MIN = 20; // Tach jitter at low speeds
+constexpr unsigned long WEB_EVENTS_INTERVAL_MS = 1000; // /events push period
+constexpr uint32_t WEB_ASSET_MAX_AGE_S = 86400; // Scripts and images; pages always revalidate
+constexpr size_t WEB_ASSET_CACHE_MAX_BYTES = 65536; // Larger assets stream from LittleFS
+constexpr size_t WEB_ASSET_CACHE_BUDGET_BYTES = 262144; // PSRAM for cached assets
 constexpr bool CLEAR_PREFERENCES_ON_EVERY_BOOT = false;
 
+// --- USB Binary Telemetry ---
+constexpr uint8_t USB_PROTOCOL_VERSION = 1;
+constexpr int USB_FRAME_MAX_BYTES = 64; // COBS-encoded frame plus delimiter
+constexpr int USB_COMMAND_MAX_BYTES = 32;
+
+// --- USB Sample Streaming ---
+constexpr uint16_t USB_STREAM_MAX_RATE_HZ = 100; // Rates must divide CONTROL_LOOP_INTERVAL_MS into whole periods
+constexpr int USB_STREAM_RING_SAMPLES = 256; // ~2.5 s of backlog at 100 Hz before samples drop
+constexpr int USB_STREAM_BATCH_SAMPLES = 8; // Samples per frame
+constexpr int USB_STREAM_FRAME_MAX_BYTES = 192;
+constexpr int USB_STREAM_FLUSH_MAX_BYTES = 1024; // Largest single write to the CDC port
+constexpr unsigned long USB_STREAM_FLUSH_INTERVAL_MS = 50;
+
+// --- History ---
+constexpr unsigned long HISTORY_RAW_INTERVAL_S = 1;
+constexpr int HISTORY_RAW_POINTS = 3600; // Last hour
+constexpr unsigned long HISTORY_DAY_INTERVAL_S = 60;
+constexpr int HISTORY_DAY_POINTS = 1440; // Last day of 1 min min/avg/max
+constexpr unsigned long HISTORY_WEEK_INTERVAL_S = 600;
+constexpr int HISTORY_WEEK_POINTS = 1008; // Last week of 10 min min/avg/max
+constexpr int HISTORY_ROW_MAX_BYTES = 256; // One formatted /history row, rollups are ~190 bytes
+
+// --- Flash Log ---
+constexpr unsigned long FLASH_LOG_INTERVAL_S = 10;
+constexpr int FLASH_LOG_BATCH_BYTES = 256; // One flash program page, written whole; power loss costs at most this batch
+constexpr long FLASH_LOG_SEGMENT_BYTES = 32768; // 128 batches, ~4 h of raw points
+constexpr int FLASH_LOG_RAW_SEGMENTS = 8; // Older raw segments are compacted
+constexpr unsigned long FLASH_LOG_COMPACT_INTERVAL_S = 300;
+constexpr long FLASH_LOG_MAX_BYTES = 512L * 1024; // Oldest compacted segments go beyond this
+constexpr int FLASH_LOG_EXPORT_MAX_ENTRY_BYTES = 64; // One varint-encoded export entry
+
 // --- Screen ---
 constexpr int SCREEN_WIDTH = 128; // OLED display width, in pixels
 constexpr int SCREEN_HEIGHT = 64; // OLED display height, in pixels
 constexpr uint8_t SCREEN_ADDR = 0x3C; // 0x3D for 128x64, 0x3C for 128x32
 
+// --- I2C Bus ---
+constexpr uint32_t I2C_BUS_CLOCK_HZ = 400000; // Fast-mode. 1000000 (Fast-mode Plus) if the OLED module tolerates it
+constexpr int I2C_DEVICE_COUNT = 2;
+constexpr int I2C_DISPLAY_CHUNK_BYTES = 64; // Display data per Wire transfer, fits the Wire TX buffer
+
 // --- Thermistor Control ---
 constexpr int T_REFERENCE_RESISTANCE = 10000;
 constexpr int T_NOMINAL_RESISTANCE = 10000;
@@ -26,13 +92,45 @@ constexpr int T_NOMINAL_TEMPERATURE = 25;
 constexpr int T_B_VALUE = 3950;
 constexpr int ESP32_ANALOG_RESOLUTION = 4095;
 constexpr double ADC_VOLTAGE = 3.3;
+constexpr double ADC_FULL_SCALE_VOLTAGE = 6.144; // ADS1115 at GAIN_TWOTHIRDS
+constexpr int ADC_MAX_COUNTS = 32767;
+
+// --- ADC Sampling ---
+constexpr unsigned long ADC_CONVERSION_MS = 8; // ADS1115 at 128 SPS
+constexpr unsigned long ADC_SAMPLE_INTERVAL_MS = 50; // One channel per interval, channels alternate
+constexpr unsigned long ADC_SAMPLE_STALE_MS = 2000; // Older samples read as N/A
+
+// --- Signal Filtering ---
+constexpr int FILTER_MAX_MEDIAN_WINDOW = 7;
+constexpr int FILTER_SPIKE_MAX_REJECTS = 3; // Consecutive outliers dropped before a jump is accepted as real
 
 // --- Fan Control ---
-constexpr int FAN_DEBOUNCE_MS = 0; // Milliseconds
+constexpr unsigned long CONTROL_LOOP_INTERVAL_MS = 100;
+constexpr int TACH_PULSES_PER_REV = 2;
+constexpr unsigned long TACH_WINDOW_MS = 1000; // RPM is averaged over every pulse in this window
+constexpr int TACH_WINDOW_SAMPLES = TACH_WINDOW_MS / CONTROL_LOOP_INTERVAL_MS + 1; // One snapshot per control tick, both ends of the window
+constexpr uint32_t TACH_GLITCH_FILTER_NS = 10000; // PCNT input filter, hardware max is ~12.7 us
+constexpr int TACH_PCNT_HIGH_LIMIT = 32767; // Counter overflow is folded into the total by the driver
 constexpr int FAN_STUCK_THRESHOLD_MD = 500; // Milliseconds
+constexpr int FAN_CURVE_MAX_POINTS = 16; // Extra points beyond this are dropped when a curve is compiled
+constexpr float FAN_RAMP_DEFAULT_UP_RATE = 20.0f; // Duty percent per second
+constexpr float FAN_RAMP_DEFAULT_DOWN_RATE = 5.0f; // Slower on the way down so fans wind down quietly
+constexpr float FAN_CURVE_DEFAULT_HYSTERESIS = 1.0f; // Celsius the temperature must fall before duty follows it down
 constexpr int PWM_RESOLUTION_BITS = 8;
 constexpr int PWM_SIGNAL_FREQUENCY_HZ = 20000; // Hz
 
+// --- PID Control ---
+// Defaults for fans switched to a PID mode without gains of their own. Temperature
+// gains are duty counts per degree, RPM gains duty counts per RPM.
+constexpr float PID_TEMP_DEFAULT_SETPOINT = 35.0f;
+constexpr float PID_TEMP_DEFAULT_KP = 20.0f;
+constexpr float PID_TEMP_DEFAULT_KI = 0.5f;
+constexpr float PID_TEMP_DEFAULT_KD = 0.0f;
+constexpr float PID_RPM_DEFAULT_SETPOINT = 1200.0f;
+constexpr float PID_RPM_DEFAULT_KP = 0.02f;
+constexpr float PID_RPM_DEFAULT_KI = 0.08f;
+constexpr float PID_RPM_DEFAULT_KD = 0.0f;
+
 // --- LED Control ---
 constexpr int ACTIVE_LED_STRIPS = 2;
 constexpr int MAX_LEDS_PER_STRIP = 64;
@@ -41,4 +139,17 @@ constexpr int MAX_LEDS_PER_STRIP = 64;
 constexpr int ACTIVE_THERMISTORS = 2;
 constexpr int ACTIVE_FANS = 4;
 
+// --- Thermistor Calibration ---
+// Optional per-channel Steinhart-Hart coefficients, 1/T = A + B ln(R) + C ln(R)^3 with T in kelvin.
+// A channel with A = 0 uses the B-parameter model from Thermistor Control.
+struct SteinhartHartCoefficients {
+    double a;
+    double b;
+    double c;
+};
+constexpr SteinhartHartCoefficients T_STEINHART_HART[ACTIVE_THERMISTORS] = {
+    {0, 0, 0},
+    {0, 0, 0}
+};
+
 #endif // CONFIG_CONSTANTS_H
\ No newline at end of file
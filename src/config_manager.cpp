@@ -0,0 +1,73 @@
+#include "config_manager.h"
+#include <math.h>
+#include <mutex>
+#include "control_manager.h"
+#include "sensor_manager.h"
+
+static ControllerConfig* BuildDefaultControllerConfig() {
+    ControllerConfig* config = new ControllerConfig();
+    for (auto& fan : config->fans) ApplyDefaultFanSettings(fan);
+    CompileFanCurves(*config);
+    return config;
+}
+
+// Valid from the start, so tasks running before the saved settings load see defaults
+static RcuCell<ControllerConfig> s_ControllerConfig(BuildDefaultControllerConfig());
+static std::mutex s_ConfigWriteMutex; // Setup and the web server both write
+
+static const char* ValidateFilterSettings(const FilterSettings& filter) {
+    if (filter.median_window < 1 || filter.median_window > FILTER_MAX_MEDIAN_WINDOW) return "median window out of range";
+    if (!(filter.ema_alpha > 0 && filter.ema_alpha <= 1)) return "EMA alpha out of range";
+    if (!(filter.spike_threshold >= 0)) return "negative spike threshold";
+    return nullptr;
+}
+
+static const char* ValidateControllerConfig(const ControllerConfig& config) {
+    for (int i = 0; i < ACTIVE_FANS; i++) {
+        const TemperatureSensorSettings& fan = config.fans[i];
+        if (fan.sensor_channel < 0 || fan.sensor_channel >= ACTIVE_THERMISTORS) return "unknown temperature sensor";
+        if (fan.control_mode == FanControlMode::Curve && fan.fan_speed_curve.empty()) return "empty fan curve";
+        for (const auto& point : fan.fan_speed_curve) {
+            if (!isfinite(point.temperature_threshold)) return "curve temperature not a number";
+            if (point.fan_duty_cycle < 0 || point.fan_duty_cycle > 255) return "curve duty out of range";
+        }
+        if (!(fan.ramp_up_rate > 0) || !(fan.ramp_down_rate > 0)) return "ramp rate not positive";
+        if (!(fan.hysteresis >= 0)) return "negative hysteresis";
+        if (fan.duty_override < -1 || fan.duty_override > 255) return "duty override out of range";
+        if (!isfinite(fan.pid.setpoint) || fan.pid.min_duty < 0 || fan.pid.max_duty > 255 ||
+            fan.pid.min_duty > fan.pid.max_duty) return "PID limits out of range";
+        if (const char* error = ValidateFilterSettings(fan.temperature_filter)) return error;
+        if (const char* error = ValidateFilterSettings(fan.rpm_filter)) return error;
+    }
+    for (int i = 0; i < ACTIVE_LED_STRIPS; i++) {
+        const LedSettings& led = config.leds[i];
+        if (led.mode > 5) return "unknown LED mode";
+        if (led.num_leds > MAX_LEDS_PER_STRIP) return "too many LEDs";
+    }
+    return nullptr;
+}
+
+ControllerConfigGuard ReadControllerConfig() {
+    return s_ControllerConfig.Read();
+}
+
+bool UpdateControllerConfig(const std::function<void(ControllerConfig&)>& edit) {
+    std::lock_guard<std::mutex> lock(s_ConfigWriteMutex);
+
+    std::unique_ptr<ControllerConfig> next(new ControllerConfig(s_ControllerConfig.Current()));
+    edit(*next);
+    if (const char* error = ValidateControllerConfig(*next)) {
+        Serial.printf("Config rejected: %s\n", error);
+        return false;
+    }
+    CompileFanCurves(*next);
+    s_ControllerConfig.Publish(std::move(next));
+
+    // The sampler keeps its own merged filter settings, rebuild them from the new version
+    ConfigureTemperatureFilters();
+    return true;
+}
+
+uint32_t ControllerConfigGeneration() {
+    return s_ControllerConfig.Generation();
+}
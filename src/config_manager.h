@@ -0,0 +1,25 @@
+#ifndef CONFIG_MANAGER_H
+#define CONFIG_MANAGER_H
+
+#include <functional>
+#include "controller_state.h"
+#include "rcu.h"
+
+// --- Controller Config ---
+// Fan and LED settings are read every cycle by the control, sampler, LED and
+// display tasks but change only when a user saves them. Readers pin the
+// current version for as long as they use it and never wait. An update edits
+// a private copy, validates it, compiles the fan curves and swaps it in; a
+// rejected edit leaves the running version untouched.
+
+using ControllerConfigGuard = RcuCell<ControllerConfig>::ReadGuard;
+
+ControllerConfigGuard ReadControllerConfig();
+
+// Returns false, and publishes nothing, if the edited copy fails validation
+bool UpdateControllerConfig(const std::function<void(ControllerConfig&)>& edit);
+
+// Bumped on every successful update
+uint32_t ControllerConfigGeneration();
+
+#endif // CONFIG_MANAGER_H
@@ -0,0 +1,341 @@
+#include "control_manager.h"
+#include "config_manager.h"
+#include "hal.h"
+#include "sensor_manager.h"
+#include "signal_filter.h"
+#include "pid_controller.h"
+#include <algorithm>
+#include <iterator>
+#include <math.h>
+
+static FanDutyTarget a_FanDutyTargets[ACTIVE_FANS]; // Ramp state, owned by the control loop
+static ControllerState s_ControlState; // Working copy of the last published tick
+static TachWindow a_TachWindows[ACTIVE_FANS];
+static FilterState a_RpmFilters[ACTIVE_FANS];
+static float a_CurveInputs[ACTIVE_FANS]; // Curve input after hysteresis, NaN until the first reading
+static PidState a_PidStates[ACTIVE_FANS];
+static unsigned long s_LastTickMs = 0;
+
+static void UpdateAlarmStates(const ControllerConfig& config, ControllerState& state);
+
+unsigned long ReadFanRpm(int fan_index) {
+    if (fan_index < 0 || fan_index >= ACTIVE_FANS) {
+        return 0;
+    }
+
+    const unsigned long now_ms = HalMillis();
+    const unsigned long now_us = HalMicros();
+    const uint32_t pulses = HalTachReadPulseCount(fan_index);
+    TachWindow& window = a_TachWindows[fan_index];
+
+    if (pulses != window.last_pulses) {
+        window.last_pulses = pulses;
+        window.last_pulse_ms = now_ms;
+    }
+
+    // Snapshot the counter once per control tick; extra calls within a tick reuse the last one
+    if (window.count == 0 ||
+        now_us - window.time_us[window.newest] >= CONTROL_LOOP_INTERVAL_MS * 1000UL / 2) {
+        window.newest = (window.newest + 1) % TACH_WINDOW_SAMPLES;
+        window.pulses[window.newest] = pulses;
+        window.time_us[window.newest] = now_us;
+        if (window.count < TACH_WINDOW_SAMPLES) window.count++;
+    }
+
+    if (now_ms - window.last_pulse_ms >= FAN_STUCK_THRESHOLD_MD) {
+        return 0; // Stuck or no reading
+    }
+
+    // Average over every pulse since the oldest snapshot still inside TACH_WINDOW_MS,
+    // or the previous one when a late tick left nothing else in it
+    int oldest = window.newest;
+    for (int age = 1; age < window.count; age++) {
+        const int slot = (window.newest - age + TACH_WINDOW_SAMPLES) % TACH_WINDOW_SAMPLES;
+        if (age > 1 && now_us - window.time_us[slot] > TACH_WINDOW_MS * 1000UL) break;
+        oldest = slot;
+    }
+    const uint32_t delta_pulses = pulses - window.pulses[oldest];
+    const unsigned long delta_us = now_us - window.time_us[oldest];
+    if (delta_pulses == 0 || delta_us == 0) {
+        return 0;
+    }
+    return static_cast<unsigned long>(delta_pulses * 60000000.0 / delta_us / TACH_PULSES_PER_REV);
+}
+
+int FindFanIndex(int fan_id) {
+    for (int i = 0; i < ACTIVE_FANS; i++) {
+        if (a_FanIds[i] == fan_id) return i;
+    }
+    return -1;
+}
+
+void CompileFanCurves(ControllerConfig& config) {
+    for (int i = 0; i < ACTIVE_FANS; i++) {
+        const auto& settings = config.fans[i];
+        CompiledFanCurve& curve = config.curves.fans[i];
+        curve = CompiledFanCurve();
+        curve.hysteresis = settings.hysteresis > 0 ? settings.hysteresis : 0;
+
+        FanSpeedPoint points[FAN_CURVE_MAX_POINTS];
+        int count = 0;
+        for (const auto& point : settings.fan_speed_curve) {
+            if (count == FAN_CURVE_MAX_POINTS) break;
+            points[count++] = point;
+        }
+        std::stable_sort(points, points + count, [](const FanSpeedPoint& a, const FanSpeedPoint& b) {
+            return a.temperature_threshold < b.temperature_threshold;
+        });
+
+        for (int p = 0; p < count; p++) {
+            // Of several points at one temperature the last one saved wins
+            if (curve.count > 0 && curve.temperatures[curve.count - 1] == points[p].temperature_threshold) {
+                curve.count--;
+            }
+            curve.temperatures[curve.count] = points[p].temperature_threshold;
+            curve.duties[curve.count] = points[p].fan_duty_cycle;
+            curve.count++;
+        }
+    }
+}
+
+float EvaluateFanCurve(const CompiledFanCurve& curve, float temperature) {
+    if (curve.count == 0) {
+        return 0; // No curve defined
+    }
+    if (temperature <= curve.temperatures[0]) {
+        return curve.duties[0];
+    }
+    if (temperature >= curve.temperatures[curve.count - 1]) {
+        return curve.duties[curve.count - 1];
+    }
+
+    // Binary search for the segment around the temperature, then interpolate
+    int low = 0;
+    int high = curve.count - 1;
+    while (high - low > 1) {
+        int mid = (low + high) / 2;
+        if (curve.temperatures[mid] <= temperature) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    const float fraction = (temperature - curve.temperatures[low]) / (curve.temperatures[high] - curve.temperatures[low]);
+    return curve.duties[low] + fraction * (curve.duties[high] - curve.duties[low]);
+}
+
+void EvaluateFanCurves(const CompiledFanCurves& curves, const float temperatures[ACTIVE_FANS], float duties[ACTIVE_FANS]) {
+    for (int i = 0; i < ACTIVE_FANS; i++) {
+        if (temperatures[i] <= 0) {
+            duties[i] = -1; // Sensor N/A
+            continue;
+        }
+
+        // Rising temperatures go straight through, falling ones only once they
+        // leave the hysteresis band, so the duty does not chase small dips
+        float& input = a_CurveInputs[i];
+        if (isnan(input) || temperatures[i] > input) {
+            input = temperatures[i];
+        } else if (temperatures[i] < input - curves.fans[i].hysteresis) {
+            input = temperatures[i] + curves.fans[i].hysteresis;
+        }
+        duties[i] = EvaluateFanCurve(curves.fans[i], input);
+    }
+}
+
+int CalculateFanSpeed(int fan_id, float temperature) {
+    const int index = FindFanIndex(fan_id);
+    if (index < 0) {
+        return 0; // Sensor not found
+    }
+    return static_cast<int>(lroundf(EvaluateFanCurve(ReadControllerConfig()->curves.fans[index], temperature)));
+}
+
+void ApplyDefaultFanSettings(TemperatureSensorSettings& settings) {
+    settings.sensor_channel = 0; // TEMP_1
+    settings.temperature_alarm_threshold = 999;
+    settings.rpm_alarm_threshold = -1;
+    settings.ramp_up_rate = FAN_RAMP_DEFAULT_UP_RATE;
+    settings.ramp_down_rate = FAN_RAMP_DEFAULT_DOWN_RATE;
+    settings.fan_speed_curve.clear();
+    settings.fan_speed_curve.push_back({30.0f, MapFanPercentToPwm(30)});
+    settings.fan_speed_curve.push_back({33.0f, MapFanPercentToPwm(40)});
+    settings.fan_speed_curve.push_back({36.0f, MapFanPercentToPwm(55)});
+    settings.fan_speed_curve.push_back({39.0f, MapFanPercentToPwm(75)});
+    settings.fan_speed_curve.push_back({41.0f, MapFanPercentToPwm(100)});
+    settings.hysteresis = FAN_CURVE_DEFAULT_HYSTERESIS;
+    settings.control_mode = FanControlMode::Curve;
+    settings.pid = PidSettings();
+    settings.temperature_filter = TemperatureSensorSettings().temperature_filter;
+    settings.rpm_filter = TemperatureSensorSettings().rpm_filter;
+}
+
+void ApplyInitialFanSpeeds() {
+    // Set initial fan speeds based on current temps
+    for (int channel = 0; channel < ACTIVE_THERMISTORS; channel++) {
+        s_ControlState.temperatures[channel] = ReadTemperature(channel);
+    }
+    const ControllerConfigGuard config = ReadControllerConfig();
+    std::fill(std::begin(a_CurveInputs), std::end(a_CurveInputs), NAN); // Hysteresis starts from the first reading
+
+    for (int i = 0; i < ACTIVE_FANS; i++) {
+        const double temp = s_ControlState.temperatures[config->fans[i].sensor_channel];
+        const int target_speed = (temp > 0) ? static_cast<int>(lroundf(EvaluateFanCurve(config->curves.fans[i], temp)))
+                                            : MapFanPercentToPwm(25);
+
+        a_FanDutyTargets[i].current_duty = target_speed;
+        a_FanDutyTargets[i].target_duty = target_speed;
+        s_ControlState.fans[i].current_duty = target_speed;
+        s_ControlState.fans[i].target_duty = target_speed;
+        HalPwmWrite(i, target_speed);
+    }
+
+    s_ControlState.timestamp_ms = HalMillis();
+    PublishControllerState(s_ControlState);
+}
+
+static void RunDutyRamp(int fan_index, FanDutyTarget& target, int new_target_duty, float up_rate, float down_rate, float dt_seconds) {
+    // Retarget every tick; only the slew rate limits how fast the output follows
+    const bool was_adjusting = target.is_adjusting;
+    target.target_duty = new_target_duty;
+
+    const float delta = target.target_duty - target.current_duty;
+    const float rate = (delta > 0) ? up_rate : down_rate; // Percent per second
+    const float max_step = MapFanPercentToPwm(100) * rate / 100.0f * dt_seconds;
+    if (fabsf(delta) <= max_step) {
+        target.current_duty = target.target_duty;
+    } else {
+        target.current_duty += (delta > 0) ? max_step : -max_step;
+    }
+    target.is_adjusting = target.current_duty != target.target_duty;
+
+    if (DEBUG_ENABLED && DEBUG_DATA_ENABLED) {
+        if (!was_adjusting && target.is_adjusting) {
+            Serial.printf("FAN_%d: Adjusting %.0f -> %d\n", a_FanIds[fan_index], target.current_duty, target.target_duty);
+        } else if (was_adjusting && !target.is_adjusting) {
+            Serial.printf("FAN_%d: Reached target %d\n", a_FanIds[fan_index], target.target_duty);
+        }
+    }
+    HalPwmWrite(fan_index, static_cast<int>(lroundf(target.current_duty)));
+}
+
+void RunFanControlTick() {
+    ControllerState& state = s_ControlState;
+    for (int channel = 0; channel < ACTIVE_THERMISTORS; channel++) {
+        state.temperatures[channel] = ReadTemperature(channel);
+    }
+
+    if (DEBUG_ENABLED && DEBUG_DATA_ENABLED) {
+        Serial.printf("T1: %.2f C; T2: %.2f C\n", state.temperatures[0], state.temperatures[1]);
+    }
+
+    // One settings version for the whole tick, however often it is saved meanwhile
+    const ControllerConfigGuard config = ReadControllerConfig();
+    float fan_temperatures[ACTIVE_FANS];
+    float curve_duties[ACTIVE_FANS];
+    for (int i = 0; i < ACTIVE_FANS; ++i) {
+        fan_temperatures[i] = state.temperatures[config->fans[i].sensor_channel];
+    }
+    EvaluateFanCurves(config->curves, fan_temperatures, curve_duties);
+
+    const unsigned long now_ms = HalMillis();
+    const float dt_seconds = s_LastTickMs ? (now_ms - s_LastTickMs) / 1000.0f : 0;
+    s_LastTickMs = now_ms;
+
+    for (int i = 0; i < ACTIVE_FANS; ++i) {
+        int fan_id = a_FanIds[i];
+        const auto& settings = config->fans[i];
+        const float rpm = ApplyFilter(settings.rpm_filter, a_RpmFilters[i], ReadFanRpm(i)); // Use index 'i' for ReadFanRpm
+        state.fans[i].rpm = static_cast<unsigned long>(rpm + 0.5f);
+
+        auto& target = a_FanDutyTargets[i];
+        if (settings.duty_override >= 0) {
+            a_PidStates[i].primed = false; // Clearing the override resumes the control mode bumplessly
+            RunDutyRamp(i, target, settings.duty_override, settings.ramp_up_rate, settings.ramp_down_rate, dt_seconds);
+        } else if (settings.control_mode == FanControlMode::Curve) {
+            a_PidStates[i].primed = false; // Switching to PID later starts from wherever the curve left the fan
+            if (curve_duties[i] < 0) {
+                if (DEBUG_ENABLED && DEBUG_DATA_ENABLED) Serial.printf("Temp sensor N/A for FAN_%d. Skipping.\n", fan_id);
+                continue; // Skip if temp sensor not working/connected, outputs stay as published
+            }
+            RunDutyRamp(i, target, static_cast<int>(lroundf(curve_duties[i])),
+                        settings.ramp_up_rate, settings.ramp_down_rate, dt_seconds);
+        } else {
+            const bool temperature_mode = settings.control_mode == FanControlMode::PidTemperature;
+            const float measurement = temperature_mode ? fan_temperatures[i] : rpm;
+            if (temperature_mode && measurement <= 0) {
+                a_PidStates[i].primed = false;
+                continue; // Sensor N/A, hold the output and restart bumplessly once it is back
+            }
+            // PID output already moves with the plant, so it bypasses the slew ramp
+            const float duty = UpdatePid(settings.pid, a_PidStates[i], measurement, temperature_mode,
+                                         target.current_duty, dt_seconds);
+            target.target_duty = static_cast<int>(lroundf(duty));
+            target.current_duty = target.target_duty;
+            target.is_adjusting = false;
+            HalPwmWrite(i, target.target_duty);
+        }
+
+        state.fans[i].target_duty = target.target_duty;
+        state.fans[i].current_duty = static_cast<int>(lroundf(target.current_duty));
+        state.fans[i].is_adjusting = target.is_adjusting;
+
+        if (DEBUG_ENABLED && DEBUG_DATA_ENABLED) {
+            Serial.printf("FAN_%d RPM: %lu (Target PWM: %d, Current PWM: %d)\n",
+                          fan_id, state.fans[i].rpm, target.target_duty, state.fans[i].current_duty);
+        }
+    }
+
+    UpdateAlarmStates(*config, state);
+    state.timestamp_ms = HalMillis();
+    PublishControllerState(state);
+}
+
+static void UpdateAlarmStates(const ControllerConfig& config, ControllerState& state) {
+    bool temp_alarm_active = false;
+    bool rpm_alarm_active = false;
+
+    for (int i = 0; i < ACTIVE_FANS; ++i) {
+        int fan_id = a_FanIds[i];
+        const auto& settings = config.fans[i];
+        const double temp = state.temperatures[settings.sensor_channel];
+        const unsigned long current_rpm = state.fans[i].rpm;
+
+        // Temperature Alarm
+        if (temp > 0 && settings.temperature_alarm_threshold > 0 && temp >= settings.temperature_alarm_threshold) {
+            temp_alarm_active = true;
+            if (!state.temp_alarm_firing) Serial.printf("ALARM: Temp high on %s (%.1fC)\n", TemperatureSensorName(settings.sensor_channel), temp);
+        }
+
+        // RPM Alarm (only if threshold is set, > 0)
+        if (settings.rpm_alarm_threshold >= 0 && current_rpm < (unsigned long)settings.rpm_alarm_threshold) {
+            rpm_alarm_active = true;
+            if (!state.rpm_alarm_firing) Serial.printf("ALARM: RPM low on FAN_%d (%lu RPM)\n", fan_id, current_rpm);
+        }
+    }
+
+    state.temp_alarm_firing = temp_alarm_active;
+    state.rpm_alarm_firing = rpm_alarm_active;
+}
+
+const char* FanControlModeName(FanControlMode mode) {
+    switch (mode) {
+        case FanControlMode::PidTemperature: return "pid_temp";
+        case FanControlMode::PidRpm: return "pid_rpm";
+        default: return "curve";
+    }
+}
+
+FanControlMode ParseFanControlMode(const char* name) {
+    if (name != nullptr && strcmp(name, "pid_temp") == 0) return FanControlMode::PidTemperature;
+    if (name != nullptr && strcmp(name, "pid_rpm") == 0) return FanControlMode::PidRpm;
+    return FanControlMode::Curve;
+}
+
+int MapFanPercentToPwm(int percentage) {
+    return MapValue(percentage, 0, 100, 0, 255);
+}
+
+int MapValue(int value, int from_low, int from_high, int to_low, int to_high) {
+    return (value - from_low) * (to_high - to_low) / (from_high - from_low) + to_low;
+}
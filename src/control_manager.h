@@ -0,0 +1,29 @@
+#ifndef CONTROL_MANAGER_H
+#define CONTROL_MANAGER_H
+
+#include "controller_state.h"
+
+unsigned long ReadFanRpm(int fan_index);
+int CalculateFanSpeed(int fan_id, float temperature);
+
+// Position of a fan id in a_FanIds and the per-fan config arrays, -1 if unknown
+int FindFanIndex(int fan_id);
+
+// Fan curves: compiled into each config version before it is published, then
+// evaluated for all fans at once by the control loop
+void CompileFanCurves(ControllerConfig& config);
+float EvaluateFanCurve(const CompiledFanCurve& curve, float temperature);
+void EvaluateFanCurves(const CompiledFanCurves& curves, const float temperatures[ACTIVE_FANS], float duties[ACTIVE_FANS]);
+
+void ApplyDefaultFanSettings(TemperatureSensorSettings& settings);
+void ApplyInitialFanSpeeds();
+void RunFanControlTick();
+
+// "curve", "pid_temp" or "pid_rpm" in the fan settings JSON
+const char* FanControlModeName(FanControlMode mode);
+FanControlMode ParseFanControlMode(const char* name);
+
+int MapFanPercentToPwm(int percentage);
+int MapValue(int value, int from_low, int from_high, int to_low, int to_high);
+
+#endif // CONTROL_MANAGER_H
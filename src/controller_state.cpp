@@ -0,0 +1,47 @@
+#include "controller_state.h"
+#include "seqlock.h"
+#include <atomic>
+
+
+// --- Controller State Definitions ---
+
+// System State
+ScreenView currentScreen = ScreenView::Overview;
+String espChipIdStr = "AA:BB:CC:DD:EE"; // Updated during init
+
+// Settings & Config
+Settings systemSettings;
+
+// LED Data
+CRGB a_LedBuffers[ACTIVE_LED_STRIPS][MAX_LEDS_PER_STRIP];
+
+// Thermistor/Fan IDs
+int a_ThermistorIds[ACTIVE_THERMISTORS] = {0, 1};
+int a_FanIds[ACTIVE_FANS] = {0, 1, 2, 3};
+
+// Live State
+static Seqlock<ControllerState> s_ControllerState;
+static std::atomic<uint32_t> s_AlarmEdges{0};
+static bool s_TempAlarmPublished = false; // Control loop only, like the writer side of the seqlock
+static bool s_RpmAlarmPublished = false;
+
+void PublishControllerState(const ControllerState& state) {
+    s_ControllerState.Write(state);
+    if (state.temp_alarm_firing != s_TempAlarmPublished || state.rpm_alarm_firing != s_RpmAlarmPublished) {
+        s_TempAlarmPublished = state.temp_alarm_firing;
+        s_RpmAlarmPublished = state.rpm_alarm_firing;
+        s_AlarmEdges++; // After the write, so a reader woken by it sees the new state
+    }
+}
+
+ControllerState ReadControllerState() {
+    return s_ControllerState.Read();
+}
+
+uint32_t ControllerStateVersion() {
+    return s_ControllerState.Version();
+}
+
+uint32_t ControllerAlarmEdges() {
+    return s_AlarmEdges;
+}
@@ -0,0 +1,38 @@
+#ifndef CONTROLLER_STATE_H
+#define CONTROLLER_STATE_H
+
+#include <map>
+#include <stdint.h>
+#include "FastLED.h"
+#include "types.h"
+#include "config_constants.h"
+
+// --- Controller State ---
+// Settings and live readings shared by the control, telemetry, LED and display
+// pipelines. Kept free of board headers so it also builds for [env:native].
+
+// System State
+extern ScreenView currentScreen;
+extern String espChipIdStr;
+
+// Settings & Config
+extern Settings systemSettings; // Fan and LED settings: see config_manager.h
+
+// LED Data
+extern CRGB a_LedBuffers[ACTIVE_LED_STRIPS][MAX_LEDS_PER_STRIP];
+
+// Thermistor/Fan IDs
+extern int a_ThermistorIds[ACTIVE_THERMISTORS];
+extern int a_FanIds[ACTIVE_FANS];
+
+// Live State
+// Written only by the fan control loop, read from any task or core without
+// locking. Readers always get a consistent copy of one control tick.
+void PublishControllerState(const ControllerState& state);
+ControllerState ReadControllerState();
+uint32_t ControllerStateVersion();
+// Bumped after a published state turns a temperature or RPM alarm on or off,
+// so a sink can react at once instead of on its next poll
+uint32_t ControllerAlarmEdges();
+
+#endif // CONTROLLER_STATE_H
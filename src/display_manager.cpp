@@ -0,0 +1,71 @@
+#include "display_manager.h"
+#include "config_manager.h"
+#include "hal.h"
+
+void RenderScreen(ScreenView view, const char* ip_address) {
+    const ControllerState state = ReadControllerState();
+    HalDisplayClear();
+    HalDisplaySetCursor(0, 0);
+
+    switch (view) {
+        case ScreenView::Overview:
+            HalDisplayPrintf("   ### OVERVIEW ###\n\n");
+            HalDisplayPrintf("Mode: %s\n", systemSettings.offline_mode ? "Offline" : "Connected");
+            HalDisplayPrintf("IP: %s\n", ip_address);
+            HalDisplayPrintf("Units: %s\n", systemSettings.units.c_str());
+            HalDisplayPrintf("Temp Alarm: %s\n", state.temp_alarm_firing ? "Yes" : "No");
+            HalDisplayPrintf("RPM Alarm: %s\n", state.rpm_alarm_firing ? "Yes" : "No");
+            HalDisplaySetCursor(50, 56);
+            HalDisplayPrintf("o...");
+            break;
+
+        case ScreenView::Temperatures:
+            {
+                double t1 = state.temperatures[0];
+                double t2 = state.temperatures[1];
+
+                if (systemSettings.units == "F") {
+                    if (t1 > -90.0) t1 = (t1 * 1.8) + 32;
+                    if (t2 > -90.0) t2 = (t2 * 1.8) + 32;
+                }
+
+                HalDisplayPrintf(" ### TEMPERATURE ###\n\n");
+                HalDisplayPrintf("TEMP1: %s\n", ((t1 < 0 && systemSettings.units == "C") || t1 < 32 && systemSettings.units == "F") ? "N/A" : (String(t1, 1) + systemSettings.units).c_str());
+                HalDisplayPrintf("TEMP2: %s\n", ((t2 < 0 && systemSettings.units == "C") || t2 < 32 && systemSettings.units == "F") ? "N/A" : (String(t2, 1) + systemSettings.units).c_str());
+                HalDisplaySetCursor(50, 56);
+                HalDisplayPrintf(".o..");
+            }
+            break;
+
+        case ScreenView::Fans:
+            HalDisplayPrintf("  ### FAN SPEED ### \n\n");
+            for (int i = 0; i < ACTIVE_FANS; i++) {
+                HalDisplayPrintf("FAN %d: %4lu RPM\n", a_FanIds[i], state.fans[i].rpm);
+            }
+            HalDisplaySetCursor(50, 56);
+            HalDisplayPrintf("..o.");
+            break;
+
+        case ScreenView::Rgb:
+            HalDisplayPrintf("  ### RGB MODE ### \n\n");
+            for (int key = 0; key < ACTIVE_LED_STRIPS; key++) {
+                const LedSettings value = ReadControllerConfig()->leds[key];
+                std::string fkey = "LED_" + std::to_string(key);
+                std::string led_mode = "Unknown";
+                switch (value.mode) {
+                    case 0: led_mode = "Off"; break;
+                    case 1: led_mode = "Static"; break;
+                    case 2: led_mode = "Grad/Wave"; break;
+                    case 3: led_mode = "Grad/Move"; break;
+                    case 4: led_mode = "Rainbow"; break;
+                    case 5: led_mode = "Passthrough"; break;
+                }
+                HalDisplayPrintf("%s: %s\n", fkey.c_str(), led_mode.c_str());
+            }
+            HalDisplaySetCursor(50, 56);
+            HalDisplayPrintf("...o");
+            break;
+    }
+
+    HalDisplayFlush();
+}
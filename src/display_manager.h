@@ -0,0 +1,8 @@
+#ifndef DISPLAY_MANAGER_H
+#define DISPLAY_MANAGER_H
+
+#include "controller_state.h"
+
+void RenderScreen(ScreenView view, const char* ip_address);
+
+#endif // DISPLAY_MANAGER_H
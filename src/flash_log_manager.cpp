@@ -0,0 +1,511 @@
+#include "flash_log_manager.h"
+#include <dirent.h>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "hal.h"
+#include "usb_protocol.h"
+
+constexpr uint16_t FLASH_LOG_MAGIC = 0x4C57; // "WL"
+constexpr size_t FLASH_LOG_HEADER_BYTES = 13;
+constexpr size_t FLASH_LOG_POINT_BYTES = 4 + 2 * ACTIVE_THERMISTORS + 3 * ACTIVE_FANS;
+constexpr size_t FLASH_LOG_BATCH_POINTS = sizeof(FlashLogBatch::points) / sizeof(HistoryPoint);
+static_assert(FLASH_LOG_HEADER_BYTES + FLASH_LOG_BATCH_POINTS * FLASH_LOG_POINT_BYTES <= FLASH_LOG_BATCH_BYTES,
+              "points must fit one batch");
+constexpr char RAW_SEGMENT = 'r';
+constexpr char COMPACTED_SEGMENT = 'c';
+
+static std::mutex s_FlashLogMutex; // Logger task writes and compacts, the web server exports
+static char s_Directory[48];
+static bool s_FlashLogStarted = false;
+static uint16_t s_Boot = 0;
+static uint32_t s_RawSegment = 0;
+static long s_RawSegmentBytes = 0;
+static FlashLogBatch s_PendingBatch;
+static bool s_HasSample = false;
+static uint32_t s_LastSampleSecond = 0;
+static uint32_t s_BatchesWritten = 0;
+static uint32_t s_CorruptBatches = 0;
+
+// --- Batch encoding ---
+
+static uint8_t* PutU16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+    return out + 2;
+}
+
+static uint8_t* PutU32(uint8_t* out, uint32_t value) {
+    return PutU16(PutU16(out, value & 0xFFFF), value >> 16);
+}
+
+static uint16_t GetU16(const uint8_t* in) {
+    return static_cast<uint16_t>(in[0] | (in[1] << 8));
+}
+
+static uint32_t GetU32(const uint8_t* in) {
+    return GetU16(in) | (static_cast<uint32_t>(GetU16(in + 2)) << 16);
+}
+
+static uint16_t BatchCrc(const uint8_t* data, size_t points) {
+    // Header up to the CRC, then the points; both runs folded into one CRC
+    uint8_t covered[FLASH_LOG_BATCH_BYTES];
+    memcpy(covered, data, FLASH_LOG_HEADER_BYTES - 2);
+    memcpy(covered + FLASH_LOG_HEADER_BYTES - 2, data + FLASH_LOG_HEADER_BYTES, points * FLASH_LOG_POINT_BYTES);
+    return Crc16Ccitt(covered, FLASH_LOG_HEADER_BYTES - 2 + points * FLASH_LOG_POINT_BYTES);
+}
+
+static void EncodeBatch(const FlashLogBatch& batch, uint8_t* out) {
+    memset(out, 0xFF, FLASH_LOG_BATCH_BYTES);
+    uint8_t* p = PutU16(out, FLASH_LOG_MAGIC);
+    p = PutU16(p, batch.boot);
+    p = PutU32(p, batch.epoch_offset);
+    p = PutU16(p, batch.interval_s);
+    *p++ = batch.count;
+    p += 2; // CRC, filled in last
+    for (int i = 0; i < batch.count; i++) {
+        const HistoryPoint& point = batch.points[i];
+        p = PutU32(p, point.uptime_s);
+        for (int t = 0; t < ACTIVE_THERMISTORS; t++) p = PutU16(p, static_cast<uint16_t>(point.values.centi_celsius[t]));
+        for (int f = 0; f < ACTIVE_FANS; f++) p = PutU16(p, point.values.rpm[f]);
+        for (int f = 0; f < ACTIVE_FANS; f++) *p++ = point.values.duty[f];
+    }
+    PutU16(out + FLASH_LOG_HEADER_BYTES - 2, BatchCrc(out, batch.count));
+}
+
+static bool DecodeBatch(const uint8_t* in, FlashLogBatch& batch) {
+    if (GetU16(in) != FLASH_LOG_MAGIC || in[10] > FLASH_LOG_BATCH_POINTS) {
+        return false;
+    }
+    batch.count = in[10];
+    if (GetU16(in + FLASH_LOG_HEADER_BYTES - 2) != BatchCrc(in, batch.count)) {
+        return false;
+    }
+    batch.boot = GetU16(in + 2);
+    batch.epoch_offset = GetU32(in + 4);
+    batch.interval_s = GetU16(in + 8);
+    const uint8_t* p = in + FLASH_LOG_HEADER_BYTES;
+    for (int i = 0; i < batch.count; i++) {
+        HistoryPoint& point = batch.points[i];
+        point.uptime_s = GetU32(p);
+        p += 4;
+        for (int t = 0; t < ACTIVE_THERMISTORS; t++, p += 2) point.values.centi_celsius[t] = static_cast<int16_t>(GetU16(p));
+        for (int f = 0; f < ACTIVE_FANS; f++, p += 2) point.values.rpm[f] = GetU16(p);
+        for (int f = 0; f < ACTIVE_FANS; f++) point.values.duty[f] = *p++;
+    }
+    return true;
+}
+
+// --- Segment files ---
+
+static void SegmentPath(char kind, uint32_t number, char* path, size_t size) {
+    snprintf(path, size, "%s/%c%05u.bin", s_Directory, kind, static_cast<unsigned>(number));
+}
+
+static long SegmentBytes(char kind, uint32_t number) {
+    char path[64];
+    SegmentPath(kind, number, path, sizeof(path));
+    struct stat info;
+    return stat(path, &info) == 0 ? static_cast<long>(info.st_size) : -1;
+}
+
+struct SegmentScan {
+    uint32_t count = 0;
+    uint32_t first = 0;
+    uint32_t last = 0;
+    uint32_t bytes = 0;
+};
+
+// after = -1 finds the oldest; next is the smallest number above after, if any
+static SegmentScan ScanSegments(char kind, long after = -1, bool* found_next = nullptr, uint32_t* next = nullptr) {
+    SegmentScan scan;
+    if (found_next) *found_next = false;
+    DIR* dir = opendir(s_Directory);
+    if (!dir) {
+        return scan;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        unsigned number = 0;
+        char suffix[8] = {};
+        if (entry->d_name[0] != kind || sscanf(entry->d_name + 1, "%5u.%3s", &number, suffix) != 2 ||
+            strcmp(suffix, "bin") != 0) continue;
+        if (scan.count == 0 || number < scan.first) scan.first = number;
+        if (scan.count == 0 || number > scan.last) scan.last = number;
+        scan.count++;
+        const long bytes = SegmentBytes(kind, number);
+        if (bytes > 0) scan.bytes += bytes;
+        if (found_next && static_cast<long>(number) > after && (!*found_next || number < *next)) {
+            *found_next = true;
+            *next = number;
+        }
+    }
+    closedir(dir);
+    return scan;
+}
+
+static bool AppendBatch(char kind, uint32_t number, const FlashLogBatch& batch) {
+    uint8_t encoded[FLASH_LOG_BATCH_BYTES];
+    EncodeBatch(batch, encoded);
+    char path[64];
+    SegmentPath(kind, number, path, sizeof(path));
+    FILE* file = fopen(path, "ab");
+    if (!file) {
+        return false;
+    }
+    const bool ok = fwrite(encoded, 1, sizeof(encoded), file) == sizeof(encoded);
+    fclose(file); // LittleFS commits on close
+    if (ok) s_BatchesWritten++;
+    return ok;
+}
+
+static bool ReadBatch(char kind, uint32_t number, long offset, uint8_t* out) {
+    char path[64];
+    SegmentPath(kind, number, path, sizeof(path));
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    const bool ok = fseek(file, offset, SEEK_SET) == 0 && fread(out, 1, FLASH_LOG_BATCH_BYTES, file) == FLASH_LOG_BATCH_BYTES;
+    fclose(file);
+    return ok;
+}
+
+// --- Compaction ---
+
+struct CompactionBucket {
+    uint32_t start_s = 0;
+    uint32_t count = 0;
+    int32_t temperature_sum[ACTIVE_THERMISTORS] = {};
+    uint32_t temperature_count[ACTIVE_THERMISTORS] = {};
+    uint32_t rpm_sum[ACTIVE_FANS] = {};
+    uint32_t duty_sum[ACTIVE_FANS] = {};
+};
+
+static HistoryPoint AverageBucket(const CompactionBucket& bucket) {
+    HistoryPoint point;
+    point.uptime_s = bucket.start_s;
+    for (int i = 0; i < ACTIVE_THERMISTORS; i++) {
+        const uint32_t count = bucket.temperature_count[i];
+        point.values.centi_celsius[i] = count ? static_cast<int16_t>(bucket.temperature_sum[i] / static_cast<int32_t>(count)) : INT16_MIN;
+    }
+    for (int i = 0; i < ACTIVE_FANS; i++) {
+        point.values.rpm[i] = static_cast<uint16_t>(bucket.rpm_sum[i] / bucket.count);
+        point.values.duty[i] = static_cast<uint8_t>(bucket.duty_sum[i] / bucket.count);
+    }
+    return point;
+}
+
+static void AppendCompactedBatch(FlashLogBatch& batch) {
+    if (batch.count == 0) {
+        return;
+    }
+    SegmentScan scan = ScanSegments(COMPACTED_SEGMENT);
+    uint32_t number = scan.count ? scan.last : 0;
+    const long bytes = SegmentBytes(COMPACTED_SEGMENT, number);
+    if (bytes >= FLASH_LOG_SEGMENT_BYTES || (bytes > 0 && bytes % FLASH_LOG_BATCH_BYTES != 0)) number++;
+    if (!AppendBatch(COMPACTED_SEGMENT, number, batch)) {
+        Serial.println("Flash log: Compacted write failed.");
+    }
+    batch.count = 0;
+}
+
+// Averages a raw segment down to FLASH_LOG_COMPACT_INTERVAL_S points, then deletes it
+static void CompactSegment(uint32_t number) {
+    FlashLogBatch out;
+    out.interval_s = FLASH_LOG_COMPACT_INTERVAL_S;
+    CompactionBucket bucket;
+    bool has_context = false;
+
+    auto emit_bucket = [&]() {
+        if (bucket.count == 0) return;
+        out.points[out.count++] = AverageBucket(bucket);
+        if (out.count == FLASH_LOG_BATCH_POINTS) AppendCompactedBatch(out);
+        bucket = CompactionBucket();
+    };
+
+    uint8_t encoded[FLASH_LOG_BATCH_BYTES];
+    FlashLogBatch in;
+    for (long offset = 0; ReadBatch(RAW_SEGMENT, number, offset, encoded); offset += FLASH_LOG_BATCH_BYTES) {
+        if (!DecodeBatch(encoded, in)) {
+            s_CorruptBatches++;
+            continue;
+        }
+        if (has_context && in.boot != out.boot) {
+            emit_bucket();
+            AppendCompactedBatch(out); // One boot per batch
+        }
+        has_context = true;
+        out.boot = in.boot;
+        if (in.epoch_offset != 0) out.epoch_offset = in.epoch_offset; // Constant per boot once the clock is set
+        for (int i = 0; i < in.count; i++) {
+            const HistoryPoint& point = in.points[i];
+            const uint32_t start_s = point.uptime_s - point.uptime_s % FLASH_LOG_COMPACT_INTERVAL_S;
+            if (bucket.count > 0 && start_s != bucket.start_s) emit_bucket();
+            bucket.start_s = start_s;
+            for (int t = 0; t < ACTIVE_THERMISTORS; t++) {
+                if (point.values.centi_celsius[t] == INT16_MIN) continue;
+                bucket.temperature_sum[t] += point.values.centi_celsius[t];
+                bucket.temperature_count[t]++;
+            }
+            for (int f = 0; f < ACTIVE_FANS; f++) {
+                bucket.rpm_sum[f] += point.values.rpm[f];
+                bucket.duty_sum[f] += point.values.duty[f];
+            }
+            bucket.count++;
+        }
+    }
+    emit_bucket();
+    AppendCompactedBatch(out);
+
+    char path[64];
+    SegmentPath(RAW_SEGMENT, number, path, sizeof(path));
+    remove(path);
+}
+
+static void RollOverRawSegment() {
+    s_RawSegment++;
+    s_RawSegmentBytes = 0;
+
+    SegmentScan raw = ScanSegments(RAW_SEGMENT);
+    while (raw.count > FLASH_LOG_RAW_SEGMENTS) {
+        CompactSegment(raw.first);
+        raw = ScanSegments(RAW_SEGMENT);
+    }
+    SegmentScan compacted = ScanSegments(COMPACTED_SEGMENT);
+    while (compacted.count > 1 && raw.bytes + compacted.bytes > FLASH_LOG_MAX_BYTES) {
+        char path[64];
+        SegmentPath(COMPACTED_SEGMENT, compacted.first, path, sizeof(path));
+        remove(path);
+        compacted = ScanSegments(COMPACTED_SEGMENT);
+    }
+}
+
+// --- Logging ---
+
+static void StampPendingBatch(FlashLogBatch& batch) {
+    const uint32_t epoch_s = HalEpochSeconds();
+    batch.boot = s_Boot;
+    batch.interval_s = FLASH_LOG_INTERVAL_S;
+    batch.epoch_offset = epoch_s ? epoch_s - HalMillis() / 1000 : 0;
+}
+
+static void WritePendingBatch() {
+    if (s_PendingBatch.count == 0) {
+        return;
+    }
+    StampPendingBatch(s_PendingBatch);
+    if (!AppendBatch(RAW_SEGMENT, s_RawSegment, s_PendingBatch)) {
+        Serial.println("Flash log: Write failed, batch lost.");
+    }
+    s_PendingBatch.count = 0;
+    s_RawSegmentBytes += FLASH_LOG_BATCH_BYTES;
+    if (s_RawSegmentBytes >= FLASH_LOG_SEGMENT_BYTES) {
+        RollOverRawSegment();
+    }
+}
+
+bool StartFlashLog(const char* directory) {
+    std::lock_guard<std::mutex> lock(s_FlashLogMutex);
+    snprintf(s_Directory, sizeof(s_Directory), "%s", directory);
+    mkdir(s_Directory, 0755);
+    DIR* dir = opendir(s_Directory);
+    if (!dir) {
+        Serial.printf("Flash log: Cannot open %s, logging disabled.\n", s_Directory);
+        return false;
+    }
+    closedir(dir);
+
+    // Continue after the newest batch on flash, with the next boot number
+    SegmentScan raw = ScanSegments(RAW_SEGMENT);
+    SegmentScan compacted = ScanSegments(COMPACTED_SEGMENT);
+    const char newest_kind = raw.count ? RAW_SEGMENT : COMPACTED_SEGMENT;
+    const uint32_t newest = raw.count ? raw.last : compacted.last;
+    const long newest_bytes = (raw.count || compacted.count) ? SegmentBytes(newest_kind, newest) : -1;
+    uint8_t encoded[FLASH_LOG_BATCH_BYTES];
+    FlashLogBatch last;
+    for (long offset = newest_bytes - newest_bytes % FLASH_LOG_BATCH_BYTES - FLASH_LOG_BATCH_BYTES; offset >= 0;
+         offset -= FLASH_LOG_BATCH_BYTES) {
+        if (ReadBatch(newest_kind, newest, offset, encoded) && DecodeBatch(encoded, last)) {
+            s_Boot = last.boot + 1;
+            break;
+        }
+    }
+
+    s_RawSegment = raw.count ? raw.last : 0;
+    s_RawSegmentBytes = raw.count ? SegmentBytes(RAW_SEGMENT, s_RawSegment) : 0;
+    if (s_RawSegmentBytes >= FLASH_LOG_SEGMENT_BYTES || s_RawSegmentBytes % FLASH_LOG_BATCH_BYTES != 0) {
+        s_RawSegment++; // Full, or cut short by power loss: keep batches aligned in a fresh one
+        s_RawSegmentBytes = 0;
+    }
+    s_FlashLogStarted = true;
+    Serial.printf("Flash log: Boot %u, %u raw and %u compacted segments, %u bytes.\n", s_Boot,
+                  (unsigned)raw.count, (unsigned)compacted.count, (unsigned)(raw.bytes + compacted.bytes));
+    return true;
+}
+
+bool FlashLogAvailable() {
+    return s_FlashLogStarted;
+}
+
+void RecordFlashLogSample(const ControllerState& state) {
+    if (!s_FlashLogStarted) {
+        return;
+    }
+    const uint32_t uptime_s = static_cast<uint32_t>(state.timestamp_ms / 1000);
+    if (s_HasSample && uptime_s - s_LastSampleSecond < FLASH_LOG_INTERVAL_S) {
+        return;
+    }
+    s_HasSample = true;
+    s_LastSampleSecond = uptime_s;
+
+    std::lock_guard<std::mutex> lock(s_FlashLogMutex);
+    s_PendingBatch.points[s_PendingBatch.count++] = MakeHistoryPoint(state);
+    if (s_PendingBatch.count == FLASH_LOG_BATCH_POINTS) {
+        WritePendingBatch();
+    }
+}
+
+void FlushFlashLog() {
+    if (!s_FlashLogStarted) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(s_FlashLogMutex);
+    WritePendingBatch();
+}
+
+FlashLogStats GetFlashLogStats() {
+    FlashLogStats stats;
+    if (!s_FlashLogStarted) {
+        return stats;
+    }
+    std::lock_guard<std::mutex> lock(s_FlashLogMutex);
+    const SegmentScan raw = ScanSegments(RAW_SEGMENT);
+    const SegmentScan compacted = ScanSegments(COMPACTED_SEGMENT);
+    stats.boot = s_Boot;
+    stats.raw_segments = raw.count;
+    stats.compacted_segments = compacted.count;
+    stats.bytes = raw.bytes + compacted.bytes;
+    stats.batches_written = s_BatchesWritten;
+    stats.corrupt_batches = s_CorruptBatches;
+    return stats;
+}
+
+// --- Export ---
+
+FlashLogExportCursor OpenFlashLogExport() {
+    return FlashLogExportCursor();
+}
+
+static uint8_t* PutVarint(uint8_t* out, uint32_t value) {
+    while (value >= 0x80) {
+        *out++ = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<uint8_t>(value);
+    return out;
+}
+
+static uint8_t* PutZigzag(uint8_t* out, int32_t value) {
+    return PutVarint(out, (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31));
+}
+
+// Loads the next valid batch in export order; false once the RAM batch has been handed out
+static bool LoadNextExportBatch(FlashLogExportCursor& cursor) {
+    std::lock_guard<std::mutex> lock(s_FlashLogMutex);
+    uint8_t encoded[FLASH_LOG_BATCH_BYTES];
+    while (cursor.stage == FlashLogExportCursor::Stage::Compacted || cursor.stage == FlashLogExportCursor::Stage::Raw) {
+        const char kind = cursor.stage == FlashLogExportCursor::Stage::Compacted ? COMPACTED_SEGMENT : RAW_SEGMENT;
+        if (cursor.has_segment && ReadBatch(kind, cursor.segment, cursor.offset, encoded)) {
+            cursor.offset += FLASH_LOG_BATCH_BYTES;
+            if (DecodeBatch(encoded, cursor.batch)) {
+                cursor.next_point = 0;
+                return true;
+            }
+            s_CorruptBatches++;
+            continue;
+        }
+        // End of this segment (or it was compacted away meanwhile): on to the next one
+        bool found = false;
+        uint32_t next = 0;
+        ScanSegments(kind, cursor.has_segment ? static_cast<long>(cursor.segment) : -1, &found, &next);
+        if (found) {
+            cursor.has_segment = true;
+            cursor.segment = next;
+            cursor.offset = 0;
+            continue;
+        }
+        cursor.has_segment = false;
+        cursor.stage = cursor.stage == FlashLogExportCursor::Stage::Compacted ? FlashLogExportCursor::Stage::Raw
+                                                                              : FlashLogExportCursor::Stage::Pending;
+    }
+    if (cursor.stage == FlashLogExportCursor::Stage::Pending) {
+        cursor.stage = FlashLogExportCursor::Stage::Done;
+        cursor.batch = s_PendingBatch;
+        StampPendingBatch(cursor.batch);
+        cursor.next_point = 0;
+        return cursor.batch.count > 0;
+    }
+    return false;
+}
+
+// Fills cursor.pending with the next export entry; false once done
+static bool FormatNextExportEntry(FlashLogExportCursor& cursor) {
+    cursor.pending_offset = 0;
+    cursor.pending_length = 0;
+    uint8_t* out = cursor.pending;
+
+    if (cursor.stage == FlashLogExportCursor::Stage::Magic) {
+        memcpy(out, "WLX1", 4);
+        out[4] = ACTIVE_THERMISTORS;
+        out[5] = ACTIVE_FANS;
+        cursor.pending_length = 6;
+        cursor.stage = FlashLogExportCursor::Stage::Compacted;
+        return true;
+    }
+    while (cursor.next_point >= cursor.batch.count) {
+        if (!LoadNextExportBatch(cursor)) return false;
+    }
+
+    const FlashLogBatch& batch = cursor.batch;
+    if (!cursor.has_context || batch.boot != cursor.boot || batch.epoch_offset != cursor.epoch_offset ||
+        batch.interval_s != cursor.interval_s) {
+        cursor.has_context = true;
+        cursor.boot = batch.boot;
+        cursor.epoch_offset = batch.epoch_offset;
+        cursor.interval_s = batch.interval_s;
+        cursor.previous = HistoryPoint();
+        *out++ = 0x01;
+        out = PutVarint(out, batch.boot);
+        out = PutVarint(out, batch.epoch_offset);
+        out = PutVarint(out, batch.interval_s);
+        cursor.pending_length = out - cursor.pending;
+        return true;
+    }
+
+    const HistoryPoint& point = batch.points[cursor.next_point++];
+    const HistoryValues& previous = cursor.previous.values;
+    *out++ = 0x02;
+    out = PutZigzag(out, static_cast<int32_t>(point.uptime_s - cursor.previous.uptime_s));
+    for (int t = 0; t < ACTIVE_THERMISTORS; t++) out = PutZigzag(out, point.values.centi_celsius[t] - previous.centi_celsius[t]);
+    for (int f = 0; f < ACTIVE_FANS; f++) out = PutZigzag(out, point.values.rpm[f] - previous.rpm[f]);
+    for (int f = 0; f < ACTIVE_FANS; f++) out = PutZigzag(out, point.values.duty[f] - previous.duty[f]);
+    cursor.previous = point;
+    cursor.pending_length = out - cursor.pending;
+    return true;
+}
+
+size_t WriteFlashLogExportChunk(FlashLogExportCursor& cursor, uint8_t* buffer, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        if (cursor.pending_offset == cursor.pending_length && !FormatNextExportEntry(cursor)) {
+            break;
+        }
+        size_t length = cursor.pending_length - cursor.pending_offset;
+        if (length > size - written) length = size - written;
+        memcpy(buffer + written, cursor.pending + cursor.pending_offset, length);
+        cursor.pending_offset += length;
+        written += length;
+    }
+    return written;
+}
@@ -0,0 +1,89 @@
+#ifndef FLASH_LOG_MANAGER_H
+#define FLASH_LOG_MANAGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "history_manager.h"
+
+// --- Flash Log ---
+// Append-only log of one HistoryPoint every FLASH_LOG_INTERVAL_S that
+// survives reboots. Points collect in RAM and go to flash one
+// FLASH_LOG_BATCH_BYTES batch at a time, each batch appended and closed so
+// LittleFS commits it; power loss costs at most the batch still in RAM.
+//
+// Raw batches go to segment files r00000.bin, r00001.bin.. of
+// FLASH_LOG_SEGMENT_BYTES each. Once more than FLASH_LOG_RAW_SEGMENTS exist,
+// the oldest is averaged down to one point per FLASH_LOG_COMPACT_INTERVAL_S
+// into c00000.bin.. and deleted; past FLASH_LOG_MAX_BYTES the oldest
+// compacted segment goes. Batch layout, little endian:
+//
+//   magic u16 "WL" | boot u16 | epoch_offset u32 | interval_s u16 | count u8 | crc16 u16
+//   | count x (uptime_s u32 | centi-Celsius i16 per thermistor | rpm u16 per fan | duty u8 per fan)
+//   | 0xFF padding
+//
+// epoch_offset is Unix time minus uptime, 0 while the clock was not set. The
+// CRC (usb_protocol.h's CRC-16/CCITT) covers the header before it and the
+// points; batches that fail it are skipped.
+//
+// The export is "WLX1" | thermistors u8 | fans u8, followed by entries, each
+// a tag byte then LEB128 varints:
+//
+//   0x01 context: boot | epoch_offset | interval_s
+//   0x02 point:   zigzag deltas against the previous point in the same
+//                 context (zero after a context): uptime_s, then every value
+//                 in batch order
+
+struct FlashLogBatch {
+    uint16_t boot = 0;
+    uint32_t epoch_offset = 0;
+    uint16_t interval_s = 0;
+    uint8_t count = 0;
+    HistoryPoint points[(FLASH_LOG_BATCH_BYTES - 13) / sizeof(HistoryPoint)];
+};
+
+struct FlashLogStats {
+    uint16_t boot = 0;
+    uint32_t raw_segments = 0;
+    uint32_t compacted_segments = 0;
+    uint32_t bytes = 0;
+    uint32_t batches_written = 0;
+    uint32_t corrupt_batches = 0;
+};
+
+// Streams the log oldest first, see WriteFlashLogExportChunk()
+struct FlashLogExportCursor {
+    enum class Stage : uint8_t { Magic, Compacted, Raw, Pending, Done };
+
+    Stage stage = Stage::Magic;
+    bool has_segment = false;
+    uint32_t segment = 0;
+    long offset = 0;
+    FlashLogBatch batch;
+    uint8_t next_point = 0;
+    bool has_context = false;
+    uint16_t boot = 0;
+    uint32_t epoch_offset = 0;
+    uint16_t interval_s = 0;
+    HistoryPoint previous = {};
+    uint8_t pending[FLASH_LOG_EXPORT_MAX_ENTRY_BYTES];
+    size_t pending_length = 0;
+    size_t pending_offset = 0;
+};
+
+// directory is a VFS path ("/littlefs/log" on the board); false if it cannot be created
+bool StartFlashLog(const char* directory);
+bool FlashLogAvailable();
+
+// Logger task only: keeps one point per FLASH_LOG_INTERVAL_S, writes full
+// batches and compacts on segment rollover
+void RecordFlashLogSample(const ControllerState& state);
+// Writes the partial batch now, before a planned restart
+void FlushFlashLog();
+FlashLogStats GetFlashLogStats();
+
+FlashLogExportCursor OpenFlashLogExport();
+// Writes the next piece of the export into buffer and returns its length,
+// 0 once everything has been written. Includes the batch still in RAM.
+size_t WriteFlashLogExportChunk(FlashLogExportCursor& cursor, uint8_t* buffer, size_t size);
+
+#endif // FLASH_LOG_MANAGER_H
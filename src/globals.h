@@ -23,24 +23,23 @@
 #include <Adafruit_ADS1X15.h>
 #include "USB.h"
 #include "USBCDC.h"
+#include <driver/pulse_cnt.h>
 
 #include "types.h"
 #include "config_constants.h"
 #include "pins.h"
+#include "controller_state.h"
 
 // --- Global Variables ---
 
 // System State
 extern unsigned long gHoldButtonCounter;
-extern bool b_TempAlarmFiring;
-extern bool b_RpmAlarmFiring;
 extern bool b_ResetPressed;
 extern bool b_BootCompleted;
-extern ScreenView currentScreen;
-extern String espChipIdStr;
 
 // Global Objects
 extern AsyncWebServer webServer;
+extern AsyncEventSource webEvents;
 extern DNSServer dnsServer;
 extern WiFiClient wifiClient;
 extern PubSubClient mqttClient;
@@ -57,26 +56,10 @@ extern const IPAddress AP_GATEWAY_IP;
 extern const IPAddress AP_SUBNET_MASK;
 extern const String AP_LOCAL_URL;
 
-// Settings & Config
-extern Settings systemSettings;
-extern std::map<int, TemperatureSensorSettings> m_SensorSettings;
-extern std::map<int, LedSettings> m_LedSettings;
+// Fan Tach Counters (one PCNT unit per fan)
+extern pcnt_unit_handle_t a_TachCounters[ACTIVE_FANS];
 
-// LED Data
-extern CRGB a_LedBuffers[ACTIVE_LED_STRIPS][MAX_LEDS_PER_STRIP];
-
-// Thermistor/Fan IDs
-extern int a_ThermistorIds[ACTIVE_THERMISTORS];
-extern int a_FanIds[ACTIVE_FANS];
-
-// Fan State
-extern unsigned long a_CurrentFanSpeedsRpm[ACTIVE_FANS];
-extern std::map<int, FanRpmTarget> m_TargetFanRpm;
-
-// Fan ISR Timestamps (MUST be volatile)
-extern volatile unsigned long fan0_TS1, fan0_TS2;
-extern volatile unsigned long fan1_TS1, fan1_TS2;
-extern volatile unsigned long fan2_TS1, fan2_TS2;
-extern volatile unsigned long fan3_TS1, fan3_TS2;
+// ADS1115 ALERT/RDY pulse count (MUST be volatile)
+extern volatile unsigned long ads_ReadyCount;
 
 #endif // GLOBALS_H
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "types.h"
+
+// --- Hardware Abstraction Layer ---
+// Everything the control, telemetry, LED and display pipelines need from the
+// board goes through these calls. hal_esp32.cpp backs them with the real
+// peripherals, hal_native.cpp with a simulated loop for [env:native].
+
+// Clock
+unsigned long HalMillis();
+unsigned long HalMicros();
+// Unix time once NTP has set the clock, 0 before that
+uint32_t HalEpochSeconds();
+
+// Scheduler: give up the CPU for a tick so lower-priority tasks can run
+void HalYield();
+
+// Large buffers: zeroed PSRAM, nullptr when the board has none (never falls back to internal RAM)
+void* HalAllocLarge(size_t bytes);
+
+// Critical section: no preemption or interrupts on this core until exit
+void HalEnterCritical();
+void HalExitCritical();
+
+// ADC: the ADS1115 converts continuously on one selected channel. A result is
+// ready once a full conversion has completed since the channel was selected.
+void HalAdcSelectChannel(uint8_t channel);
+bool HalAdcConversionReady();
+bool HalAdcWaitReady(unsigned long timeout_ms);
+int16_t HalAdcReadLatest();
+
+// PWM: duty in PWM_RESOLUTION_BITS for the fan at this index in a_FanIds
+void HalPwmWrite(int fan_index, int duty);
+
+// Tach: free-running count of rising edges, counted in hardware
+uint32_t HalTachReadPulseCount(int fan_index);
+
+// LED sink
+void HalLedSelectChannel(int led_strip_index, LedChannel channel);
+void HalLedShow();
+
+// Display sink
+void HalDisplayClear();
+void HalDisplaySetCursor(int16_t x, int16_t y);
+void HalDisplayPrintf(const char* format, ...) __attribute__((format(printf, 1, 2)));
+void HalDisplayFlush();
+
+#endif // HAL_H
@@ -0,0 +1,185 @@
+#ifdef ARDUINO
+
+#include "hal.h"
+#include "globals.h"
+#include "i2c_bus_manager.h"
+#include <esp_heap_caps.h>
+#include <mutex>
+
+unsigned long HalMillis() {
+    return millis();
+}
+
+unsigned long HalMicros() {
+    return micros();
+}
+
+uint32_t HalEpochSeconds() {
+    time_t now = time(nullptr);
+    return now > 1600000000 ? static_cast<uint32_t>(now) : 0; // Still counting from 1970 until the first sync
+}
+
+void HalYield() {
+    vTaskDelay(1);
+}
+
+void* HalAllocLarge(size_t bytes) {
+    if (!psramFound()) {
+        return nullptr;
+    }
+    return heap_caps_calloc(1, bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+}
+
+static portMUX_TYPE s_CriticalMux = portMUX_INITIALIZER_UNLOCKED;
+
+void HalEnterCritical() {
+    portENTER_CRITICAL(&s_CriticalMux);
+}
+
+void HalExitCritical() {
+    portEXIT_CRITICAL(&s_CriticalMux);
+}
+
+static unsigned long s_AdcSelectedMs = 0;
+static unsigned long s_AdcReadyCountAtSelect = 0;
+
+void HalAdcSelectChannel(uint8_t channel) {
+    static const uint16_t mux_by_channel[] = {
+        ADS1X15_REG_CONFIG_MUX_SINGLE_0, ADS1X15_REG_CONFIG_MUX_SINGLE_1,
+        ADS1X15_REG_CONFIG_MUX_SINGLE_2, ADS1X15_REG_CONFIG_MUX_SINGLE_3
+    };
+    // Continuous mode also switches ALERT/RDY to conversion-ready pulses
+    I2cBusAcquire(I2cDevice::Adc);
+    ads.startADCReading(mux_by_channel[channel & 0x03], true);
+    I2cBusRelease(I2cDevice::Adc);
+    s_AdcSelectedMs = millis();
+    s_AdcReadyCountAtSelect = ads_ReadyCount;
+}
+
+bool HalAdcConversionReady() {
+    // The first conversion after a mux change may still be the old channel, so wait for two
+    if (PIN_ADS_ALERT >= 0) {
+        return ads_ReadyCount - s_AdcReadyCountAtSelect >= 2;
+    }
+    return millis() - s_AdcSelectedMs >= 2 * ADC_CONVERSION_MS;
+}
+
+bool HalAdcWaitReady(unsigned long timeout_ms) {
+    unsigned long start = millis();
+    while (!HalAdcConversionReady()) {
+        if (millis() - start >= timeout_ms) return false;
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+int16_t HalAdcReadLatest() {
+    I2cBusAcquire(I2cDevice::Adc);
+    int16_t adc_raw = ads.getLastConversionResults();
+    I2cBusRelease(I2cDevice::Adc);
+    return adc_raw;
+}
+
+void HalPwmWrite(int fan_index, int duty) {
+    ledcWrite(PIN_FANS[fan_index].pwm_pin, duty);
+}
+
+uint32_t HalTachReadPulseCount(int fan_index) {
+    if (fan_index < 0 || fan_index >= ACTIVE_FANS || a_TachCounters[fan_index] == nullptr) {
+        return 0;
+    }
+    int count = 0;
+    pcnt_unit_get_count(a_TachCounters[fan_index], &count);
+    return static_cast<uint32_t>(count);
+}
+
+void HalLedSelectChannel(int led_strip_index, LedChannel channel) {
+    uint8_t int_pin = (led_strip_index == 0) ? PIN_LED_EXT_CTRL_1 : PIN_LED_EXT_CTRL_2;
+    
+#ifdef THREE_STATE_BUFFER_VERSION
+    uint8_t tsb_pin = (led_strip_index == 0) ? PIN_LED_TSB_CTRL_1 : PIN_LED_TSB_CTRL_2;
+#endif
+
+    if (channel == LedChannel::Internal) {
+        digitalWrite(int_pin, LOW);
+#ifdef THREE_STATE_BUFFER_VERSION
+        digitalWrite(tsb_pin, HIGH);
+#endif
+    } else { 
+        digitalWrite(int_pin, HIGH);
+#ifdef THREE_STATE_BUFFER_VERSION
+        digitalWrite(tsb_pin, LOW);
+#endif
+    }
+}
+
+void HalLedShow() {
+    FastLED.show();
+}
+
+void HalDisplayClear() {
+    oledDisplay.clearDisplay();
+}
+
+void HalDisplaySetCursor(int16_t x, int16_t y) {
+    oledDisplay.setCursor(x, y);
+}
+
+void HalDisplayPrintf(const char* format, ...) {
+    char line[64];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    oledDisplay.print(line);
+}
+
+static uint8_t s_DisplayShadow[SCREEN_WIDTH * SCREEN_HEIGHT / 8]; // What the panel currently shows
+static bool s_DisplayShadowValid = false;
+// Setup and the WiFi code flush too, not only the display task. Held across
+// the whole compare-and-send; the bus lock is still taken per page.
+static std::mutex s_DisplayFlushMutex;
+
+static bool WriteDisplayPage(uint8_t page, const uint8_t* data) {
+    I2cBusAcquire(I2cDevice::Display);
+    Wire.beginTransmission(SCREEN_ADDR);
+    Wire.write((uint8_t)0x00); // Command stream
+    Wire.write((uint8_t)SSD1306_PAGEADDR);
+    Wire.write(page);
+    Wire.write(page);
+    Wire.write((uint8_t)SSD1306_COLUMNADDR);
+    Wire.write((uint8_t)0);
+    Wire.write((uint8_t)(SCREEN_WIDTH - 1));
+    bool ok = Wire.endTransmission() == 0;
+
+    for (int offset = 0; ok && offset < SCREEN_WIDTH; offset += I2C_DISPLAY_CHUNK_BYTES) {
+        Wire.beginTransmission(SCREEN_ADDR);
+        Wire.write((uint8_t)0x40); // Data stream
+        Wire.write(data + offset, I2C_DISPLAY_CHUNK_BYTES);
+        ok = Wire.endTransmission() == 0;
+    }
+    I2cBusRelease(I2cDevice::Display);
+    return ok;
+}
+
+void HalDisplayFlush() {
+    // One bus transaction per changed page instead of one 1 KB push, so a
+    // pending ADC read only ever waits behind a single page
+    std::lock_guard<std::mutex> lock(s_DisplayFlushMutex);
+    const uint8_t* buffer = oledDisplay.getBuffer();
+    for (uint8_t page = 0; page < SCREEN_HEIGHT / 8; page++) {
+        const uint8_t* page_data = buffer + page * SCREEN_WIDTH;
+        uint8_t* shadow = s_DisplayShadow + page * SCREEN_WIDTH;
+        if (s_DisplayShadowValid && memcmp(page_data, shadow, SCREEN_WIDTH) == 0) {
+            continue;
+        }
+        if (!WriteDisplayPage(page, page_data)) {
+            s_DisplayShadowValid = false; // Resend everything next time
+            return;
+        }
+        memcpy(shadow, page_data, SCREEN_WIDTH);
+    }
+    s_DisplayShadowValid = true;
+}
+
+#endif // ARDUINO
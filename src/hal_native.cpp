@@ -0,0 +1,223 @@
+#ifndef ARDUINO
+
+#include "hal.h"
+#include "hal_native.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config_constants.h"
+
+HostSerial Serial;
+
+// --- Plant Model ---
+constexpr double SIM_COOLANT_HEAT_CAPACITY = 1700.0;  // J/K, ~0.4 l of water
+constexpr double SIM_PASSIVE_CONDUCTANCE = 5.0;       // W/K with fans stopped
+constexpr double SIM_FAN_CONDUCTANCE = 25.0;          // W/K added at 100% duty
+constexpr double SIM_AIR_COUPLING = 0.3;              // TEMP_2 sits in the radiator exhaust
+constexpr double SIM_FAN_SPINUP_TAU_MS = 800.0;
+constexpr double SIM_MAX_RPM[ACTIVE_FANS] = {3000.0, 1800.0, 1800.0, 1800.0};
+constexpr uint32_t SIM_EPOCH_AT_START = 1767225600; // 2026-01-01 00:00 UTC
+
+static unsigned long long s_SimMicros = 0;
+static bool s_ClockSynced = true;
+static double s_AmbientCelsius = 25.0;
+static double s_CoolantCelsius = 25.0;
+static double s_HeatLoadWatts = 150.0;
+static int s_PwmDuty[ACTIVE_FANS] = {0};
+static double s_FanRpm[ACTIVE_FANS] = {0};
+static double s_TachPhase[ACTIVE_FANS] = {0};
+static uint32_t s_TachPulses[ACTIVE_FANS] = {0};
+static uint8_t s_AdcChannel = 0;
+static unsigned long s_AdcSelectedMs = 0;
+static uint32_t s_NoiseState = 0x1234567;
+static unsigned long s_LedFrames = 0;
+static char s_DisplayText[512];
+static size_t s_DisplayLength = 0;
+
+static int NextNoise(int amplitude) {
+    s_NoiseState = s_NoiseState * 1664525u + 1013904223u;
+    return static_cast<int>((s_NoiseState >> 16) % (2 * amplitude + 1)) - amplitude;
+}
+
+void HalSimReset(double ambient_celsius) {
+    s_SimMicros = 0;
+    s_ClockSynced = true;
+    s_AmbientCelsius = ambient_celsius;
+    s_CoolantCelsius = ambient_celsius;
+    for (int i = 0; i < ACTIVE_FANS; i++) {
+        s_PwmDuty[i] = 0;
+        s_FanRpm[i] = 0;
+        s_TachPhase[i] = 0;
+        s_TachPulses[i] = 0;
+    }
+    s_AdcChannel = 0;
+    s_AdcSelectedMs = 0;
+    s_LedFrames = 0;
+    s_DisplayLength = 0;
+    s_DisplayText[0] = '\0';
+}
+
+void HalSimAdvance(unsigned long ms) {
+    const int max_duty = (1 << PWM_RESOLUTION_BITS) - 1;
+
+    for (unsigned long step = 0; step < ms; step++) {
+        s_SimMicros += 1000;
+
+        double duty_sum = 0;
+        for (int i = 0; i < ACTIVE_FANS; i++) {
+            double duty = static_cast<double>(s_PwmDuty[i]) / max_duty;
+            duty_sum += duty;
+
+            // First order spin-up towards the duty-proportional speed
+            s_FanRpm[i] += (SIM_MAX_RPM[i] * duty - s_FanRpm[i]) / SIM_FAN_SPINUP_TAU_MS;
+
+            // Two tach pulses per revolution
+            s_TachPhase[i] += s_FanRpm[i] * 2.0 / 60000.0;
+            if (s_TachPhase[i] >= 1.0) {
+                s_TachPhase[i] -= 1.0;
+                s_TachPulses[i]++;
+            }
+        }
+
+        double conductance = SIM_PASSIVE_CONDUCTANCE + SIM_FAN_CONDUCTANCE * (duty_sum / ACTIVE_FANS);
+        double net_watts = s_HeatLoadWatts - conductance * (s_CoolantCelsius - s_AmbientCelsius);
+        s_CoolantCelsius += net_watts * 0.001 / SIM_COOLANT_HEAT_CAPACITY;
+    }
+}
+
+void HalSimSetHeatLoad(double watts) {
+    s_HeatLoadWatts = watts;
+}
+
+void HalSimSetClockSynced(bool synced) {
+    s_ClockSynced = synced;
+}
+
+double HalSimTemperature(int channel) {
+    if (channel == 0) return s_CoolantCelsius;
+    return s_AmbientCelsius + SIM_AIR_COUPLING * (s_CoolantCelsius - s_AmbientCelsius);
+}
+
+int HalSimPwmDuty(int fan_id) {
+    return (fan_id >= 0 && fan_id < ACTIVE_FANS) ? s_PwmDuty[fan_id] : 0;
+}
+
+unsigned long HalSimLedFrames() {
+    return s_LedFrames;
+}
+
+const char* HalSimDisplayText() {
+    return s_DisplayText;
+}
+
+// --- Clock ---
+
+unsigned long HalMillis() {
+    return static_cast<unsigned long>(s_SimMicros / 1000);
+}
+
+unsigned long HalMicros() {
+    return static_cast<unsigned long>(s_SimMicros);
+}
+
+uint32_t HalEpochSeconds() {
+    if (!s_ClockSynced) {
+        return 0;
+    }
+    return SIM_EPOCH_AT_START + HalMillis() / 1000;
+}
+
+void HalYield() {
+    // Single-threaded simulation: nothing else can be holding the CPU
+}
+
+// --- Memory ---
+
+void* HalAllocLarge(size_t bytes) {
+    return calloc(1, bytes);
+}
+
+// --- Critical section ---
+
+void HalEnterCritical() {
+}
+
+void HalExitCritical() {
+}
+
+// --- ADC ---
+
+void HalAdcSelectChannel(uint8_t channel) {
+    s_AdcChannel = channel;
+    s_AdcSelectedMs = HalMillis();
+}
+
+bool HalAdcConversionReady() {
+    return HalMillis() - s_AdcSelectedMs >= 2 * ADC_CONVERSION_MS;
+}
+
+bool HalAdcWaitReady(unsigned long /*timeout_ms*/) {
+    return HalAdcConversionReady(); // Time only moves in HalSimAdvance()
+}
+
+int16_t HalAdcReadLatest() {
+    if (s_AdcChannel >= ACTIVE_THERMISTORS) return -1;
+
+    // Invert the B-parameter model and the divider to get the count the ADS1115 would report
+    double kelvin = HalSimTemperature(s_AdcChannel) + 273.15;
+    double resistance = T_NOMINAL_RESISTANCE * exp(T_B_VALUE * (1.0 / kelvin - 1.0 / (T_NOMINAL_TEMPERATURE + 273.15)));
+    double voltage = ADC_VOLTAGE * resistance / (T_REFERENCE_RESISTANCE + resistance);
+    return static_cast<int16_t>(voltage * 32767.0 / 6.144) + NextNoise(2);
+}
+
+// --- PWM ---
+
+void HalPwmWrite(int fan_index, int duty) {
+    if (fan_index >= 0 && fan_index < ACTIVE_FANS) s_PwmDuty[fan_index] = duty;
+}
+
+// --- Tach ---
+
+uint32_t HalTachReadPulseCount(int fan_index) {
+    if (fan_index < 0 || fan_index >= ACTIVE_FANS) {
+        return 0;
+    }
+    return s_TachPulses[fan_index];
+}
+
+// --- LED sink ---
+
+void HalLedSelectChannel(int /*led_strip_index*/, LedChannel /*channel*/) {
+}
+
+void HalLedShow() {
+    s_LedFrames++;
+}
+
+// --- Display sink ---
+
+void HalDisplayClear() {
+    s_DisplayLength = 0;
+    s_DisplayText[0] = '\0';
+}
+
+void HalDisplaySetCursor(int16_t x, int16_t y) {
+    if (x == 0 && y == 0) return;
+    HalDisplayPrintf("\n");
+}
+
+void HalDisplayPrintf(const char* format, ...) {
+    if (s_DisplayLength >= sizeof(s_DisplayText) - 1) return;
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(s_DisplayText + s_DisplayLength, sizeof(s_DisplayText) - s_DisplayLength, format, args);
+    va_end(args);
+    if (n > 0) s_DisplayLength = strnlen(s_DisplayText, sizeof(s_DisplayText));
+}
+
+void HalDisplayFlush() {
+}
+
+#endif // ARDUINO
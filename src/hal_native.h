@@ -0,0 +1,17 @@
+#ifndef HAL_NATIVE_H
+#define HAL_NATIVE_H
+
+// Simulation controls for the host HAL (hal_native.cpp). The simulated loop is
+// a single coolant mass heated by a configurable load and cooled by the fans;
+// thermistor counts, tach edges and LED/display output are derived from it.
+
+void HalSimReset(double ambient_celsius);
+void HalSimAdvance(unsigned long ms);
+void HalSimSetHeatLoad(double watts);
+void HalSimSetClockSynced(bool synced); // HalEpochSeconds() is 0 until NTP "syncs", on by default
+double HalSimTemperature(int channel);
+int HalSimPwmDuty(int fan_id);
+unsigned long HalSimLedFrames();
+const char* HalSimDisplayText();
+
+#endif // HAL_NATIVE_H
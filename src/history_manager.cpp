@@ -0,0 +1,332 @@
+#include "history_manager.h"
+#include <atomic>
+#include <math.h>
+#include <string.h>
+#include "hal.h"
+#include "json_writer.h"
+
+// Single-writer ring read without locks. Like Seqlock, the reader copies a
+// slot and then checks the write count: if the writer got within one lap of
+// the slot meanwhile, the copy may be torn and is thrown away.
+template <typename T>
+struct HistoryRing {
+    T* entries = nullptr;
+    uint32_t capacity = 0;
+    std::atomic<uint32_t> written{0};
+
+    void Append(const T& value) {
+        const uint32_t index = written.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        entries[index % capacity] = value;
+        written.store(index + 1, std::memory_order_release);
+    }
+
+    bool Read(uint32_t index, T& out) const {
+        const uint32_t before = written.load(std::memory_order_acquire);
+        if (index >= before || before - index >= capacity) {
+            return false;
+        }
+        out = entries[index % capacity];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return written.load(std::memory_order_relaxed) - index < capacity;
+    }
+
+    // Oldest index a reader can still expect to get, one slot of slack for the writer
+    uint32_t Oldest() const {
+        const uint32_t count = written.load(std::memory_order_acquire);
+        return count > capacity - 1 ? count - (capacity - 1) : 0;
+    }
+};
+
+struct HistoryAccumulator {
+    uint32_t start_s = 0;
+    uint32_t count = 0;
+    HistoryValues minimum;
+    HistoryValues maximum;
+    int32_t temperature_sum[ACTIVE_THERMISTORS] = {};
+    uint32_t temperature_count[ACTIVE_THERMISTORS] = {};
+    uint32_t rpm_sum[ACTIVE_FANS] = {};
+    uint32_t duty_sum[ACTIVE_FANS] = {};
+};
+
+static HistoryRing<HistoryPoint> s_RawHistory;
+static HistoryRing<HistoryRollup> s_DayHistory;
+static HistoryRing<HistoryRollup> s_WeekHistory;
+static HistoryAccumulator s_DayAccumulator;  // Control task only
+static HistoryAccumulator s_WeekAccumulator; // Control task only
+static bool s_HistoryStarted = false;
+static bool s_HasRawPoint = false;
+static uint32_t s_LastRawSecond = 0;
+
+static const char* const a_HistoryTierNames[] = {"raw", "day", "week"};
+
+bool StartHistory() {
+    if (s_HistoryStarted) {
+        return true;
+    }
+    const size_t raw_bytes = sizeof(HistoryPoint) * HISTORY_RAW_POINTS;
+    const size_t day_bytes = sizeof(HistoryRollup) * HISTORY_DAY_POINTS;
+    const size_t week_bytes = sizeof(HistoryRollup) * HISTORY_WEEK_POINTS;
+    uint8_t* storage = static_cast<uint8_t*>(HalAllocLarge(raw_bytes + day_bytes + week_bytes));
+    if (!storage) {
+        Serial.println("History: No PSRAM, history disabled.");
+        return false;
+    }
+    s_RawHistory.entries = reinterpret_cast<HistoryPoint*>(storage);
+    s_RawHistory.capacity = HISTORY_RAW_POINTS;
+    s_DayHistory.entries = reinterpret_cast<HistoryRollup*>(storage + raw_bytes);
+    s_DayHistory.capacity = HISTORY_DAY_POINTS;
+    s_WeekHistory.entries = reinterpret_cast<HistoryRollup*>(storage + raw_bytes + day_bytes);
+    s_WeekHistory.capacity = HISTORY_WEEK_POINTS;
+    s_HistoryStarted = true;
+    Serial.printf("History: %u bytes in PSRAM.\n", (unsigned)(raw_bytes + day_bytes + week_bytes));
+    return true;
+}
+
+bool HistoryAvailable() {
+    return s_HistoryStarted;
+}
+
+static void Accumulate(HistoryAccumulator& acc, const HistoryValues& values) {
+    for (int i = 0; i < ACTIVE_THERMISTORS; i++) {
+        const int16_t centi = values.centi_celsius[i];
+        if (centi == INT16_MIN) continue;
+        if (acc.temperature_count[i] == 0 || centi < acc.minimum.centi_celsius[i]) acc.minimum.centi_celsius[i] = centi;
+        if (acc.temperature_count[i] == 0 || centi > acc.maximum.centi_celsius[i]) acc.maximum.centi_celsius[i] = centi;
+        acc.temperature_sum[i] += centi;
+        acc.temperature_count[i]++;
+    }
+    for (int i = 0; i < ACTIVE_FANS; i++) {
+        if (acc.count == 0 || values.rpm[i] < acc.minimum.rpm[i]) acc.minimum.rpm[i] = values.rpm[i];
+        if (acc.count == 0 || values.rpm[i] > acc.maximum.rpm[i]) acc.maximum.rpm[i] = values.rpm[i];
+        if (acc.count == 0 || values.duty[i] < acc.minimum.duty[i]) acc.minimum.duty[i] = values.duty[i];
+        if (acc.count == 0 || values.duty[i] > acc.maximum.duty[i]) acc.maximum.duty[i] = values.duty[i];
+        acc.rpm_sum[i] += values.rpm[i];
+        acc.duty_sum[i] += values.duty[i];
+    }
+    acc.count++;
+}
+
+static HistoryRollup FinishRollup(const HistoryAccumulator& acc) {
+    HistoryRollup rollup;
+    rollup.uptime_s = acc.start_s;
+    rollup.minimum = acc.minimum;
+    rollup.maximum = acc.maximum;
+    for (int i = 0; i < ACTIVE_THERMISTORS; i++) {
+        const uint32_t count = acc.temperature_count[i];
+        if (count == 0) {
+            rollup.minimum.centi_celsius[i] = rollup.average.centi_celsius[i] = rollup.maximum.centi_celsius[i] = INT16_MIN;
+            continue;
+        }
+        rollup.average.centi_celsius[i] = static_cast<int16_t>(lround(double(acc.temperature_sum[i]) / count));
+    }
+    for (int i = 0; i < ACTIVE_FANS; i++) {
+        rollup.average.rpm[i] = static_cast<uint16_t>((acc.rpm_sum[i] + acc.count / 2) / acc.count);
+        rollup.average.duty[i] = static_cast<uint8_t>((acc.duty_sum[i] + acc.count / 2) / acc.count);
+    }
+    return rollup;
+}
+
+// A bucket is published once the first point of the next one arrives
+static void AddToRollup(HistoryAccumulator& acc, HistoryRing<HistoryRollup>& ring, uint32_t interval_s,
+                        const HistoryPoint& point) {
+    const uint32_t bucket_s = point.uptime_s - point.uptime_s % interval_s;
+    if (acc.count > 0 && bucket_s != acc.start_s) {
+        ring.Append(FinishRollup(acc));
+        acc = HistoryAccumulator();
+    }
+    acc.start_s = bucket_s;
+    Accumulate(acc, point.values);
+}
+
+HistoryPoint MakeHistoryPoint(const ControllerState& state) {
+    HistoryPoint point;
+    point.uptime_s = static_cast<uint32_t>(state.timestamp_ms / 1000);
+    for (int i = 0; i < ACTIVE_THERMISTORS; i++) {
+        const double celsius = state.temperatures[i];
+        point.values.centi_celsius[i] = celsius > -90.0 ? static_cast<int16_t>(lround(fmin(celsius, 320.0) * 100)) : INT16_MIN;
+    }
+    for (int i = 0; i < ACTIVE_FANS; i++) {
+        point.values.rpm[i] = static_cast<uint16_t>(state.fans[i].rpm > 0xFFFF ? 0xFFFF : state.fans[i].rpm);
+        point.values.duty[i] = static_cast<uint8_t>(state.fans[i].current_duty);
+    }
+    return point;
+}
+
+void RecordHistorySample(const ControllerState& state) {
+    if (!s_HistoryStarted) {
+        return;
+    }
+    const uint32_t uptime_s = static_cast<uint32_t>(state.timestamp_ms / 1000);
+    if (s_HasRawPoint && uptime_s - s_LastRawSecond < HISTORY_RAW_INTERVAL_S) {
+        return;
+    }
+    s_HasRawPoint = true;
+    s_LastRawSecond = uptime_s;
+
+    const HistoryPoint point = MakeHistoryPoint(state);
+    s_RawHistory.Append(point);
+    AddToRollup(s_DayAccumulator, s_DayHistory, HISTORY_DAY_INTERVAL_S, point);
+    AddToRollup(s_WeekAccumulator, s_WeekHistory, HISTORY_WEEK_INTERVAL_S, point);
+}
+
+bool ParseHistoryTier(const char* name, HistoryTier& tier) {
+    for (int i = 0; i < 3; i++) {
+        if (strcmp(name, a_HistoryTierNames[i]) == 0) {
+            tier = static_cast<HistoryTier>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* HistoryTierName(HistoryTier tier) {
+    return a_HistoryTierNames[static_cast<int>(tier)];
+}
+
+static uint32_t HistoryTierInterval(HistoryTier tier) {
+    switch (tier) {
+        case HistoryTier::Day: return HISTORY_DAY_INTERVAL_S;
+        case HistoryTier::Week: return HISTORY_WEEK_INTERVAL_S;
+        default: return HISTORY_RAW_INTERVAL_S;
+    }
+}
+
+static uint32_t HistoryTierWritten(HistoryTier tier) {
+    switch (tier) {
+        case HistoryTier::Day: return s_DayHistory.written.load(std::memory_order_acquire);
+        case HistoryTier::Week: return s_WeekHistory.written.load(std::memory_order_acquire);
+        default: return s_RawHistory.written.load(std::memory_order_acquire);
+    }
+}
+
+static uint32_t HistoryTierOldest(HistoryTier tier) {
+    switch (tier) {
+        case HistoryTier::Day: return s_DayHistory.Oldest();
+        case HistoryTier::Week: return s_WeekHistory.Oldest();
+        default: return s_RawHistory.Oldest();
+    }
+}
+
+HistoryCursor OpenHistoryCursor(HistoryTier tier, uint32_t seconds) {
+    HistoryCursor cursor;
+    cursor.tier = tier;
+    cursor.fahrenheit = systemSettings.units == "F";
+    if (!s_HistoryStarted) {
+        return cursor; // Header and footer only
+    }
+    cursor.end = HistoryTierWritten(tier);
+    cursor.next = HistoryTierOldest(tier);
+    if (seconds > 0) {
+        const uint32_t interval_s = HistoryTierInterval(tier);
+        const uint32_t wanted = (seconds + interval_s - 1) / interval_s;
+        if (cursor.end - cursor.next > wanted) cursor.next = cursor.end - wanted;
+    }
+    return cursor;
+}
+
+static void WriteTemperature(JsonWriter& writer, int16_t centi, bool fahrenheit) {
+    if (centi == INT16_MIN) {
+        writer.DecimalValue(NAN, 1); // null
+        return;
+    }
+    const double celsius = centi / 100.0;
+    writer.DecimalValue(fahrenheit ? celsius * 1.8 + 32 : celsius, 1);
+}
+
+static void WriteValues(JsonWriter& writer, const HistoryValues& values, bool fahrenheit) {
+    for (int i = 0; i < ACTIVE_THERMISTORS; i++) WriteTemperature(writer, values.centi_celsius[i], fahrenheit);
+    for (int i = 0; i < ACTIVE_FANS; i++) writer.UnsignedValue(values.rpm[i]);
+    for (int i = 0; i < ACTIVE_FANS; i++) writer.UnsignedValue(values.duty[i]);
+}
+
+// Formats the point at index as a row, false if the writer has lapped it
+static bool WriteRow(JsonWriter& writer, HistoryTier tier, uint32_t index, bool fahrenheit) {
+    if (tier == HistoryTier::Raw) {
+        HistoryPoint point;
+        if (!s_RawHistory.Read(index, point)) return false;
+        writer.BeginArray();
+        writer.UnsignedValue(point.uptime_s);
+        WriteValues(writer, point.values, fahrenheit);
+        writer.EndArray();
+        return true;
+    }
+    HistoryRollup rollup;
+    if (!(tier == HistoryTier::Day ? s_DayHistory : s_WeekHistory).Read(index, rollup)) return false;
+    writer.BeginArray();
+    writer.UnsignedValue(rollup.uptime_s);
+    for (const HistoryValues* values : {&rollup.minimum, &rollup.average, &rollup.maximum}) {
+        writer.BeginArray();
+        WriteValues(writer, *values, fahrenheit);
+        writer.EndArray();
+    }
+    writer.EndArray();
+    return true;
+}
+
+// Fills cursor.pending with the next header, row or footer; false once done
+static bool FormatNextPiece(HistoryCursor& cursor) {
+    cursor.pending_offset = 0;
+    cursor.pending_length = 0;
+
+    if (cursor.stage == HistoryCursor::Stage::Header) {
+        JsonWriter writer(cursor.pending, sizeof(cursor.pending));
+        writer.BeginObject();
+        writer.Key("now");
+        writer.UnsignedValue(HalMillis() / 1000);
+        writer.Key("tier");
+        writer.StringValue(HistoryTierName(cursor.tier));
+        writer.Key("interval_s");
+        writer.UnsignedValue(HistoryTierInterval(cursor.tier));
+        writer.Key("units");
+        writer.StringValue(cursor.fahrenheit ? "F" : "C");
+        writer.Key("temperatures");
+        writer.UnsignedValue(ACTIVE_THERMISTORS);
+        writer.Key("fans");
+        writer.UnsignedValue(ACTIVE_FANS);
+        writer.Key("points");
+        writer.BeginArray();
+        cursor.pending_length = writer.Length();
+        cursor.stage = HistoryCursor::Stage::Rows;
+        return true;
+    }
+
+    while (cursor.stage == HistoryCursor::Stage::Rows && cursor.next < cursor.end) {
+        const size_t separator = cursor.first_row ? 0 : 1;
+        cursor.pending[0] = ',';
+        JsonWriter writer(cursor.pending + separator, sizeof(cursor.pending) - separator);
+        const uint32_t index = cursor.next++;
+        if (!WriteRow(writer, cursor.tier, index, cursor.fahrenheit)) {
+            // Overwritten while we streamed: skip to what is still there
+            const uint32_t oldest = HistoryTierOldest(cursor.tier);
+            if (cursor.next < oldest) cursor.next = oldest;
+            continue;
+        }
+        cursor.first_row = false;
+        cursor.pending_length = separator + writer.Length();
+        return true;
+    }
+
+    if (cursor.stage != HistoryCursor::Stage::Done) {
+        memcpy(cursor.pending, "]}", 2);
+        cursor.pending_length = 2;
+        cursor.stage = HistoryCursor::Stage::Done;
+        return true;
+    }
+    return false;
+}
+
+size_t WriteHistoryChunk(HistoryCursor& cursor, char* buffer, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        if (cursor.pending_offset == cursor.pending_length && !FormatNextPiece(cursor)) {
+            break;
+        }
+        size_t length = cursor.pending_length - cursor.pending_offset;
+        if (length > size - written) length = size - written;
+        memcpy(buffer + written, cursor.pending + cursor.pending_offset, length);
+        cursor.pending_offset += length;
+        written += length;
+    }
+    return written;
+}
@@ -0,0 +1,74 @@
+#ifndef HISTORY_MANAGER_H
+#define HISTORY_MANAGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "controller_state.h"
+
+// --- History ---
+// Three ring buffers in PSRAM: one raw point per second for the last hour,
+// and min/avg/max rollups per minute for the last day and per 10 minutes for
+// the last week. The control task appends, any task reads without locking;
+// a reader that gets lapped by the writer skips ahead instead of returning a
+// torn point. Timestamps are seconds of uptime.
+
+enum class HistoryTier : uint8_t { Raw, Day, Week };
+
+// Compact per-point values: centi-Celsius (INT16_MIN = N/A), RPM and duty
+struct HistoryValues {
+    int16_t centi_celsius[ACTIVE_THERMISTORS];
+    uint16_t rpm[ACTIVE_FANS];
+    uint8_t duty[ACTIVE_FANS];
+};
+
+struct HistoryPoint {
+    uint32_t uptime_s;
+    HistoryValues values;
+};
+
+struct HistoryRollup {
+    uint32_t uptime_s; // Bucket start
+    HistoryValues minimum;
+    HistoryValues average;
+    HistoryValues maximum;
+};
+
+// Streams one tier as JSON a piece at a time, see WriteHistoryChunk()
+struct HistoryCursor {
+    enum class Stage : uint8_t { Header, Rows, Done };
+
+    HistoryTier tier = HistoryTier::Raw;
+    Stage stage = Stage::Header;
+    uint32_t next = 0; // Absolute index of the next point
+    uint32_t end = 0;  // Points appended after the cursor opened are not included
+    bool first_row = true;
+    bool fahrenheit = false;
+    char pending[HISTORY_ROW_MAX_BYTES];
+    size_t pending_length = 0;
+    size_t pending_offset = 0;
+};
+
+// Allocates the rings; false (and history stays off) when there is no PSRAM
+bool StartHistory();
+bool HistoryAvailable();
+
+// Control task only: keeps one point per HISTORY_RAW_INTERVAL_S and rolls them up
+void RecordHistorySample(const ControllerState& state);
+// The compact point for one control-loop state, also what the flash log stores
+HistoryPoint MakeHistoryPoint(const ControllerState& state);
+
+// "raw", "day" or "week"
+bool ParseHistoryTier(const char* name, HistoryTier& tier);
+const char* HistoryTierName(HistoryTier tier);
+
+// Covers the last seconds of the tier, or all of it for 0
+HistoryCursor OpenHistoryCursor(HistoryTier tier, uint32_t seconds);
+
+// Writes the next piece of
+//   {"now":s,"tier":"raw","interval_s":1,"units":"C","temperatures":2,"fans":4,"points":[...]}
+// into buffer and returns its length, 0 once everything has been written.
+// Raw points are [t,temp...,rpm...,duty...], rollups [t,[min...],[avg...],[max...]].
+// Any size > 0 makes progress, rows too long for the buffer carry over.
+size_t WriteHistoryChunk(HistoryCursor& cursor, char* buffer, size_t size);
+
+#endif // HISTORY_MANAGER_H
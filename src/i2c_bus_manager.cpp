@@ -0,0 +1,80 @@
+#include "i2c_bus_manager.h"
+#include "hal.h"
+
+static SemaphoreHandle_t s_BusMutex = nullptr;
+static volatile uint32_t s_Waiting[I2C_DEVICE_COUNT] = {};
+static unsigned long s_AcquiredUs[I2C_DEVICE_COUNT] = {};
+static I2cBusStats s_Stats[I2C_DEVICE_COUNT];
+
+void InitializeI2cBus() {
+    s_BusMutex = xSemaphoreCreateMutex();
+    Wire.setPins(PIN_SDA, PIN_SCL);
+    Wire.begin();
+    Wire.setClock(I2C_BUS_CLOCK_HZ);
+    Serial.printf("I2C bus configured at %lu Hz.\n", (unsigned long)I2C_BUS_CLOCK_HZ);
+}
+
+static bool IsHigherPriorityWaiting(int index) {
+    for (int i = 0; i < index; i++) {
+        if (s_Waiting[i] > 0) return true;
+    }
+    return false;
+}
+
+void I2cBusAcquire(I2cDevice device) {
+    const int index = static_cast<int>(device);
+    const unsigned long start_us = micros();
+
+    HalEnterCritical();
+    s_Waiting[index]++;
+    HalExitCritical();
+
+    while (true) {
+        if (IsHigherPriorityWaiting(index)) {
+            vTaskDelay(1);
+            continue;
+        }
+        if (xSemaphoreTake(s_BusMutex, 1) != pdTRUE) {
+            continue;
+        }
+        if (!IsHigherPriorityWaiting(index)) {
+            break;
+        }
+        xSemaphoreGive(s_BusMutex); // Something more urgent queued while we were blocked
+    }
+
+    const unsigned long now_us = micros();
+    const uint32_t wait_us = now_us - start_us;
+    HalEnterCritical();
+    s_Waiting[index]--;
+    s_Stats[index].transactions++;
+    s_Stats[index].wait_total_us += wait_us;
+    if (wait_us > s_Stats[index].wait_max_us) s_Stats[index].wait_max_us = wait_us;
+    HalExitCritical();
+    s_AcquiredUs[index] = now_us;
+}
+
+void I2cBusRelease(I2cDevice device) {
+    const int index = static_cast<int>(device);
+    const uint32_t hold_us = micros() - s_AcquiredUs[index];
+
+    HalEnterCritical();
+    if (hold_us > s_Stats[index].hold_max_us) s_Stats[index].hold_max_us = hold_us;
+    HalExitCritical();
+    xSemaphoreGive(s_BusMutex);
+}
+
+I2cBusStats GetI2cBusStats(I2cDevice device) {
+    HalEnterCritical();
+    I2cBusStats stats = s_Stats[static_cast<int>(device)];
+    HalExitCritical();
+    return stats;
+}
+
+const char* I2cDeviceName(I2cDevice device) {
+    switch (device) {
+        case I2cDevice::Adc: return "adc";
+        case I2cDevice::Display: return "display";
+    }
+    return "unknown";
+}
@@ -0,0 +1,18 @@
+#ifndef I2C_BUS_MANAGER_H
+#define I2C_BUS_MANAGER_H
+
+#include "globals.h"
+
+// The ADS1115 and the SSD1306 share Wire. Every transaction on the bus is
+// wrapped in I2cBusAcquire/I2cBusRelease; a waiting device always goes ahead
+// of any lower priority one (see I2cDevice), so a control read waits for at
+// most the transaction already on the wire.
+
+void InitializeI2cBus();
+void I2cBusAcquire(I2cDevice device);
+void I2cBusRelease(I2cDevice device);
+
+I2cBusStats GetI2cBusStats(I2cDevice device);
+const char* I2cDeviceName(I2cDevice device);
+
+#endif // I2C_BUS_MANAGER_H
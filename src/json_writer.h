@@ -0,0 +1,160 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Writes compact JSON straight into a caller-owned buffer, never touching the
+// heap (numbers are formatted by hand, printf's float path may allocate).
+// Once something does not fit, the writer stops and Overflowed() reports it;
+// the buffer is always NUL terminated. Decimals print like ArduinoJson does,
+// without trailing zeros, so payloads match what the old serializer produced.
+class JsonWriter {
+public:
+    JsonWriter(char* buffer, size_t size) : m_Buffer(buffer), m_Size(size) {
+        if (m_Size > 0) m_Buffer[0] = '\0';
+    }
+
+    void BeginObject() {
+        Separate();
+        Append('{');
+        m_NeedsComma = false;
+    }
+
+    void EndObject() {
+        Append('}');
+        m_NeedsComma = true;
+    }
+
+    void BeginArray() {
+        Separate();
+        Append('[');
+        m_NeedsComma = false;
+    }
+
+    void EndArray() {
+        Append(']');
+        m_NeedsComma = true;
+    }
+
+    void Key(const char* key) {
+        Separate();
+        StringLiteral(key);
+        Append(':');
+        m_NeedsComma = false;
+    }
+
+    // prefix followed by the index, e.g. "FAN_2", without formatting a key first
+    void IndexedKey(const char* prefix, unsigned long index) {
+        Separate();
+        Append('"');
+        AppendText(prefix);
+        AppendUnsigned(index, 1);
+        Append('"');
+        Append(':');
+        m_NeedsComma = false;
+    }
+
+    void StringValue(const char* value) {
+        Separate();
+        StringLiteral(value);
+        m_NeedsComma = true;
+    }
+
+    void UnsignedValue(unsigned long value) {
+        Separate();
+        AppendUnsigned(value, 1);
+        m_NeedsComma = true;
+    }
+
+    void DecimalValue(double value, int decimals) {
+        Separate();
+        m_NeedsComma = true;
+        if (!isfinite(value)) {
+            AppendText("null");
+            return;
+        }
+        unsigned long scale = 1;
+        for (int i = 0; i < decimals; i++) scale *= 10;
+        const bool negative = value < 0;
+        const double magnitude = fabs(value) * scale;
+        unsigned long scaled = static_cast<unsigned long>(llround(magnitude));
+        if (magnitude - floor(magnitude) == 0.5) {
+            // The product rounded onto a tie, settle it on the exact value the way printf does
+            const double residual = fma(fabs(value), static_cast<double>(scale), -magnitude);
+            if (residual < 0 || (residual == 0 && scaled % 2 != 0)) scaled--;
+        }
+        unsigned long fraction = scaled % scale;
+        int fraction_digits = decimals;
+        while (fraction_digits > 0 && fraction % 10 == 0) {
+            fraction /= 10;
+            fraction_digits--;
+        }
+        if (negative && scaled != 0) Append('-');
+        AppendUnsigned(scaled / scale, 1);
+        if (fraction_digits > 0) {
+            Append('.');
+            AppendUnsigned(fraction, fraction_digits);
+        }
+    }
+
+    size_t Length() const { return m_Length; }
+    bool Overflowed() const { return m_Overflowed; }
+
+private:
+    void Separate() {
+        if (m_NeedsComma) Append(',');
+    }
+
+    void Append(char c) {
+        if (m_Overflowed || m_Length + 1 >= m_Size) {
+            m_Overflowed = true;
+            return;
+        }
+        m_Buffer[m_Length++] = c;
+        m_Buffer[m_Length] = '\0';
+    }
+
+    void AppendText(const char* text) {
+        while (*text) Append(*text++);
+    }
+
+    // At least min_digits, zero padded, so fractions keep their leading zeros
+    void AppendUnsigned(unsigned long value, int min_digits) {
+        char digits[20];
+        int count = 0;
+        do {
+            digits[count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value > 0 || count < min_digits);
+        while (count > 0) Append(digits[--count]);
+    }
+
+    void StringLiteral(const char* text) {
+        static const char HEX_DIGITS[] = "0123456789abcdef";
+        Append('"');
+        for (; text && *text; text++) {
+            const uint8_t c = static_cast<uint8_t>(*text);
+            if (c == '"' || c == '\\') {
+                Append('\\');
+                Append(static_cast<char>(c));
+            } else if (c < 0x20) {
+                AppendText("\\u00");
+                Append(HEX_DIGITS[c >> 4]);
+                Append(HEX_DIGITS[c & 0x0F]);
+            } else {
+                Append(static_cast<char>(c));
+            }
+        }
+        Append('"');
+    }
+
+    char* m_Buffer;
+    size_t m_Size;
+    size_t m_Length = 0;
+    bool m_NeedsComma = false;
+    bool m_Overflowed = false;
+};
+
+#endif // JSON_WRITER_H
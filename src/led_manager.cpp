@@ -1,36 +1,23 @@
 #include "led_manager.h"
+#include "config_manager.h"
 #include <math.h>     // For M_PI in LED effects
+#include "hal.h"
 
-void SwapLedChannel(LedChannel channel, int led_strip_index) {
-    auto& settings = m_LedSettings[led_strip_index];
+static int a_SelectedLedChannels[ACTIVE_LED_STRIPS] = {-1, -1}; // -1 forces the first select
 
-    if (settings.prev_mode == settings.mode) {
-        // No change in mode, no need to swap channels
+void SwapLedChannel(LedChannel channel, int led_strip_index) {
+    if (a_SelectedLedChannels[led_strip_index] == static_cast<int>(channel)) {
+        // Already driving from this source, no need to swap channels
         return;
     } else {
-        settings.prev_mode = settings.mode; // Update previous mode to current        
-    }
-    uint8_t int_pin = (led_strip_index == 0) ? PIN_LED_EXT_CTRL_1 : PIN_LED_EXT_CTRL_2;
-    
-#ifdef THREE_STATE_BUFFER_VERSION
-    uint8_t tsb_pin = (led_strip_index == 0) ? PIN_LED_TSB_CTRL_1 : PIN_LED_TSB_CTRL_2;
-#endif
-
-    if (channel == LedChannel::Internal) {
-        digitalWrite(int_pin, LOW);
-#ifdef THREE_STATE_BUFFER_VERSION
-        digitalWrite(tsb_pin, HIGH);
-#endif
-    } else { 
-        digitalWrite(int_pin, HIGH);
-#ifdef THREE_STATE_BUFFER_VERSION
-        digitalWrite(tsb_pin, LOW);
-#endif
+        a_SelectedLedChannels[led_strip_index] = static_cast<int>(channel);
     }
+    HalLedSelectChannel(led_strip_index, channel);
 }
 
 void PlayLedEffect(uint8_t led_strip_index) {
-    auto& settings = m_LedSettings[led_strip_index];
+    // Copy out: the frame and HalLedShow() take far longer than a settings read
+    const LedSettings settings = ReadControllerConfig()->leds[led_strip_index];
 
     switch (settings.mode) {
         case 0: // Off
@@ -61,7 +48,7 @@ void PlayLedEffect(uint8_t led_strip_index) {
             break;
     }
 
-    FastLED.show();
+    HalLedShow();
 
 }
 
@@ -82,7 +69,7 @@ int32_t InterpolateColor(int32_t color1, int32_t color2, float ratio) {
 }
 
 void SetGradientWave(uint8_t led_strip_index, uint8_t num_leds, int32_t start_color, int32_t end_color, uint8_t speed) {
-    unsigned long current_time = millis();
+    unsigned long current_time = HalMillis();
     float time_factor = current_time * (speed * 0.00001f); // Adjust multiplier for desired speed range
 
     for (int i = 0; i < num_leds; i++) {
@@ -99,7 +86,7 @@ void SetGradientWave(uint8_t led_strip_index, uint8_t num_leds, int32_t start_co
 }
 
 void SetMovingGradient(uint8_t led_strip_index, uint8_t num_leds, int32_t start_color, int32_t end_color, uint8_t speed) {
-    unsigned long current_time = millis();
+    unsigned long current_time = HalMillis();
     float offset = fmod(current_time * speed * 0.0001f, 1.0f); // Adjust multiplier
 
     for (int i = 0; i < num_leds; i++) {
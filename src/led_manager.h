@@ -1,7 +1,7 @@
 #ifndef LED_MANAGER_H
 #define LED_MANAGER_H
 
-#include "globals.h"
+#include "controller_state.h"
 
 void PlayLedEffect(uint8_t led_strip_index);
 void SwapLedChannel(LedChannel channel, int led_strip_index);
@@ -1,13 +1,32 @@
 #include "globals.h"
 #include <esp_wifi.h> // Used for mpdu_rx_disable android workaround
+#include <atomic>
+#include <memory>
 #include <TaskScheduler.h>
 #include "wifi_manager.h"
 #include "mqtt_manager.h"
 #include "peripherals_manager.h"
+#include "i2c_bus_manager.h"
+#include "control_manager.h"
+#include "config_manager.h"
+#include "sensor_manager.h"
+#include "telemetry_manager.h"
+#include "telemetry_cache.h"
+#include "history_manager.h"
+#include "flash_log_manager.h"
+#include "mqtt_queue.h"
+#include "web_assets_manager.h"
+#include "usb_protocol.h"
+#include "usb_stream.h"
+#include "display_manager.h"
 #include "led_manager.h"
+#include "hal.h"
 
 Task *gSendTelemetryTask = nullptr;
 Scheduler taskScheduler;
+static UsbTelemetryMode s_UsbTelemetryMode = UsbTelemetryMode::Json; // Every connection starts in JSON
+static uint16_t s_UsbSequence = 0;
+static std::atomic<bool> s_SettingsSaved{false}; // Set by /save-settings, applied from loop()
 
 // --- Function Prototypes ---
 
@@ -17,8 +36,15 @@ void ClearPreferences();
 void SaveConfig(const Settings& s);
 
 void InitializeTasks();
+void InitializeSampler();
+void ApplySystemSettings();
 void InitializeHttpServer();
 void InitializeFanCurves();
+void LoadFanSettings(TemperatureSensorSettings& settings, JsonDocument& fan_doc, int fan_id);
+void LoadFilterSettings(JsonVariantConst source, FilterSettings& settings);
+void SaveFilterSettings(JsonObject target, const FilterSettings& settings);
+void LoadPidSettings(JsonVariantConst source, FanControlMode mode, PidSettings& settings);
+void SavePidSettings(JsonObject target, const PidSettings& settings);
 
 // Core Logic
 void setup();
@@ -27,20 +53,25 @@ void loop();
 
 // Tasks
 void MonitorButtonTask(void *pvParameters);
-void MonitorStatesTask(void *pvParameters);
+void SampleTemperaturesTask(void *pvParameters);
 void ReadTemperaturesTask(void *pvParameters);
 void PlayLedsTask(void *pvParameters);
 void DisplayDataTask(void *pvParameters);
 void NativeUsbTelemetryTask(void *pvParameters);
 void PlayAlarmsTask(void *pvParameters);
+void FlashLogTask(void *pvParameters);
+void WebEventsTask(void *pvParameters);
+void WifiTask(void *pvParameters);
+void MqttTask(void *pvParameters);
 
 // Telemetry
-std::string PrepareTelemetryPayload(const std::string& event = "default");
 void SendUsbTelemetry();
+void PollUsbCommands();
+void FlushUsbStream();
+void StopUsbStream();
 
 // HTTP Server
 void HandleHttpNotFound(AsyncWebServerRequest *request);
-void StreamFile(const String& path, const String& mimetype, bool cache, AsyncWebServerRequest *request);
 
 // --- Initialization Functions ---
 
@@ -95,20 +126,57 @@ void SaveConfig(const Settings& s) {
 }
 
 
+// Creates the task unless its handle says it is already running
+static void CreateTaskOnce(TaskHandle_t& handle, TaskFunction_t task, const char* name, uint32_t stack_size, UBaseType_t priority) {
+    if (handle == nullptr) {
+        xTaskCreate(task, name, stack_size, NULL, priority, &handle);
+    }
+}
+
 void InitializeTasks() {
-    xTaskCreate(MonitorStatesTask, "MonitorStates", 4096, NULL, 6, NULL);
-    xTaskCreate(ReadTemperaturesTask, "ReadTemps", 6144, NULL, 5, NULL);
-    xTaskCreate(PlayLedsTask, "PlayLEDs", 4096, NULL, 4, NULL);
-    xTaskCreate(DisplayDataTask, "DisplayData", 4096, NULL, 3, NULL);
-    xTaskCreate(NativeUsbTelemetryTask, "UsbTelTask", 2048, NULL, 2, NULL);
-    xTaskCreate(PlayAlarmsTask, "PlayAlarms", 2048, NULL, tskIDLE_PRIORITY, NULL);
+    static TaskHandle_t read_temps_task = nullptr;
+    static TaskHandle_t play_leds_task = nullptr;
+    static TaskHandle_t display_data_task = nullptr;
+    static TaskHandle_t usb_telemetry_task = nullptr;
+    static TaskHandle_t play_alarms_task = nullptr;
+    static TaskHandle_t flash_log_task = nullptr;
+    static TaskHandle_t web_events_task = nullptr;
+    static TaskHandle_t mqtt_task = nullptr;
+    CreateTaskOnce(read_temps_task, ReadTemperaturesTask, "ReadTemps", 6144, 5);
+    CreateTaskOnce(play_leds_task, PlayLedsTask, "PlayLEDs", 4096, 4);
+    CreateTaskOnce(display_data_task, DisplayDataTask, "DisplayData", 4096, 3);
+    CreateTaskOnce(usb_telemetry_task, NativeUsbTelemetryTask, "UsbTelTask", 2048, 2);
+    CreateTaskOnce(play_alarms_task, PlayAlarmsTask, "PlayAlarms", 2048, tskIDLE_PRIORITY);
+    CreateTaskOnce(flash_log_task, FlashLogTask, "FlashLog", 4096, 1);
+    CreateTaskOnce(web_events_task, WebEventsTask, "WebEvents", 4096, 1);
+    CreateTaskOnce(mqtt_task, MqttTask, "Mqtt", 6144, 2);
+    Serial.println("Tasks initialized.");
+}
 
+// Settings /save-settings can change without a reboot. Touches the
+// scheduler, so only from setup() or loop().
+void ApplySystemSettings() {
     InitializeMqttTelemetryTask(taskScheduler, gSendTelemetryTask);
-    Serial.println("Tasks initialized.");
+    InitializeMqttClient();
 }
 
+void InitializeSampler() {
+    static TaskHandle_t sampler_task = nullptr;
+    if (sampler_task != nullptr) {
+        return;
+    }
+    xTaskCreate(SampleTemperaturesTask, "SampleTemps", 4096, NULL, 7, &sampler_task);
+
+    // Initial fan speeds come from the first snapshot, give the sampler one round
+    unsigned long start_time_ms = millis();
+    while (!HasTemperatureSamples() && millis() - start_time_ms < 1000) {
+        delay(10);
+    }
+    Serial.println("Temperature sampler started.");
+}
 
 void InitializeFanCurves() {
+    TemperatureSensorSettings fans[ACTIVE_FANS];
     for (int i = 0; i < ACTIVE_FANS; i++) {
         int fan_id = a_FanIds[i];
         String fan_key = "FAN_" + String(fan_id);
@@ -119,57 +187,120 @@ void InitializeFanCurves() {
 
         DeserializationError error = deserializeJson(fan_doc, fan_curves);
 
+        ApplyDefaultFanSettings(fans[i]);
         if (error || fan_curves == "{}") {
             Serial.printf("No/Invalid settings for %s, using defaults.\n", fan_key.c_str());
-            m_SensorSettings[fan_id].sensor_name = "TEMP_1";
-            m_SensorSettings[fan_id].temperature_alarm_threshold = 999;
-            m_SensorSettings[fan_id].rpm_alarm_threshold = -1;
-            m_SensorSettings[fan_id].step_duration_seconds = 1;
-            m_SensorSettings[fan_id].fan_speed_curve.push_back({30.0f, MapFanPercentToPwm(30)});
-            m_SensorSettings[fan_id].fan_speed_curve.push_back({33.0f, MapFanPercentToPwm(40)});
-            m_SensorSettings[fan_id].fan_speed_curve.push_back({36.0f, MapFanPercentToPwm(55)});
-            m_SensorSettings[fan_id].fan_speed_curve.push_back({39.0f, MapFanPercentToPwm(75)});
-            m_SensorSettings[fan_id].fan_speed_curve.push_back({41.0f, MapFanPercentToPwm(100)});
-
-            fan_doc["sensor"] = m_SensorSettings[fan_id].sensor_name;
+
+            fan_doc["sensor"] = TemperatureSensorName(fans[i].sensor_channel);
             fan_doc["curves"] = fan_doc.to<JsonArray>();
-            for (const auto& setting : m_SensorSettings[fan_id].fan_speed_curve) {
+            for (const auto& setting : fans[i].fan_speed_curve) {
                 JsonObject curve_point = fan_doc["curves"].add<JsonObject>();
                 curve_point["temp"] = setting.temperature_threshold;
                 curve_point["fan"] = setting.fan_duty_cycle;
             }
-            fan_doc["temp_th"] = m_SensorSettings[fan_id].temperature_alarm_threshold;
-            fan_doc["duty_th"] = m_SensorSettings[fan_id].rpm_alarm_threshold;
-            fan_doc["sud_dur"] = m_SensorSettings[fan_id].step_duration_seconds;
+            fan_doc["temp_th"] = fans[i].temperature_alarm_threshold;
+            fan_doc["duty_th"] = fans[i].rpm_alarm_threshold;
+            fan_doc["ramp_up"] = fans[i].ramp_up_rate;
+            fan_doc["ramp_down"] = fans[i].ramp_down_rate;
+            fan_doc["hyst"] = fans[i].hysteresis;
+            fan_doc["mode"] = FanControlModeName(fans[i].control_mode);
+            SavePidSettings(fan_doc["pid"].to<JsonObject>(), fans[i].pid);
+            SaveFilterSettings(fan_doc["temp_filter"].to<JsonObject>(), fans[i].temperature_filter);
+            SaveFilterSettings(fan_doc["rpm_filter"].to<JsonObject>(), fans[i].rpm_filter);
 
             String settings_json;
             serializeJson(fan_doc, settings_json);
             systemPreferences.putString(fan_key.c_str(), settings_json);
         } else {
-            m_SensorSettings[fan_id].sensor_name = fan_doc["sensor"].as<String>();
-            m_SensorSettings[fan_id].temperature_alarm_threshold = fan_doc["temp_th"].as<int>();
-            m_SensorSettings[fan_id].rpm_alarm_threshold = fan_doc["duty_th"].as<int>();
-            m_SensorSettings[fan_id].step_duration_seconds = fan_doc["sud_dur"].as<uint8_t>();
-            m_SensorSettings[fan_id].fan_speed_curve.clear();
-            for (auto const& setting : fan_doc["curves"].as<JsonArray>()) {
-                m_SensorSettings[fan_id].fan_speed_curve.push_back({setting["temp"].as<float>(), setting["fan"].as<int>()});
+            LoadFanSettings(fans[i], fan_doc, fan_id);
+        }
+    }
+
+    const bool loaded = UpdateControllerConfig([&](ControllerConfig& config) {
+        for (int i = 0; i < ACTIVE_FANS; i++) config.fans[i] = fans[i];
+    });
+    if (!loaded) {
+        // Keep every fan that is valid on its own, only the rejected ones run defaults
+        for (int i = 0; i < ACTIVE_FANS; i++) {
+            if (!UpdateControllerConfig([&](ControllerConfig& config) { config.fans[i] = fans[i]; })) {
+                Serial.printf("Saved settings for FAN_%d rejected, running defaults.\n", a_FanIds[i]);
             }
         }
     }
+    ApplyInitialFanSpeeds();
+}
+
+void LoadFanSettings(TemperatureSensorSettings& settings, JsonDocument& fan_doc, int fan_id) {
+    const char* sensor = fan_doc["sensor"] | "";
+    settings.sensor_channel = ParseTemperatureSensor(sensor);
+    if (settings.sensor_channel < 0) {
+        // As before sensors were indexed: anything but TEMP_1 follows TEMP_2
+        settings.sensor_channel = 1;
+        Serial.printf("FAN_%d: Unknown sensor \"%s\", following %s.\n", fan_id, sensor, TemperatureSensorName(settings.sensor_channel));
+    }
+    settings.temperature_alarm_threshold = fan_doc["temp_th"].as<int>();
+    settings.rpm_alarm_threshold = fan_doc["duty_th"].as<int>();
+    JsonVariant ramp_up = fan_doc["ramp_up"];
+    JsonVariant ramp_down = fan_doc["ramp_down"];
+    if (!ramp_up.isNull() || !ramp_down.isNull()) {
+        // as<float>() also parses the strings older versions of fans.html saved
+        settings.ramp_up_rate = constrain(ramp_up.isNull() ? FAN_RAMP_DEFAULT_UP_RATE : ramp_up.as<float>(), 0.1f, 100.0f);
+        settings.ramp_down_rate = constrain(ramp_down.isNull() ? FAN_RAMP_DEFAULT_DOWN_RATE : ramp_down.as<float>(), 0.1f, 100.0f);
+    } else if (fan_doc["sud_dur"].as<int>() > 0) {
+        // Settings saved before ramp rates: the old step spread a change over sud_dur seconds
+        settings.ramp_up_rate = 100.0f / fan_doc["sud_dur"].as<int>();
+        settings.ramp_down_rate = settings.ramp_up_rate;
+    }
+    settings.fan_speed_curve.clear();
+    for (auto const& setting : fan_doc["curves"].as<JsonArray>()) {
+        settings.fan_speed_curve.push_back({setting["temp"].as<float>(), setting["fan"].as<int>()});
+    }
+    settings.hysteresis = fan_doc["hyst"] | settings.hysteresis;
+    settings.control_mode = ParseFanControlMode(fan_doc["mode"] | "curve");
+    LoadPidSettings(fan_doc["pid"], settings.control_mode, settings.pid);
+    LoadFilterSettings(fan_doc["temp_filter"], settings.temperature_filter);
+    LoadFilterSettings(fan_doc["rpm_filter"], settings.rpm_filter);
+}
 
-    // Set initial fan speeds based on current temps
-    const double t1 = ReadTemperature(0);
-    const double t2 = ReadTemperature(1);
+void LoadFilterSettings(JsonVariantConst source, FilterSettings& settings) {
+    // Missing keys keep the current value, so older saved curves load unchanged
+    uint8_t median_window = source["median"] | settings.median_window;
+    settings.median_window = constrain(median_window, 1, FILTER_MAX_MEDIAN_WINDOW);
+    settings.ema_alpha = constrain(source["ema"] | settings.ema_alpha, 0.01f, 1.0f);
+    settings.spike_threshold = source["spike"] | settings.spike_threshold;
+}
 
-    for (int i = 0; i < ACTIVE_FANS; i++) {
-        int fan_id = a_FanIds[i];
-        const double temp = (m_SensorSettings[fan_id].sensor_name == "TEMP_1") ? t1 : t2;
-        const int target_speed = (temp > 0) ? CalculateFanSpeed(fan_id, temp) : MapFanPercentToPwm(25);
+void SaveFilterSettings(JsonObject target, const FilterSettings& settings) {
+    target["median"] = settings.median_window;
+    target["ema"] = settings.ema_alpha;
+    target["spike"] = settings.spike_threshold;
+}
 
-        m_TargetFanRpm[fan_id].current_rpm = target_speed;
-        m_TargetFanRpm[fan_id].target_rpm = target_speed;
-        ledcWrite(PIN_FAN_MAP[fan_id].pwm_pin, target_speed);
+void LoadPidSettings(JsonVariantConst source, FanControlMode mode, PidSettings& settings) {
+    // Temperature and RPM loops need gains orders of magnitude apart, so a
+    // missing key falls back to the default for the selected mode
+    PidSettings defaults;
+    if (mode == FanControlMode::PidRpm) {
+        defaults.setpoint = PID_RPM_DEFAULT_SETPOINT;
+        defaults.kp = PID_RPM_DEFAULT_KP;
+        defaults.ki = PID_RPM_DEFAULT_KI;
+        defaults.kd = PID_RPM_DEFAULT_KD;
     }
+    settings.setpoint = source["sp"] | defaults.setpoint;
+    settings.kp = source["kp"] | defaults.kp;
+    settings.ki = source["ki"] | defaults.ki;
+    settings.kd = source["kd"] | defaults.kd;
+    settings.min_duty = constrain(source["min"] | defaults.min_duty, 0, 255);
+    settings.max_duty = constrain(source["max"] | defaults.max_duty, settings.min_duty, 255);
+}
+
+void SavePidSettings(JsonObject target, const PidSettings& settings) {
+    target["sp"] = settings.setpoint;
+    target["kp"] = settings.kp;
+    target["ki"] = settings.ki;
+    target["kd"] = settings.kd;
+    target["min"] = settings.min_duty;
+    target["max"] = settings.max_duty;
 }
 
 
@@ -193,8 +324,7 @@ void setup() {
     }
     Serial.println("LittleFS Mounted.");
 
-    Wire.setPins(PIN_SDA, PIN_SCL);
-    Wire.begin();
+    InitializeI2cBus();
 
     // Reset button task needs to be started earlier
     xTaskCreate(MonitorButtonTask, "MonitorButton", 4096, NULL, 1, NULL);
@@ -203,7 +333,8 @@ void setup() {
     InitializeOutputs();
     InitializeInputs();
     InitializeScreen();
-    InitializeWifi();
+    InitializeWifi(); // Does not wait for the network, fan control starts regardless
+    xTaskCreate(WifiTask, "Wifi", 4096, NULL, 1, NULL);
     InitializeHttpServer();
 
     if (!systemSettings.setup_done) {
@@ -213,7 +344,7 @@ void setup() {
         oledDisplay.setCursor(0, 0);
         oledDisplay.printf("   ### SETUP ###\n\n");
         oledDisplay.printf("SSID: WaKu-ctl\nIP: %s", AP_LOCAL_IP.toString().c_str());
-        oledDisplay.display();
+        HalDisplayFlush();
         
         return; // Wait for user to complete setup via web
     }
@@ -224,20 +355,34 @@ void setup() {
 
 void RunPostSetup() {
     Serial.println("Running Post-Setup...");
-    InitializeMqttClient();
-    //InitializeNtpTime(); // Optional, not used for now
     InitializeAdc();
+    InitializeSampler();
     InitializeFanCurves();
     InitializeLeds();
+    StartHistory();
+    StartFlashLog("/littlefs/log");
+    StartMqttQueue();
     InitializeTasks();
+    ApplySystemSettings();
     b_BootCompleted = true;
     Serial.println("Post-Setup Complete.");
 }
 
 void loop() {
+    if (s_SettingsSaved.exchange(false)) {
+        if (b_BootCompleted) {
+            ApplySystemSettings();
+        } else {
+            RunPostSetup(); // First save after the setup AP
+        }
+    }
     if(b_BootCompleted) {
         taskScheduler.execute();
-        LoopMqttClient();
+        // The MQTT command channel changes the interval from its own task, the scheduler is only touched here
+        const unsigned long telemetry_interval = systemSettings.telemetry_interval;
+        if (gSendTelemetryTask && gSendTelemetryTask->getInterval() != telemetry_interval) {
+            gSendTelemetryTask->setInterval(telemetry_interval);
+        }
     }
     vTaskDelay(pdMS_TO_TICKS(250)); // Yield, let tasks run
 }
@@ -253,6 +398,7 @@ void MonitorButtonTask(void *pvParameters) {
             } else if (millis() - gHoldButtonCounter >= 5000) {
                  Serial.println("Holding > 5s. Clearing preferences & rebooting!");
                  ClearPreferences();
+                 FlushFlashLog();
                  delay(1000);
                  esp_restart();
             }
@@ -273,45 +419,22 @@ void MonitorButtonTask(void *pvParameters) {
     }     
 }   
 
-void MonitorStatesTask(void *pvParameters) {
+void SampleTemperaturesTask(void *pvParameters) {
+    StartTemperatureSampler();
     while (true) {
-        // --- Monitor Alarms ---
-        bool temp_alarm_active = false;
-        bool rpm_alarm_active = false;
-        const double t1 = ReadTemperature(0);
-        const double t2 = ReadTemperature(1);
-
-        for (int i = 0; i < ACTIVE_FANS; ++i) {
-            int fan_id = a_FanIds[i];
-            const auto& settings = m_SensorSettings[fan_id];
-            const double temp = (settings.sensor_name == "TEMP_1") ? t1 : t2;
-            const unsigned long current_rpm = a_CurrentFanSpeedsRpm[i];
-
-            // Temperature Alarm
-            if (temp > 0 && settings.temperature_alarm_threshold > 0 && temp >= settings.temperature_alarm_threshold) {
-                temp_alarm_active = true;
-                if (!b_TempAlarmFiring) Serial.printf("ALARM: Temp high on %s (%.1fC)\n", settings.sensor_name.c_str(), temp);
-            }
-
-            // RPM Alarm (only if threshold is set, > 0)
-            if (settings.rpm_alarm_threshold >= 0 && current_rpm < (unsigned long)settings.rpm_alarm_threshold) {
-                rpm_alarm_active = true;
-                if (!b_RpmAlarmFiring) Serial.printf("ALARM: RPM low on FAN_%d (%lu RPM)\n", fan_id, current_rpm);
-            }
+        HalAdcWaitReady(ADC_SAMPLE_INTERVAL_MS);
+        if (PollTemperatureSampler()) {
+            vTaskDelay(pdMS_TO_TICKS(ADC_SAMPLE_INTERVAL_MS)); // Next channel converts meanwhile
         }
-
-        b_TempAlarmFiring = temp_alarm_active;
-        b_RpmAlarmFiring = rpm_alarm_active;
-
-        vTaskDelay(pdMS_TO_TICKS(250)); // Check ~4 times a second
     }
 }
 
 void PlayAlarmsTask(void *pvParameters) {
     while (true) {
-        if (b_TempAlarmFiring || b_RpmAlarmFiring) {
+        const ControllerState state = ReadControllerState();
+        if (state.temp_alarm_firing || state.rpm_alarm_firing) {
             // Play sound (Beep pattern)
-            tone(PIN_BUZZER, b_TempAlarmFiring ? 1000 : 4000, 500);
+            tone(PIN_BUZZER, state.temp_alarm_firing ? 1000 : 4000, 500);
             vTaskDelay(pdMS_TO_TICKS(1000));
         } else {
             noTone(PIN_BUZZER);
@@ -321,77 +444,55 @@ void PlayAlarmsTask(void *pvParameters) {
 }
 
 void ReadTemperaturesTask(void *pvParameters) {
+    TickType_t last_wake_time = xTaskGetTickCount();
+    unsigned long since_control_tick_ms = CONTROL_LOOP_INTERVAL_MS;
     while (true) {
-
-        const double t1 = ReadTemperature(0);
-        const double t2 = ReadTemperature(1);
-
-        if (DEBUG_ENABLED && DEBUG_DATA_ENABLED) {
-            Serial.printf("T1: %.2f C; T2: %.2f C\n", t1, t2);
+        // Wakes at the stream rate while the host streams, the control loop still runs every CONTROL_LOOP_INTERVAL_MS
+        const unsigned long period_ms = UsbStreamPeriodMs();
+        if (since_control_tick_ms >= CONTROL_LOOP_INTERVAL_MS) {
+            RunFanControlTick();
+            RecordHistorySample(ReadControllerState());
+            since_control_tick_ms = 0;
         }
+        CaptureUsbStreamSample(); // Never blocks, drops the sample if the USB task is behind
+        since_control_tick_ms += period_ms;
+        vTaskDelayUntil(&last_wake_time, pdMS_TO_TICKS(period_ms)); // Ramps advance every control tick
+    }
+}
 
-        for (int i = 0; i < ACTIVE_FANS; ++i) {
-            int fan_id = a_FanIds[i];
-            a_CurrentFanSpeedsRpm[i] = ReadFanRpm(i); // Use index 'i' for ReadFanRpm
-
-            const auto& settings = m_SensorSettings[fan_id];
-            const double temp = (settings.sensor_name == "TEMP_1") ? t1 : t2;
-
-            if (temp <= 0) {
-                if (DEBUG_ENABLED && DEBUG_DATA_ENABLED) Serial.printf("Temp sensor N/A for FAN_%d. Skipping.\n", fan_id);
-                continue; // Skip if temp sensor not working/connected
-            }
-
-            auto& target = m_TargetFanRpm[fan_id];
-            int new_target_pwm = CalculateFanSpeed(fan_id, temp);
-
-            if (new_target_pwm != target.target_rpm && !target.is_adjusting) {
-                target.target_rpm = new_target_pwm;
-                target.step_value = (target.target_rpm - target.current_rpm) / settings.step_duration_seconds;
-                if (target.step_value == 0 && target.target_rpm != target.current_rpm) {
-                    target.step_value = (target.target_rpm > target.current_rpm) ? 1 : -1;
-                }
-
-                if (target.step_value != 0) {
-                    target.start_time_ms = millis();
-                    target.is_adjusting = true;
-                    Serial.printf("FAN_%d: Adjusting %d -> %d (Step: %d)\n", fan_id, target.current_rpm, target.target_rpm, target.step_value);
-                } else {
-                     target.current_rpm = target.target_rpm; // No change needed
-                }
-            }
-
-            if (target.is_adjusting && (millis() - target.start_time_ms >= 1000)) {
-                target.start_time_ms = millis();
-                target.current_rpm += target.step_value;
-
-                // Clamp and check if target reached
-                bool reached = false;
-                if (target.step_value > 0 && target.current_rpm >= target.target_rpm) {
-                    target.current_rpm = target.target_rpm;
-                    reached = true;
-                } else if (target.step_value < 0 && target.current_rpm <= target.target_rpm) {
-                    target.current_rpm = target.target_rpm;
-                    reached = true;
-                }
+void FlashLogTask(void *pvParameters) {
+    TickType_t last_wake_time = xTaskGetTickCount();
+    while (true) {
+        // Keeps one point per FLASH_LOG_INTERVAL_S; flash writes and compaction stay out of the control task
+        RecordFlashLogSample(ReadControllerState());
+        vTaskDelayUntil(&last_wake_time, pdMS_TO_TICKS(1000));
+    }
+}
 
-                if (reached) {
-                    Serial.printf("FAN_%d: Reached target %d\n", fan_id, target.target_rpm);
-                    target.is_adjusting = false;
-                }
-                ledcWrite(PIN_FAN_MAP[fan_id].pwm_pin, target.current_rpm);
+void WifiTask(void *pvParameters) {
+    while (true) {
+        RunWifiStateMachine();
+        vTaskDelay(pdMS_TO_TICKS(WIFI_STATE_INTERVAL_MS));
+    }
+}
 
-            } else if (!target.is_adjusting) {
-                // Ensure it stays at target if not adjusting
-                ledcWrite(PIN_FAN_MAP[fan_id].pwm_pin, target.target_rpm);
-            }
+void MqttTask(void *pvParameters) {
+    while (true) {
+        RunMqttClient(); // Connect attempts block only this task
+        vTaskDelay(pdMS_TO_TICKS(MQTT_LOOP_INTERVAL_MS));
+    }
+}
 
-            if (DEBUG_ENABLED && DEBUG_DATA_ENABLED) {
-                Serial.printf("FAN_%d RPM: %lu (Target PWM: %d, Current PWM: %d)\n",
-                              fan_id, a_CurrentFanSpeedsRpm[i], target.target_rpm, target.current_rpm);
-            }
+void WebEventsTask(void *pvParameters) {
+    TickType_t last_wake_time = xTaskGetTickCount();
+    while (true) {
+        vTaskDelayUntil(&last_wake_time, pdMS_TO_TICKS(WEB_EVENTS_INTERVAL_MS));
+        if (webEvents.count() == 0) {
+            continue; // Nobody listening, skip the serialization
         }
-        vTaskDelay(pdMS_TO_TICKS(250)); // Read temps/adjust fans twice a second
+        // The tick's shared snapshot; the event source queues one message for every client
+        const std::shared_ptr<const TelemetrySnapshot> snapshot = AcquireTelemetrySnapshot();
+        webEvents.send(snapshot->Json(TelemetrySink::Push), "telemetry", millis());
     }
 }
 
@@ -406,121 +507,120 @@ void PlayLedsTask(void *pvParameters) {
 
 void DisplayDataTask(void *pvParameters) {
     while (true) {
-        oledDisplay.clearDisplay();
-        oledDisplay.setCursor(0, 0);
-
-        switch (currentScreen) {
-            case ScreenView::Overview:
-                oledDisplay.printf("   ### OVERVIEW ###\n\n");
-                oledDisplay.printf("Mode: %s\n", systemSettings.offline_mode ? "Offline" : "Connected");
-                oledDisplay.printf("IP: %s\n", systemSettings.offline_mode ? AP_LOCAL_IP.toString().c_str() : WiFi.localIP().toString().c_str());
-                oledDisplay.printf("Units: %s\n", systemSettings.units.c_str());
-                oledDisplay.printf("Temp Alarm: %s\n", b_TempAlarmFiring ? "Yes" : "No");
-                oledDisplay.printf("RPM Alarm: %s\n", b_RpmAlarmFiring ? "Yes" : "No");
-                oledDisplay.setCursor(50, 56);
-                oledDisplay.printf("o...");
-                break;
-
-            case ScreenView::Temperatures:
-                {
-                    double t1 = ReadTemperature(0);
-                    double t2 = ReadTemperature(1);
-
-                    if (systemSettings.units == "F") {
-                        if (t1 > -90.0) t1 = (t1 * 1.8) + 32;
-                        if (t2 > -90.0) t2 = (t2 * 1.8) + 32;
-                    }
-
-                    oledDisplay.printf(" ### TEMPERATURE ###\n\n");
-                    oledDisplay.printf("TEMP1: %s\n", ((t1 < 0 && systemSettings.units == "C") || t1 < 32 && systemSettings.units == "F") ? "N/A" : (String(t1, 1) + systemSettings.units).c_str());
-                    oledDisplay.printf("TEMP2: %s\n", ((t2 < 0 && systemSettings.units == "C") || t2 < 32 && systemSettings.units == "F") ? "N/A" : (String(t2, 1) + systemSettings.units).c_str());
-                    oledDisplay.setCursor(50, 56);
-                    oledDisplay.printf(".o..");
-                }
-                break;
-
-            case ScreenView::Fans:
-                oledDisplay.printf("  ### FAN SPEED ### \n\n");
-                for (int i = 0; i < ACTIVE_FANS; i++) {
-                    oledDisplay.printf("FAN %d: %4lu RPM\n", a_FanIds[i], a_CurrentFanSpeedsRpm[i]);
-                }
-                oledDisplay.setCursor(50, 56);
-                oledDisplay.printf("..o.");
-                break;
-
-            case ScreenView::Rgb:
-                oledDisplay.printf("  ### RGB MODE ### \n\n");
-                for (const auto& [key, value] : m_LedSettings) {
-                    std::string fkey = "LED_" + std::to_string(key);
-                    std::string led_mode = "Unknown";
-                    switch (value.mode) {
-                        case 0: led_mode = "Off"; break;
-                        case 1: led_mode = "Static"; break;
-                        case 2: led_mode = "Grad/Wave"; break;
-                        case 3: led_mode = "Grad/Move"; break;
-                        case 4: led_mode = "Rainbow"; break;
-                        case 5: led_mode = "Passthrough"; break;
-                    }
-                    oledDisplay.printf("%s: %s\n", fkey.c_str(), led_mode.c_str());
-                }
-                oledDisplay.setCursor(50, 56);
-                oledDisplay.printf("...o");
-                break;
-        }
-
-        oledDisplay.display();
+        String ip_address = WifiAddress().toString();
+        RenderScreen(currentScreen, ip_address.c_str());
         vTaskDelay(pdMS_TO_TICKS(1000)); // Update display once a second
     }
 }
 
 void NativeUsbTelemetryTask(void *pvParameters) {
     TickType_t last_wake_time = xTaskGetTickCount();
-    const TickType_t frequency = pdMS_TO_TICKS(1000); // Send every 1 second
+    unsigned long last_telemetry_ms = 0;
 
     while (true) {
-        vTaskDelayUntil(&last_wake_time, frequency);
-        SendUsbTelemetry();
+        vTaskDelayUntil(&last_wake_time, pdMS_TO_TICKS(USB_STREAM_FLUSH_INTERVAL_MS));
+        if (!USBTelemetryPort) {
+            s_UsbTelemetryMode = UsbTelemetryMode::Json; // The next host negotiates again
+            StopUsbStream();
+            continue;
+        }
+        PollUsbCommands();
+        FlushUsbStream();
+        if (millis() - last_telemetry_ms >= 1000) { // Send every 1 second
+            last_telemetry_ms = millis();
+            SendUsbTelemetry();
+        }
     }
 }
 
 // --- MQTT & Telemetry ---
 
 void SendUsbTelemetry() {
-    if (USBTelemetryPort) {
-        std::string payload = PrepareTelemetryPayload("usb_stream");
-        size_t sent_bytes = USBTelemetryPort.println(payload.c_str());
-        if (DEBUG_ENABLED && DEBUG_DATA_ENABLED) {
-            Serial.printf("USB: Sent %d bytes.\n", sent_bytes);
-        }
+    size_t sent_bytes = 0;
+    if (s_UsbTelemetryMode == UsbTelemetryMode::Binary) {
+        uint8_t frame[USB_FRAME_MAX_BYTES];
+        // Sequence numbers are per connection, so the frame is built here from the shared state
+        size_t frame_length = WriteUsbTelemetryFrame(frame, sizeof(frame), AcquireTelemetrySnapshot()->state, s_UsbSequence++);
+        sent_bytes = USBTelemetryPort.write(frame, frame_length);
+    } else {
+        const std::shared_ptr<const TelemetrySnapshot> snapshot = AcquireTelemetrySnapshot();
+        sent_bytes = USBTelemetryPort.println(snapshot->Json(TelemetrySink::Usb));
+    }
+    if (DEBUG_ENABLED && DEBUG_DATA_ENABLED) {
+        Serial.printf("USB: Sent %d bytes.\n", sent_bytes);
     }
 }
 
-std::string PrepareTelemetryPayload(const std::string& event) {
-    double t1 = ReadTemperature(0);
-    double t2 = ReadTemperature(1);
+void PollUsbCommands() {
+    static char line[USB_COMMAND_MAX_BYTES];
+    static size_t line_length = 0;
 
-    if (systemSettings.units == "F") {
-        if (t1 > -90.0) t1 = (t1 * 1.8) + 32;
-        if (t2 > -90.0) t2 = (t2 * 1.8) + 32;
+    while (USBTelemetryPort.available() > 0) {
+        char c = USBTelemetryPort.read();
+        if (c == '\r') continue;
+        if (c != '\n') {
+            if (line_length < sizeof(line) - 1) line[line_length++] = c;
+            continue;
+        }
+        line[line_length] = '\0';
+        line_length = 0;
+
+        uint16_t rate_hz = 0;
+        if (ParseUsbStreamCommand(line, rate_hz)) {
+            const bool starting = GetUsbStreamRate() == 0;
+            if (s_UsbTelemetryMode != UsbTelemetryMode::Binary || !SetUsbStreamRate(rate_hz)) {
+                Serial.printf("USB: Stream rate %u Hz rejected\n", rate_hz);
+                continue;
+            }
+            if (starting) DiscardUsbStreamSamples(); // Nothing left over from an earlier stream
+            Serial.printf("USB: Streaming at %u Hz\n", rate_hz);
+            continue;
+        }
+
+        UsbTelemetryMode requested = ParseUsbCommand(line, s_UsbTelemetryMode);
+        if (requested == UsbTelemetryMode::Binary && s_UsbTelemetryMode != UsbTelemetryMode::Binary) {
+            // The delimiter ends whatever JSON the host has half read, then the Hello frame
+            uint8_t frame[USB_FRAME_MAX_BYTES + 1] = {0x00};
+            size_t frame_length = WriteUsbHelloFrame(frame + 1, sizeof(frame) - 1);
+            USBTelemetryPort.write(frame, frame_length + 1);
+        }
+        if (requested != s_UsbTelemetryMode) {
+            Serial.printf("USB: Telemetry mode %s\n", requested == UsbTelemetryMode::Binary ? "binary" : "JSON");
+        }
+        if (requested == UsbTelemetryMode::Json) StopUsbStream(); // Stream frames are binary only
+        s_UsbTelemetryMode = requested;
     }
+}
+
+void FlushUsbStream() {
+    static uint8_t frames[USB_STREAM_FLUSH_MAX_BYTES]; // USB task only, kept off its small stack
+    static uint32_t reported_drops = 0;
 
-    JsonDocument payload;
-    payload["client_id"] = espChipIdStr;
-    payload["event"] = event;
-    payload["units"] = systemSettings.units;
-    JsonObject data = payload["data"].to<JsonObject>();
-    
-    data["temperature1"] = (t1 > -90.0) ? String(t1, 1).toFloat() : 0.0f;
-    data["temperature2"] = (t2 > -90.0) ? String(t2, 1).toFloat() : 0.0f;
+    if (s_UsbTelemetryMode != UsbTelemetryMode::Binary || GetUsbStreamRate() == 0) {
+        return;
+    }
+    // Only write what the CDC buffer takes now, the rest stays queued for the next flush
+    size_t room = USBTelemetryPort.availableForWrite();
+    if (room > sizeof(frames)) room = sizeof(frames);
+    size_t length = WriteUsbStreamFrames(frames, room);
+    if (length > 0) {
+        USBTelemetryPort.write(frames, length);
+    }
 
-    for (int i = 0; i < ACTIVE_FANS; ++i) {
-        std::string fkey = "FAN_" + std::to_string(a_FanIds[i]);
-        data[fkey] = a_CurrentFanSpeedsRpm[i];
+    uint32_t drops = UsbStreamDroppedSamples();
+    if (drops != reported_drops && DEBUG_ENABLED) {
+        Serial.printf("USB: %u stream samples dropped so far\n", drops);
     }
+    reported_drops = drops;
+}
 
-    String buffer;
-    serializeJson(payload, buffer);
-    return buffer.c_str();
+void StopUsbStream() {
+    if (GetUsbStreamRate() == 0) {
+        return;
+    }
+    SetUsbStreamRate(0);
+    DiscardUsbStreamSamples();
+    Serial.println("USB: Streaming stopped");
 }
 
 // --- HTTP Server ---
@@ -536,33 +636,23 @@ void HandleHttpNotFound(AsyncWebServerRequest *request) {
     }
 }
 
-void StreamFile(const String& path, const String& mimetype, bool cache, AsyncWebServerRequest *request) {
-    if (LittleFS.exists(path)) {
-        AsyncWebServerResponse *response = request->beginResponse(LittleFS, path, mimetype);
-        if (cache) {
-            response->addHeader("Cache-Control", "max-age=60, immutable");
-        }
-        request->send(response);
-    } else {
-        Serial.printf("HTTP: File %s not found!\n", path.c_str());
-        request->send(404, "text/plain", "File Not Found");
-    }
-}
-
 void InitializeHttpServer() {
+    LoadWebAssets();
+
     if (systemSettings.offline_mode || !systemSettings.setup_done) {
         dnsServer.start(53, "*", AP_LOCAL_IP);
-        // Captive Portal Handlers
-        webServer.on("/connecttest.txt", [](AsyncWebServerRequest *request) { request->redirect("http://logout.net"); });
-        webServer.on("/wpad.dat", [](AsyncWebServerRequest *request) { request->send(404); });
-        webServer.on("/generate_204", [](AsyncWebServerRequest *request) { request->redirect(AP_LOCAL_URL); });
-        webServer.on("/redirect", [](AsyncWebServerRequest *request) { request->redirect(AP_LOCAL_URL); });
-        webServer.on("/hotspot-detect.html", [](AsyncWebServerRequest *request) { request->redirect(AP_LOCAL_URL); });
-        webServer.on("/canonical.html", [](AsyncWebServerRequest *request) { request->redirect(AP_LOCAL_URL); });
-        webServer.on("/success.txt", [](AsyncWebServerRequest *request) { request->send(200); });
-        webServer.on("/ncsi.txt", [](AsyncWebServerRequest *request) { request->redirect(AP_LOCAL_URL); });
-        webServer.on("/favicon.ico", [](AsyncWebServerRequest *request) { request->send(404); });
     }
+    // Captive Portal Handlers, also registered in station mode for the fallback
+    // AP, which starts its DNS server in wifi_manager.cpp
+    webServer.on("/connecttest.txt", [](AsyncWebServerRequest *request) { request->redirect("http://logout.net"); });
+    webServer.on("/wpad.dat", [](AsyncWebServerRequest *request) { request->send(404); });
+    webServer.on("/generate_204", [](AsyncWebServerRequest *request) { request->redirect(AP_LOCAL_URL); });
+    webServer.on("/redirect", [](AsyncWebServerRequest *request) { request->redirect(AP_LOCAL_URL); });
+    webServer.on("/hotspot-detect.html", [](AsyncWebServerRequest *request) { request->redirect(AP_LOCAL_URL); });
+    webServer.on("/canonical.html", [](AsyncWebServerRequest *request) { request->redirect(AP_LOCAL_URL); });
+    webServer.on("/success.txt", [](AsyncWebServerRequest *request) { request->send(200); });
+    webServer.on("/ncsi.txt", [](AsyncWebServerRequest *request) { request->redirect(AP_LOCAL_URL); });
+    webServer.on("/favicon.ico", [](AsyncWebServerRequest *request) { request->send(404); });
 
     webServer.onNotFound(HandleHttpNotFound);
 
@@ -574,7 +664,7 @@ void InitializeHttpServer() {
         if (!systemSettings.setup_done) {
             request->redirect("/setup");
         } else {
-            StreamFile("/index.html", "text/html", false, request);
+            ServeWebAsset(request, "/index.html", "text/html", 0);
         }
     });
 
@@ -582,21 +672,23 @@ void InitializeHttpServer() {
         if (systemSettings.setup_done) {
             request->redirect("/");
         } else {
-            StreamFile("/setup.html", "text/html", false, request);
+            ServeWebAsset(request, "/setup.html", "text/html", 0);
         }
     });
 
-    webServer.on("/fans", HTTP_GET, [](AsyncWebServerRequest *request) { StreamFile("/fans.html", "text/html", false, request); });
-    webServer.on("/settings", HTTP_GET, [](AsyncWebServerRequest *request) { StreamFile("/settings.html", "text/html", false, request); });
-    webServer.on("/rgb", HTTP_GET, [](AsyncWebServerRequest *request) { StreamFile("/rgb.html", "text/html", false, request); });
-    webServer.on("/all-jquery-deps.min.js", [](AsyncWebServerRequest *request) { StreamFile("/all-jquery-deps.min.js", "text/javascript", true, request); });
-    webServer.on("/logo.png", [](AsyncWebServerRequest *request) { StreamFile("/logo.png", "text/image", true, request); });
+    webServer.on("/fans", HTTP_GET, [](AsyncWebServerRequest *request) { ServeWebAsset(request, "/fans.html", "text/html", 0); });
+    webServer.on("/settings", HTTP_GET, [](AsyncWebServerRequest *request) { ServeWebAsset(request, "/settings.html", "text/html", 0); });
+    webServer.on("/rgb", HTTP_GET, [](AsyncWebServerRequest *request) { ServeWebAsset(request, "/rgb.html", "text/html", 0); });
+    webServer.on("/all-jquery-deps.min.js", [](AsyncWebServerRequest *request) { ServeWebAsset(request, "/all-jquery-deps.min.js", "text/javascript", WEB_ASSET_MAX_AGE_S); });
+    webServer.on("/logo.png", [](AsyncWebServerRequest *request) { ServeWebAsset(request, "/logo.png", "image/png", WEB_ASSET_MAX_AGE_S); });
 
 
     // API: Get RGB settings
     webServer.on("/get-rgb", HTTP_GET, [](AsyncWebServerRequest *request) {
         JsonDocument doc;
-        for (const auto& [key, value] : m_LedSettings) {
+        const ControllerConfigGuard config = ReadControllerConfig();
+        for (int key = 0; key < ACTIVE_LED_STRIPS; key++) {
+            const LedSettings& value = config->leds[key];
             String fkey = "LED_" + String(key);
             doc[fkey]["mode"] = value.mode;
             doc[fkey]["speed"] = value.speed;
@@ -611,25 +703,34 @@ void InitializeHttpServer() {
 
     // API: Save RGB settings
     webServer.on("/save-rgb", HTTP_POST, [](AsyncWebServerRequest *request) {
-        int params = request->params();
-        for(int i=0; i < params; i++){
-            const AsyncWebParameter* p = request->getParam(i);
-            String led_name = p->name();
-            String led_data = p->value();
-            int led_index = led_name.substring(4).toInt(); // Assumes "LED_X" format
-
-            if (m_LedSettings.count(led_index)) {
-                 Serial.printf("Saving %s: %s\n", led_name.c_str(), led_data.c_str());
-                 systemPreferences.putString(led_name.c_str(), led_data);
-                 JsonDocument led_doc;
-                 deserializeJson(led_doc, led_data);
-                 m_LedSettings[led_index].prev_mode =  m_LedSettings[led_index].mode;
-                 m_LedSettings[led_index].mode = led_doc["mode"];
-                 m_LedSettings[led_index].speed = led_doc["speed"];
-                 m_LedSettings[led_index].start_color = led_doc["start_color"];
-                 m_LedSettings[led_index].end_color = led_doc["end_color"];
-                 m_LedSettings[led_index].num_leds = led_doc["num_leds"];
+        // Every strip in the request lands in one new version, or none does
+        std::vector<const AsyncWebParameter*> saved;
+        const bool valid = UpdateControllerConfig([&](ControllerConfig& config) {
+            int params = request->params();
+            for(int i=0; i < params; i++){
+                const AsyncWebParameter* p = request->getParam(i);
+                int led_index = p->name().substring(4).toInt(); // Assumes "LED_X" format
+
+                if (led_index >= 0 && led_index < ACTIVE_LED_STRIPS) {
+                     JsonDocument led_doc;
+                     deserializeJson(led_doc, p->value());
+                     LedSettings& led = config.leds[led_index];
+                     led.mode = led_doc["mode"];
+                     led.speed = led_doc["speed"];
+                     led.start_color = led_doc["start_color"];
+                     led.end_color = led_doc["end_color"];
+                     led.num_leds = led_doc["num_leds"];
+                     saved.push_back(p);
+                }
             }
+        });
+        if (!valid) {
+            request->send(400, "application/json", "{\"status\": \"led_invalid\"}");
+            return;
+        }
+        for (const AsyncWebParameter* p : saved) {
+            Serial.printf("Saving %s: %s\n", p->name().c_str(), p->value().c_str());
+            systemPreferences.putString(p->name().c_str(), p->value());
         }
         request->send(200, "application/json", "{\"status\": \"led_saved\"}");
     });
@@ -651,7 +752,7 @@ void InitializeHttpServer() {
         doc["ssid"] = systemSettings.ssid;
         doc["password"] = systemSettings.password; // Note: Sending password - consider security
         doc["hostname"] = systemSettings.hostname;
-        doc["tel_itv"] = systemSettings.telemetry_interval;
+        doc["tel_itv"] = systemSettings.telemetry_interval.load();
         doc["setup_done"] = systemSettings.setup_done;
         doc["offline_mode"] = systemSettings.offline_mode;
         doc["units"] = systemSettings.units;
@@ -693,13 +794,13 @@ void InitializeHttpServer() {
         if (needs_reboot) {
             request->onDisconnect([]() {
                 Serial.println("Settings saved, rebooting now...");
+                FlushFlashLog();
                 delay(1000);
                 esp_restart();
             });
             return;
-        } 
-        
-        RunPostSetup();
+        }
+        s_SettingsSaved = true; // loop() applies them, the web server task never starts tasks or waits
     });
 
     // API: Clear Settings
@@ -708,6 +809,7 @@ void InitializeHttpServer() {
         request->send(200, "application/json", "{\"status\": \"settings_cleared_restarting\"}");
         request->onDisconnect([]() {
             Serial.println("Settings cleared, rebooting now...");
+            FlushFlashLog();
             delay(1000);
             esp_restart();
         });
@@ -716,13 +818,21 @@ void InitializeHttpServer() {
     // API: Get Fan Curves
     webServer.on("/get-curves", HTTP_GET, [](AsyncWebServerRequest *request) {
         JsonDocument doc;
-        for (const auto& [key, value] : m_SensorSettings) {
-            String fkey = "FAN_" + String(key);
-            doc[fkey]["sensor"] = value.sensor_name;
+        const ControllerConfigGuard config = ReadControllerConfig();
+        for (int i = 0; i < ACTIVE_FANS; i++) {
+            const TemperatureSensorSettings& value = config->fans[i];
+            String fkey = "FAN_" + String(a_FanIds[i]);
+            doc[fkey]["sensor"] = TemperatureSensorName(value.sensor_channel);
             doc[fkey]["temp_th"] = value.temperature_alarm_threshold;
             doc[fkey]["duty_th"] = value.rpm_alarm_threshold;
-            doc[fkey]["sud_dur"] = value.step_duration_seconds;
+            doc[fkey]["ramp_up"] = value.ramp_up_rate;
+            doc[fkey]["ramp_down"] = value.ramp_down_rate;
             doc[fkey]["units"] = systemSettings.units;
+            doc[fkey]["hyst"] = value.hysteresis;
+            doc[fkey]["mode"] = FanControlModeName(value.control_mode);
+            SavePidSettings(doc[fkey]["pid"].to<JsonObject>(), value.pid);
+            SaveFilterSettings(doc[fkey]["temp_filter"].to<JsonObject>(), value.temperature_filter);
+            SaveFilterSettings(doc[fkey]["rpm_filter"].to<JsonObject>(), value.rpm_filter);
             JsonArray curves = doc[fkey]["curves"].to<JsonArray>();
             for (const auto& setting : value.fan_speed_curve) {
                 JsonObject point = curves.add<JsonObject>();
@@ -737,28 +847,29 @@ void InitializeHttpServer() {
 
     // API: Save Fan Curves
     webServer.on("/save-curves", HTTP_POST, [](AsyncWebServerRequest *request) {
-        int params = request->params();
-        for (int i = 0; i < params; i++) {
-            const AsyncWebParameter* p = request->getParam(i);
-            String fan_name = p->name();
-            String fan_data = p->value();
-            int fan_id = fan_name.substring(4).toInt(); // Assumes "FAN_X"
-
-            if (m_SensorSettings.count(fan_id)) {
-                Serial.printf("Saving %s: %s\n", fan_name.c_str(), fan_data.c_str());
-                systemPreferences.putString(fan_name.c_str(), fan_data);
-
-                JsonDocument fan_doc;
-                deserializeJson(fan_doc, fan_data);
-                m_SensorSettings[fan_id].sensor_name = fan_doc["sensor"].as<String>();
-                m_SensorSettings[fan_id].temperature_alarm_threshold = fan_doc["temp_th"].as<int>();
-                m_SensorSettings[fan_id].rpm_alarm_threshold = fan_doc["duty_th"].as<int>();
-                m_SensorSettings[fan_id].step_duration_seconds = fan_doc["sud_dur"].as<uint8_t>();
-                m_SensorSettings[fan_id].fan_speed_curve.clear();
-                for (const auto& setting : fan_doc["curves"].as<JsonArray>()) {
-                    m_SensorSettings[fan_id].fan_speed_curve.push_back({setting["temp"].as<float>(), setting["fan"].as<int>()});
+        // Every fan in the request lands in one new version, or none does
+        std::vector<const AsyncWebParameter*> saved;
+        const bool valid = UpdateControllerConfig([&](ControllerConfig& config) {
+            int params = request->params();
+            for (int i = 0; i < params; i++) {
+                const AsyncWebParameter* p = request->getParam(i);
+                int fan_index = FindFanIndex(p->name().substring(4).toInt()); // Assumes "FAN_X"
+
+                if (fan_index >= 0) {
+                    JsonDocument fan_doc;
+                    deserializeJson(fan_doc, p->value());
+                    LoadFanSettings(config.fans[fan_index], fan_doc, a_FanIds[fan_index]);
+                    saved.push_back(p);
                 }
             }
+        });
+        if (!valid) {
+            request->send(400, "application/json", "{\"status\": \"curves_invalid\"}");
+            return;
+        }
+        for (const AsyncWebParameter* p : saved) {
+            Serial.printf("Saving %s: %s\n", p->name().c_str(), p->value().c_str());
+            systemPreferences.putString(p->name().c_str(), p->value());
         }
         request->send(200, "application/json", "{\"status\": \"curves_saved\"}");
     });
@@ -766,7 +877,116 @@ void InitializeHttpServer() {
 
     // API: Get Current Data
     webServer.on("/get-data", HTTP_GET, [](AsyncWebServerRequest *request) {
-        request->send(200, "application/json", PrepareTelemetryPayload("manual_fetch").c_str());
+        // The response holds the shared snapshot until it is sent, nothing is copied or reserialized
+        std::shared_ptr<const TelemetrySnapshot> snapshot = AcquireTelemetrySnapshot();
+        const size_t length = snapshot->JsonLength(TelemetrySink::Http);
+        request->send(request->beginResponse("application/json", length,
+            [snapshot, length](uint8_t *buffer, size_t max_length, size_t index) -> size_t {
+                const size_t chunk = min(max_length, length - index);
+                memcpy(buffer, snapshot->Json(TelemetrySink::Http) + index, chunk);
+                return chunk;
+            }));
+    });
+
+    // Push: one telemetry event per WEB_EVENTS_INTERVAL_MS to every open page
+    webEvents.onConnect([](AsyncEventSourceClient *client) {
+        // New pages get the current state instead of waiting a tick
+        client->send(AcquireTelemetrySnapshot()->Json(TelemetrySink::Push), "telemetry", millis(), WEB_EVENTS_INTERVAL_MS * 2);
+    });
+    webServer.addHandler(&webEvents);
+
+    // API: Trend history, streamed from PSRAM a row at a time
+    webServer.on("/history", HTTP_GET, [](AsyncWebServerRequest *request) {
+        HistoryTier tier = HistoryTier::Raw;
+        if (request->hasParam("tier") && !ParseHistoryTier(request->getParam("tier")->value().c_str(), tier)) {
+            request->send(400, "application/json", "{\"status\": \"unknown_tier\"}");
+            return;
+        }
+        if (!HistoryAvailable()) {
+            request->send(503, "application/json", "{\"status\": \"history_unavailable\"}");
+            return;
+        }
+        uint32_t seconds = request->hasParam("seconds") ? request->getParam("seconds")->value().toInt() : 0;
+
+        // The cursor is all the per-request state, it lives as long as the response
+        std::shared_ptr<HistoryCursor> cursor = std::make_shared<HistoryCursor>(OpenHistoryCursor(tier, seconds));
+        AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+            [cursor](uint8_t *buffer, size_t max_length, size_t index) -> size_t {
+                return WriteHistoryChunk(*cursor, reinterpret_cast<char *>(buffer), max_length);
+            });
+        response->addHeader("Cache-Control", "no-store");
+        request->send(response);
+    });
+
+    // API: Flash log, varint-encoded, oldest first (decode with the daemon's -decode-log)
+    webServer.on("/export-log", HTTP_GET, [](AsyncWebServerRequest *request) {
+        if (!FlashLogAvailable()) {
+            request->send(503, "application/json", "{\"status\": \"log_unavailable\"}");
+            return;
+        }
+        std::shared_ptr<FlashLogExportCursor> cursor = std::make_shared<FlashLogExportCursor>(OpenFlashLogExport());
+        AsyncWebServerResponse *response = request->beginChunkedResponse("application/octet-stream",
+            [cursor](uint8_t *buffer, size_t max_length, size_t index) -> size_t {
+                return WriteFlashLogExportChunk(*cursor, buffer, max_length);
+            });
+        response->addHeader("Content-Disposition", "attachment; filename=\"waku-log.bin\"");
+        request->send(response);
+    });
+
+    webServer.on("/get-log-stats", HTTP_GET, [](AsyncWebServerRequest *request) {
+        FlashLogStats stats = GetFlashLogStats();
+        JsonDocument doc;
+        doc["available"] = FlashLogAvailable();
+        doc["boot"] = stats.boot;
+        doc["raw_segments"] = stats.raw_segments;
+        doc["compacted_segments"] = stats.compacted_segments;
+        doc["bytes"] = stats.bytes;
+        doc["batches_written"] = stats.batches_written;
+        doc["corrupt_batches"] = stats.corrupt_batches;
+        String buffer;
+        serializeJson(doc, buffer);
+        request->send(200, "application/json", buffer);
+    });
+
+    // API: MQTT connection state and counters
+    webServer.on("/get-mqtt-stats", HTTP_GET, [](AsyncWebServerRequest *request) {
+        static const char *const state_names[] = {"disabled", "waiting_for_wifi", "connected", "backoff"};
+        MqttStats stats = GetMqttStats();
+        JsonDocument doc;
+        doc["state"] = state_names[static_cast<int>(stats.state)];
+        doc["client_state"] = stats.client_state;
+        doc["connect_attempts"] = stats.connect_attempts;
+        doc["connects"] = stats.connects;
+        doc["disconnects"] = stats.disconnects;
+        doc["last_connect_ms"] = stats.last_connect_ms;
+        doc["max_connect_ms"] = stats.max_connect_ms;
+        doc["backoff_ms"] = stats.backoff_ms;
+        doc["published"] = stats.published;
+        doc["publish_failures"] = stats.publish_failures;
+        doc["backlog_published"] = stats.backlog_published;
+        doc["queued"] = MqttQueueDepth();
+        doc["queue_dropped"] = MqttQueueDroppedSamples();
+        String buffer;
+        serializeJson(doc, buffer);
+        request->send(200, "application/json", buffer);
+    });
+
+    // API: I2C bus latency per device
+    webServer.on("/get-bus-stats", HTTP_GET, [](AsyncWebServerRequest *request) {
+        JsonDocument doc;
+        doc["clock_hz"] = I2C_BUS_CLOCK_HZ;
+        for (int i = 0; i < I2C_DEVICE_COUNT; i++) {
+            I2cDevice device = static_cast<I2cDevice>(i);
+            I2cBusStats stats = GetI2cBusStats(device);
+            JsonObject entry = doc[I2cDeviceName(device)].to<JsonObject>();
+            entry["transactions"] = stats.transactions;
+            entry["wait_avg_us"] = stats.transactions ? (uint32_t)(stats.wait_total_us / stats.transactions) : 0;
+            entry["wait_max_us"] = stats.wait_max_us;
+            entry["hold_max_us"] = stats.hold_max_us;
+        }
+        String buffer;
+        serializeJson(doc, buffer);
+        request->send(200, "application/json", buffer);
     });
 
     webServer.begin();
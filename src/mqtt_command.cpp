@@ -0,0 +1,73 @@
+#include "mqtt_command.h"
+#include <math.h>
+#include <string.h>
+#include "config_manager.h"
+#include "control_manager.h"
+#include "json_writer.h"
+
+const char* ApplyMqttCommand(JsonVariantConst command) {
+    const char* name = command["cmd"] | "";
+
+    if (strcmp(name, "telemetry_interval") == 0) {
+        int interval_ms = command["ms"] | -1;
+        if (interval_ms < 1000) return "interval below 1000 ms";
+        systemSettings.telemetry_interval = interval_ms; // loop() retimes the scheduler task
+        return nullptr;
+    }
+
+    std::function<void(ControllerConfig&)> edit;
+    if (strcmp(name, "fan_duty") == 0 || strcmp(name, "curve_point") == 0) {
+        int fan_index = FindFanIndex(command["fan"] | -1);
+        if (fan_index < 0) return "unknown fan";
+        if (strcmp(name, "fan_duty") == 0) {
+            // Checked while still an int, the override is an int16_t
+            JsonVariantConst value = command["duty"];
+            if (!value.is<int>()) return "duty must be an integer";
+            int duty = value.as<int>();
+            if (duty < -1 || duty > 255) return "duty out of range"; // -1 clears the override
+            edit = [=](ControllerConfig& config) { config.fans[fan_index].duty_override = static_cast<int16_t>(duty); };
+        } else {
+            int point = command["index"] | -1;
+            FanSpeedPoint value = {command["temp"] | NAN, command["duty"] | -1};
+            const ControllerConfigGuard current = ReadControllerConfig();
+            int points = current->fans[fan_index].fan_speed_curve.size();
+            if (point < 0 || point > points || point >= FAN_CURVE_MAX_POINTS) return "curve point out of range";
+            edit = [=](ControllerConfig& config) {
+                auto& curve = config.fans[fan_index].fan_speed_curve;
+                if (point < (int)curve.size()) {
+                    curve[point] = value;
+                } else {
+                    curve.push_back(value); // Appends when index is one past the end
+                }
+            };
+        }
+    } else if (strcmp(name, "led_mode") == 0) {
+        int strip = command["strip"] | -1;
+        int mode = command["mode"] | -1;
+        if (strip < 0 || strip >= ACTIVE_LED_STRIPS) return "unknown LED strip";
+        if (mode < 0) return "missing LED mode";
+        edit = [=](ControllerConfig& config) { config.leds[strip].mode = mode; };
+    } else {
+        return "unknown command";
+    }
+    return UpdateControllerConfig(edit) ? nullptr : "rejected by validation";
+}
+
+size_t WriteMqttCommandAck(char* buffer, size_t size, JsonVariantConst command, const char* error) {
+    JsonWriter writer(buffer, size);
+    writer.BeginObject();
+    writer.Key("id");
+    writer.StringValue(command["id"] | "");
+    writer.Key("cmd");
+    writer.StringValue(command["cmd"] | "");
+    writer.Key("status");
+    writer.StringValue(error ? "error" : "ok");
+    if (error) {
+        writer.Key("error");
+        writer.StringValue(error);
+    }
+    writer.Key("config_generation");
+    writer.UnsignedValue(ControllerConfigGeneration());
+    writer.EndObject();
+    return writer.Overflowed() ? 0 : writer.Length();
+}
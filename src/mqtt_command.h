@@ -0,0 +1,25 @@
+#ifndef MQTT_COMMAND_H
+#define MQTT_COMMAND_H
+
+#include <stddef.h>
+#include <ArduinoJson.h>
+
+// --- MQTT Commands ---
+// Config deltas received on <mqtt_topic>/cmd, one JSON object per message:
+//
+//   {"id":"7","cmd":"fan_duty","fan":1,"duty":200}        duty -1 clears the override
+//   {"cmd":"curve_point","fan":1,"index":2,"temp":36,"duty":140}
+//   {"cmd":"led_mode","strip":0,"mode":4}
+//   {"cmd":"telemetry_interval","ms":10000}
+//
+// Each command lands in one validated UpdateControllerConfig(), so a refused
+// one leaves the running config untouched. Nothing here is saved to flash.
+
+// Returns nullptr once applied, otherwise why the command was refused
+const char* ApplyMqttCommand(JsonVariantConst command);
+
+// {"id":..,"cmd":..,"status":"ok"|"error"[,"error":..],"config_generation":n}
+// for <mqtt_topic>/ack. Returns the length, 0 if it did not fit.
+size_t WriteMqttCommandAck(char* buffer, size_t size, JsonVariantConst command, const char* error);
+
+#endif // MQTT_COMMAND_H
@@ -1,89 +1,240 @@
 #include "mqtt_manager.h"
 #include "config_constants.h" // For kDebugEnabled, kMqttDebugEnabled, MQTT constants
+#include "telemetry_manager.h"
+#include "telemetry_cache.h"
+#include "wifi_manager.h"
+#include "mqtt_queue.h"
+#include "mqtt_command.h"
+#include "seqlock.h"
+#include <atomic>
 
-// PrepareTelemetryPayload is defined in main.cpp (or another module) and will be linked.
-extern std::string PrepareTelemetryPayload(const std::string& event = "default");
+// mqttClient belongs to the MQTT task. Other tasks only raise these flags
+// and read the stats snapshot.
+static std::atomic<bool> s_MqttConfigChanged{false};
+static std::atomic<bool> s_MqttPublishRequested{false};
+static Seqlock<MqttStats> s_MqttStats;
+static MqttStats s_MqttStatsLocal; // MQTT task's working copy
+static unsigned long s_MqttBackoffSinceMs = 0;
+static unsigned long s_MqttLastDrainMs = 0;
+static unsigned long s_MqttLastChangeCheckMs = 0;
+static uint32_t s_MqttAlarmEdges = 0; // ControllerAlarmEdges() at the last change check
+static TelemetryBaseline s_MqttBaseline; // What the broker last got, per field
+
+static bool MqttEnabled() {
+    return !systemSettings.offline_mode && systemSettings.mqtt_enable;
+}
 
 void InitializeMqttClient() {
-    if (systemSettings.offline_mode || !systemSettings.mqtt_enable) {
+    if (!MqttEnabled()) {
         Serial.println("MQTT client initialization skipped (offline mode or MQTT disabled).");
-        return;
     }
+    s_MqttConfigChanged = true; // The MQTT task (re)applies the settings and connects
+}
 
+static void SetMqttState(MqttLinkState state) {
+    s_MqttStatsLocal.state = state;
+    s_MqttStatsLocal.client_state = mqttClient.state();
+    s_MqttStats.Write(s_MqttStatsLocal);
+}
+
+static void ApplyMqttConfig() {
+    if (mqttClient.connected()) {
+        mqttClient.disconnect();
+    }
     mqttClient.setServer(systemSettings.mqtt_broker.c_str(), systemSettings.mqtt_port);
     mqttClient.setCallback(MqttCallback); // MqttCallback is now in this file
-    mqttClient.setBufferSize(MQTT_CLIENT_BUFFER_SIZE); 
-    mqttClient.setSocketTimeout(MQTT_SOCKET_TIMEOUT); 
-
-    String client_id = espChipIdStr; 
-    unsigned long mqtt_connect_start_time = millis();
-    const unsigned long mqtt_connect_timeout_ms = 30000; // 30 seconds timeout for initial connection
+    mqttClient.setBufferSize(MQTT_CLIENT_BUFFER_SIZE);
+    mqttClient.setSocketTimeout(MQTT_CONNECT_TIMEOUT_MS / 1000);
+    wifiClient.setConnectionTimeout(MQTT_CONNECT_TIMEOUT_MS);
+    s_MqttStatsLocal.backoff_ms = MQTT_BACKOFF_MIN_MS;
+    SetMqttState(MqttEnabled() ? MqttLinkState::WaitingForWifi : MqttLinkState::Disabled);
+}
 
-    Serial.printf("Attempting to connect to MQTT broker: %s:%d as client ID: %s\n", 
+// Bounded by the TCP connect and CONNACK timeouts, and only ever blocks the MQTT task
+static void ConnectMqttClient() {
+    String client_id = espChipIdStr;
+    Serial.printf("Attempting to connect to MQTT broker: %s:%d as client ID: %s\n",
                   systemSettings.mqtt_broker.c_str(), systemSettings.mqtt_port, client_id.c_str());
 
-    while (!mqttClient.connected()) {
-        if (millis() - mqtt_connect_start_time > mqtt_connect_timeout_ms) {
-            Serial.println("MQTT connection timed out after 30 seconds during initialization. Will retry in background via loop.");
-            return; 
-        }
-        Serial.print("Connecting to MQTT...");
-        if (mqttClient.connect(client_id.c_str(), systemSettings.mqtt_username.c_str(), systemSettings.mqtt_password.c_str())) {
-            Serial.println(" Connected.");
-            // Example: mqttClient.subscribe("waku-ctl/command");
-        } else {
-            Serial.print(" Failed, rc=");
-            Serial.print(mqttClient.state());
-            Serial.println(". Retrying in 2s...");
-            delay(2000); 
-        }
+    unsigned long start_ms = millis();
+    s_MqttStatsLocal.connect_attempts++;
+    bool connected = mqttClient.connect(client_id.c_str(), systemSettings.mqtt_username.c_str(), systemSettings.mqtt_password.c_str());
+    uint32_t elapsed_ms = millis() - start_ms;
+
+    if (connected) {
+        s_MqttStatsLocal.connects++;
+        s_MqttStatsLocal.last_connect_ms = elapsed_ms;
+        s_MqttStatsLocal.max_connect_ms = max(s_MqttStatsLocal.max_connect_ms, elapsed_ms);
+        s_MqttStatsLocal.backoff_ms = MQTT_BACKOFF_MIN_MS;
+        Serial.printf("MQTT: Connected in %u ms.\n", elapsed_ms);
+        s_MqttBaseline.valid = false; // The first change check after connecting sends everything
+        String command_topic = systemSettings.mqtt_topic + "/cmd";
+        mqttClient.subscribe(command_topic.c_str());
+        SetMqttState(MqttLinkState::Connected);
+        return;
     }
+    Serial.printf("MQTT: Connect failed after %u ms, rc=%d. Retrying in %u ms...\n",
+                  elapsed_ms, mqttClient.state(), s_MqttStatsLocal.backoff_ms);
+    s_MqttBackoffSinceMs = millis();
+    SetMqttState(MqttLinkState::Backoff);
 }
 
 void MqttCallback(char* topic, byte* payload, unsigned int length) {
     if (DEBUG_MQTT_ENABLED) {
-        Serial.print("MQTT Message [");
-        Serial.print(topic);
-        Serial.print("]: ");
-        std::string payloadStr = "";
-        for (unsigned int i = 0; i < length; i++) {
-            payloadStr += (char)payload[i];
-        }
-        Serial.print(payloadStr.c_str());
-        Serial.println("\n-----------------------");
+        Serial.printf("MQTT Message [%s]: %.*s\n", topic, (int)length, reinterpret_cast<const char*>(payload));
+    }
+    // Parsed as const input so the document owns its strings: the client
+    // buffer holding payload is reused for the ack
+    JsonDocument command;
+    const char* error = nullptr;
+    if (deserializeJson(command, static_cast<const uint8_t*>(payload), length)) {
+        error = "invalid JSON";
+    } else {
+        error = ApplyMqttCommand(command);
     }
-    // TODO: Add MQTT command handling here if needed
+
+    char ack[MQTT_ACK_MAX_BYTES];
+    const size_t ack_length = WriteMqttCommandAck(ack, sizeof(ack), command, error);
+    if (ack_length == 0) {
+        return;
+    }
+    String ack_topic = systemSettings.mqtt_topic + "/ack";
+    mqttClient.publish(ack_topic.c_str(), reinterpret_cast<const uint8_t*>(ack), ack_length);
+    Serial.printf("MQTT: Command %s %s%s\n", (const char*)(command["cmd"] | "?"), error ? "refused: " : "applied", error ? error : "");
 }
 
 void SendMqttTelemetry() {
-    if (!mqttClient.connected()) {
-        if (DEBUG_ENABLED) Serial.println("MQTT: Client not connected. Skipping telemetry.");
+    if (GetMqttStats().state != MqttLinkState::Connected) {
+        QueueMqttSample(ReadControllerState()); // Published as backlog after reconnecting
+        if (DEBUG_ENABLED) Serial.printf("MQTT: Client not connected. Sample queued (%u waiting).\n", MqttQueueDepth());
         return;
     }
+    s_MqttPublishRequested = true; // Published from the MQTT task, the scheduler never waits on the socket
+}
+
+static void PublishMqttTelemetry() {
     if (DEBUG_ENABLED) Serial.println("Preparing MQTT telemetry...");
-    std::string payload = PrepareTelemetryPayload("auto_mqtt"); 
-    bool published = mqttClient.publish(systemSettings.mqtt_topic.c_str(), payload.c_str());
+    const std::shared_ptr<const TelemetrySnapshot> snapshot = AcquireTelemetrySnapshot();
+    const char* payload = snapshot->Json(TelemetrySink::Mqtt);
+    size_t payload_length = snapshot->JsonLength(TelemetrySink::Mqtt);
+    if (payload_length == 0) {
+        Serial.println("MQTT: Telemetry payload did not fit. Skipping.");
+        return;
+    }
+    bool published = mqttClient.publish(systemSettings.mqtt_topic.c_str(), reinterpret_cast<const uint8_t*>(payload), payload_length);
+    if (published) {
+        SetTelemetryBaseline(s_MqttBaseline, snapshot->state);
+        s_MqttStatsLocal.published++;
+    } else {
+        s_MqttStatsLocal.publish_failures++;
+        QueueMqttSample(snapshot->state);
+    }
+    s_MqttStats.Write(s_MqttStatsLocal);
 
     if (DEBUG_ENABLED) {
-        Serial.printf("MQTT: Payload to %s (%d bytes): %s\n", systemSettings.mqtt_topic.c_str(), payload.length(), payload.c_str());
+        Serial.printf("MQTT: Payload to %s (%d bytes): %s\n", systemSettings.mqtt_topic.c_str(), payload_length, payload);
         Serial.printf("MQTT: Publish call %s.\n", published ? "succeeded (queued)" : "failed (buffer full or other issue)");
     } else {
-         Serial.printf("MQTT: %d bytes %s to %s\n", payload.length(), published ? "published" : "failed", systemSettings.mqtt_topic.c_str());
+         Serial.printf("MQTT: %d bytes %s to %s\n", payload_length, published ? "published" : "failed", systemSettings.mqtt_topic.c_str());
     }
 }
 
-void LoopMqttClient() {
-    if (!systemSettings.offline_mode && systemSettings.mqtt_enable) {
-        if (!mqttClient.connected()) {
-            static unsigned long last_mqtt_reconnect_attempt = 0;
-            if (millis() - last_mqtt_reconnect_attempt > 5000) { // Attempt to reconnect every 5 seconds
-                last_mqtt_reconnect_attempt = millis();
-                Serial.println("MQTT: Client disconnected. Attempting to reconnect...");
-                InitializeMqttClient(); // Re-run the connection logic
-            }
+// Between full payloads: fields past their deadband, or everything as soon as an alarm changes.
+// An alarm edge skips the TELEMETRY_CHANGE_CHECK_MS wait, so it goes out on the next MQTT loop.
+static void PublishMqttChanges() {
+    const uint32_t alarm_edges = ControllerAlarmEdges();
+    if (systemSettings.telemetry_interval <= 0 ||
+        (alarm_edges == s_MqttAlarmEdges && millis() - s_MqttLastChangeCheckMs < TELEMETRY_CHANGE_CHECK_MS)) {
+        return;
+    }
+    s_MqttAlarmEdges = alarm_edges;
+    s_MqttLastChangeCheckMs = millis();
+    char payload[TELEMETRY_PAYLOAD_MAX_BYTES];
+    TelemetryBaseline next = s_MqttBaseline;
+    size_t payload_length = WriteTelemetryChanges(payload, sizeof(payload), AcquireTelemetrySnapshot()->state, next);
+    if (payload_length == 0) {
+        return;
+    }
+    if (mqttClient.publish(systemSettings.mqtt_topic.c_str(), reinterpret_cast<const uint8_t*>(payload), payload_length)) {
+        s_MqttBaseline = next; // A lost delta is sent again on the next check
+        s_MqttStatsLocal.published++;
+    } else {
+        s_MqttStatsLocal.publish_failures++;
+    }
+    s_MqttStats.Write(s_MqttStatsLocal);
+    if (DEBUG_ENABLED && DEBUG_DATA_ENABLED) Serial.printf("MQTT: Change payload: %s\n", payload);
+}
+
+// One batch per MQTT_QUEUE_DRAIN_INTERVAL_MS so a long backlog does not crowd out live telemetry
+static void DrainMqttQueue() {
+    static char batch[MQTT_QUEUE_BATCH_MAX_BYTES];
+    if (millis() - s_MqttLastDrainMs < MQTT_QUEUE_DRAIN_INTERVAL_MS) {
+        return;
+    }
+    s_MqttLastDrainMs = millis();
+    uint32_t batch_end = 0;
+    size_t batch_length = WriteMqttQueueBatch(batch, sizeof(batch), batch_end);
+    if (batch_length == 0) {
+        return;
+    }
+    String topic = systemSettings.mqtt_topic + "/backlog";
+    if (!mqttClient.publish(topic.c_str(), reinterpret_cast<const uint8_t*>(batch), batch_length)) {
+        return; // Stays queued, retried next interval
+    }
+    s_MqttStatsLocal.backlog_published += CommitMqttQueueBatch(batch_end);
+    s_MqttStats.Write(s_MqttStatsLocal);
+    if (DEBUG_ENABLED) Serial.printf("MQTT: Backlog batch sent (%d bytes), %u samples left.\n", batch_length, MqttQueueDepth());
+}
+
+void RunMqttClient() {
+    if (s_MqttConfigChanged.exchange(false)) {
+        ApplyMqttConfig();
+    }
+    MqttLinkState state = s_MqttStatsLocal.state;
+    if (state == MqttLinkState::Disabled) {
+        return;
+    }
+    if (!WifiConnected()) {
+        if (state == MqttLinkState::Connected) {
+            mqttClient.disconnect();
+            s_MqttStatsLocal.disconnects++;
         }
-        mqttClient.loop(); // Handles keep-alives and processes incoming messages
+        if (state != MqttLinkState::WaitingForWifi) {
+            SetMqttState(MqttLinkState::WaitingForWifi);
+        }
+        return;
     }
+
+    switch (state) {
+        case MqttLinkState::WaitingForWifi:
+            ConnectMqttClient();
+            break;
+        case MqttLinkState::Backoff:
+            if (millis() - s_MqttBackoffSinceMs >= s_MqttStatsLocal.backoff_ms) {
+                s_MqttStatsLocal.backoff_ms = min(s_MqttStatsLocal.backoff_ms * 2, (uint32_t)MQTT_BACKOFF_MAX_MS);
+                ConnectMqttClient();
+            }
+            break;
+        case MqttLinkState::Connected:
+            if (!mqttClient.loop()) { // Handles keep-alives and processes incoming messages
+                s_MqttStatsLocal.disconnects++;
+                Serial.printf("MQTT: Connection lost, rc=%d. Reconnecting...\n", mqttClient.state());
+                ConnectMqttClient();
+                break;
+            }
+            if (s_MqttPublishRequested.exchange(false)) {
+                PublishMqttTelemetry();
+            }
+            PublishMqttChanges();
+            DrainMqttQueue();
+            break;
+        default:
+            break;
+    }
+}
+
+MqttStats GetMqttStats() {
+    return s_MqttStats.Read();
 }
 
 void InitializeMqttTelemetryTask(Scheduler& scheduler, Task*& telemetryTaskRef) {
@@ -94,7 +245,7 @@ void InitializeMqttTelemetryTask(Scheduler& scheduler, Task*& telemetryTaskRef)
         }
         telemetryTaskRef = new Task(systemSettings.telemetry_interval * TASK_MILLISECOND, TASK_FOREVER, &SendMqttTelemetry, &scheduler, true);
         if (telemetryTaskRef) {
-            Serial.printf("MQTT Telemetry Task enabled. Interval: %d ms.\n", systemSettings.telemetry_interval);
+            Serial.printf("MQTT Telemetry Task enabled. Interval: %d ms.\n", systemSettings.telemetry_interval.load());
         } else {
             Serial.println("Error: Failed to create MQTT Telemetry Task.");
         }
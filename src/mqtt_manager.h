@@ -4,10 +4,13 @@
 #include "globals.h"      // For gSettings, mqttClient, gEspChipIdStr, kMqttDebugEnabled, kDebugEnabled etc.
 #include <TaskSchedulerDeclarations.h> // For Scheduler and Task types
 
-void InitializeMqttClient();
+// The MQTT task owns the client: it connects with exponential backoff once
+// WiFi is up, runs keep-alives and publishes. Nothing else waits on the broker.
+void InitializeMqttClient(); // Picks up changed settings, reconnecting if needed
 void MqttCallback(char* topic, byte* payload, unsigned int length);
-void SendMqttTelemetry(); // Internally calls PrepareTelemetryPayload
-void LoopMqttClient();
+void SendMqttTelemetry(); // Scheduler callback, only asks the MQTT task to publish
+void RunMqttClient(); // MQTT task only, every MQTT_LOOP_INTERVAL_MS
+MqttStats GetMqttStats();
 void InitializeMqttTelemetryTask(Scheduler& scheduler, Task*& telemetryTaskRef);
 
 #endif // MQTT_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include "mqtt_queue.h"
+#include <mutex>
+#include "hal.h"
+#include "json_writer.h"
+
+static MqttQueuedSample* s_QueueEntries = nullptr;
+// Absolute sample counts: [s_QueueTail, s_QueueHead) are queued
+static uint32_t s_QueueHead = 0;
+static uint32_t s_QueueTail = 0;
+static uint32_t s_QueueDropped = 0;
+static std::mutex s_QueueMutex; // Scheduler queues while offline, the MQTT task drains
+
+bool StartMqttQueue() {
+    if (s_QueueEntries) {
+        return true;
+    }
+    s_QueueEntries = static_cast<MqttQueuedSample*>(HalAllocLarge(sizeof(MqttQueuedSample) * MQTT_QUEUE_SAMPLES));
+    if (!s_QueueEntries) {
+        Serial.println("MQTT: No PSRAM, offline samples will be dropped.");
+        return false;
+    }
+    Serial.printf("MQTT: Offline queue holds %d samples.\n", MQTT_QUEUE_SAMPLES);
+    return true;
+}
+
+bool MqttQueueAvailable() {
+    return s_QueueEntries != nullptr;
+}
+
+void QueueMqttSample(const ControllerState& state) {
+    if (!s_QueueEntries) {
+        return;
+    }
+    MqttQueuedSample sample;
+    sample.epoch_s = HalEpochSeconds();
+    sample.point = MakeHistoryPoint(state);
+
+    std::lock_guard<std::mutex> lock(s_QueueMutex);
+    if (s_QueueHead - s_QueueTail == MQTT_QUEUE_SAMPLES) {
+        s_QueueTail++; // Full: the oldest sample makes room
+        s_QueueDropped++;
+    }
+    s_QueueEntries[s_QueueHead % MQTT_QUEUE_SAMPLES] = sample;
+    s_QueueHead++;
+}
+
+uint32_t MqttQueueDepth() {
+    std::lock_guard<std::mutex> lock(s_QueueMutex);
+    return s_QueueHead - s_QueueTail;
+}
+
+uint32_t MqttQueueDroppedSamples() {
+    std::lock_guard<std::mutex> lock(s_QueueMutex);
+    return s_QueueDropped;
+}
+
+// Samples queued before the clock was set get their time back from how long
+// ago, in uptime, they were taken
+static uint32_t QueuedSampleEpoch(const MqttQueuedSample& sample, uint32_t now_epoch_s, uint32_t now_uptime_s) {
+    if (sample.epoch_s != 0 || now_epoch_s == 0) {
+        return sample.epoch_s;
+    }
+    return now_epoch_s - (now_uptime_s - sample.point.uptime_s);
+}
+
+static void WriteQueuedSample(JsonWriter& writer, const MqttQueuedSample& sample, uint32_t epoch_s, bool fahrenheit) {
+    writer.BeginObject();
+    writer.Key("time");
+    writer.UnsignedValue(epoch_s);
+    writer.Key("uptime");
+    writer.UnsignedValue(sample.point.uptime_s);
+    writer.Key("data");
+    writer.BeginObject();
+    for (int i = 0; i < ACTIVE_THERMISTORS; i++) {
+        int16_t centi = sample.point.values.centi_celsius[i];
+        double value = centi == INT16_MIN ? 0.0 : centi / 100.0; // Same 0 for N/A as the live payload
+        if (fahrenheit && centi != INT16_MIN) value = value * 1.8 + 32;
+        writer.IndexedKey("temperature", i + 1);
+        writer.DecimalValue(value, 1);
+    }
+    for (int i = 0; i < ACTIVE_FANS; i++) {
+        writer.IndexedKey("FAN_", a_FanIds[i]);
+        writer.UnsignedValue(sample.point.values.rpm[i]);
+    }
+    writer.EndObject();
+    writer.EndObject();
+}
+
+size_t WriteMqttQueueBatch(char* buffer, size_t size, uint32_t& batch_end) {
+    MqttQueuedSample batch[MQTT_QUEUE_BATCH_SAMPLES];
+    uint32_t first = 0;
+    uint32_t count = 0;
+    {
+        std::lock_guard<std::mutex> lock(s_QueueMutex);
+        if (!s_QueueEntries) {
+            return 0;
+        }
+        first = s_QueueTail;
+        count = s_QueueHead - s_QueueTail;
+        if (count > MQTT_QUEUE_BATCH_SAMPLES) count = MQTT_QUEUE_BATCH_SAMPLES;
+        for (uint32_t i = 0; i < count; i++) {
+            batch[i] = s_QueueEntries[(first + i) % MQTT_QUEUE_SAMPLES];
+        }
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    // Fewer samples when the message would not fit; the rest go next time
+    const bool fahrenheit = systemSettings.units == "F";
+    const uint32_t now_epoch_s = HalEpochSeconds();
+    const uint32_t now_uptime_s = HalMillis() / 1000;
+    for (; count > 0; count--) {
+        JsonWriter writer(buffer, size);
+        writer.BeginObject();
+        writer.Key("client_id");
+        writer.StringValue(espChipIdStr.c_str());
+        writer.Key("event");
+        writer.StringValue("backlog");
+        writer.Key("units");
+        writer.StringValue(fahrenheit ? "F" : "C");
+        writer.Key("samples");
+        writer.BeginArray();
+        for (uint32_t i = 0; i < count; i++) {
+            WriteQueuedSample(writer, batch[i], QueuedSampleEpoch(batch[i], now_epoch_s, now_uptime_s), fahrenheit);
+        }
+        writer.EndArray();
+        writer.EndObject();
+        if (!writer.Overflowed()) {
+            batch_end = first + count;
+            return writer.Length();
+        }
+    }
+    if (size > 0) buffer[0] = '\0';
+    return 0;
+}
+
+uint32_t CommitMqttQueueBatch(uint32_t batch_end) {
+    std::lock_guard<std::mutex> lock(s_QueueMutex);
+    // Samples dropped while the batch was in flight already moved the tail past part of it
+    const int32_t removed = static_cast<int32_t>(batch_end - s_QueueTail);
+    if (removed <= 0) {
+        return 0;
+    }
+    s_QueueTail = batch_end;
+    return removed;
+}
@@ -0,0 +1,43 @@
+#ifndef MQTT_QUEUE_H
+#define MQTT_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "history_manager.h"
+
+// --- MQTT Offline Queue ---
+// Telemetry samples that could not be published wait in a PSRAM ring of
+// MQTT_QUEUE_SAMPLES; once full, the oldest go first. After the broker is
+// back the MQTT task drains it MQTT_QUEUE_BATCH_SAMPLES at a time, one
+// message per MQTT_QUEUE_DRAIN_INTERVAL_MS, to <mqtt_topic>/backlog:
+//
+//   {"client_id":"..","event":"backlog","units":"C","samples":[
+//     {"time":1767225600,"uptime":120,"data":{"temperature1":24.5,..,"FAN_0":1200,..}},..]}
+//
+// "data" matches the live telemetry; "time" is Unix seconds. Samples taken
+// before SNTP set the clock get it from their uptime once it is set, and
+// stay at 0 only while it still is not. Queueing only takes a short
+// lock to copy one sample, it never waits on the network.
+
+struct MqttQueuedSample {
+    uint32_t epoch_s;
+    HistoryPoint point;
+};
+
+// Allocates the ring; false (and samples are dropped as before) without PSRAM
+bool StartMqttQueue();
+bool MqttQueueAvailable();
+
+void QueueMqttSample(const ControllerState& state);
+uint32_t MqttQueueDepth();
+uint32_t MqttQueueDroppedSamples();
+
+// MQTT task only. Formats the oldest samples as one backlog message and
+// returns its length, 0 when the queue is empty. batch_end identifies the
+// samples written; pass it to CommitMqttQueueBatch() once published, or drop
+// it to send them again later.
+size_t WriteMqttQueueBatch(char* buffer, size_t size, uint32_t& batch_end);
+// Returns how many samples left the queue, fewer if some were dropped meanwhile
+uint32_t CommitMqttQueueBatch(uint32_t batch_end);
+
+#endif // MQTT_QUEUE_H
@@ -0,0 +1,445 @@
+#if !defined(ARDUINO) && !defined(PIO_UNIT_TESTING)
+
+// Host entry point for [env:native]: runs the control, telemetry, LED and
+// display pipelines against the simulated loop in hal_native.cpp. Pipeline
+// logging goes to stdout as Serial output would; the simulation report and
+// benchmark table go to stderr.
+//
+//   .pio/build/native/program                 simulate 20 minutes, load step halfway
+//   .pio/build/native/program --minutes 60    simulate a longer run
+//   .pio/build/native/program --mode pid_temp --setpoint 34
+//                                             run every fan in a PID mode (pid_temp or pid_rpm)
+//   .pio/build/native/program --stream 100    also capture and flush USB stream samples at 100 Hz
+//   .pio/build/native/program --flash-log /tmp/log
+//                                             also keep the flash log in that directory, export to export.bin
+//   .pio/build/native/program --bench         time each pipeline stage
+//
+// Unit tests under test/ link the same modules with their own main()
+// (`pio test -e native`), so this file is left out of test builds.
+
+#include <chrono>
+#include <new>
+#include <string>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "hal.h"
+#include "hal_native.h"
+#include "ArduinoJson.h"
+#include "control_manager.h"
+#include "config_manager.h"
+#include "sensor_manager.h"
+#include "thermistor_table.h"
+#include "signal_filter.h"
+#include "pid_controller.h"
+#include "telemetry_manager.h"
+#include "telemetry_cache.h"
+#include "usb_protocol.h"
+#include "usb_stream.h"
+#include "history_manager.h"
+#include "flash_log_manager.h"
+#include "display_manager.h"
+#include "led_manager.h"
+
+// Same periods as the FreeRTOS tasks in main.cpp
+constexpr unsigned long SAMPLER_PERIOD_MS = ADC_SAMPLE_INTERVAL_MS;
+constexpr unsigned long CONTROL_PERIOD_MS = CONTROL_LOOP_INTERVAL_MS;
+constexpr unsigned long LEDS_PERIOD_MS = 66;
+constexpr unsigned long DISPLAY_PERIOD_MS = 1000;
+constexpr unsigned long USB_TELEMETRY_PERIOD_MS = 1000;
+
+struct BenchResult {
+    const char* name;
+    double ns_per_op;
+};
+
+// Heap allocations for the telemetry comparison: operator new covers String
+// and std::string, CountingAllocator the JsonDocument pool
+static unsigned long s_HeapAllocations = 0;
+
+void* operator new(size_t size) {
+    s_HeapAllocations++;
+    void* ptr = malloc(size ? size : 1);
+    if (ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+class CountingAllocator : public ArduinoJson::Allocator {
+public:
+    void* allocate(size_t size) override {
+        s_HeapAllocations++;
+        return malloc(size);
+    }
+    void deallocate(void* ptr) override {
+        free(ptr);
+    }
+    void* reallocate(void* ptr, size_t new_size) override {
+        s_HeapAllocations++;
+        return realloc(ptr, new_size);
+    }
+};
+
+static CountingAllocator s_CountingAllocator;
+
+// The JsonDocument serializer WriteTelemetryPayload replaced, kept as the
+// throughput and allocation reference
+static std::string ReferenceTelemetryPayload(const std::string& event) {
+    const ControllerState state = ReadControllerState();
+    double t1 = state.temperatures[0];
+    double t2 = state.temperatures[1];
+
+    if (systemSettings.units == "F") {
+        if (t1 > -90.0) t1 = (t1 * 1.8) + 32;
+        if (t2 > -90.0) t2 = (t2 * 1.8) + 32;
+    }
+
+    JsonDocument payload(&s_CountingAllocator);
+    payload["client_id"] = espChipIdStr.c_str();
+    payload["event"] = event;
+    payload["units"] = systemSettings.units.c_str();
+    JsonObject data = payload["data"].to<JsonObject>();
+
+    data["temperature1"] = (t1 > -90.0) ? String(t1, 1).toFloat() : 0.0f;
+    data["temperature2"] = (t2 > -90.0) ? String(t2, 1).toFloat() : 0.0f;
+
+    for (int i = 0; i < ACTIVE_FANS; ++i) {
+        std::string fkey = "FAN_" + std::to_string(a_FanIds[i]);
+        data[fkey] = state.fans[i].rpm;
+    }
+
+    std::string buffer;
+    serializeJson(payload, buffer);
+    return buffer;
+}
+
+// The per-sample B-parameter formula the thermistor table replaced, kept as the accuracy reference
+static double ReferenceAdcToCelsius(int16_t adc_raw) {
+    double voltage = (adc_raw * ADC_FULL_SCALE_VOLTAGE) / ADC_MAX_COUNTS;
+    double resistance = T_REFERENCE_RESISTANCE * (voltage / (ADC_VOLTAGE - voltage));
+    const double inverse_kelvin = 1.0 / (T_NOMINAL_TEMPERATURE + 273.15) +
+                                  log(resistance / T_NOMINAL_RESISTANCE) / T_B_VALUE;
+    return 1.0 / inverse_kelvin - 273.15;
+}
+
+static double MaxThermistorTableError(double min_celsius, double max_celsius) {
+    double max_error = 0;
+    for (int raw = 1; raw < THERMISTOR_TABLE_MAX_RAW; raw++) {
+        double reference = ReferenceAdcToCelsius(raw);
+        if (reference < min_celsius || reference > max_celsius) continue;
+        max_error = fmax(max_error, fabs(ConvertAdcToCelsius(0, raw) - reference));
+    }
+    return max_error;
+}
+
+static void InitializeSimulation(FanControlMode mode, float setpoint) {
+    HalSimReset(25.0);
+    systemSettings.setup_done = true;
+    systemSettings.offline_mode = true;
+    espChipIdStr = "00:00:00:00:00:00";
+
+    UpdateControllerConfig([&](ControllerConfig& config) {
+        for (int i = 0; i < ACTIVE_FANS; i++) {
+            TemperatureSensorSettings& settings = config.fans[i];
+            ApplyDefaultFanSettings(settings);
+            settings.control_mode = mode;
+            if (mode == FanControlMode::PidRpm) {
+                settings.pid.kp = PID_RPM_DEFAULT_KP;
+                settings.pid.ki = PID_RPM_DEFAULT_KI;
+                settings.pid.kd = PID_RPM_DEFAULT_KD;
+            }
+            if (setpoint > 0) settings.pid.setpoint = setpoint;
+            else if (mode == FanControlMode::PidRpm) settings.pid.setpoint = PID_RPM_DEFAULT_SETPOINT;
+        }
+        for (int i = 0; i < ACTIVE_LED_STRIPS; i++) {
+            config.leds[i] = LedSettings();
+            config.leds[i].mode = 4; // Rainbow exercises the most per-pixel work
+        }
+    });
+    StartTemperatureSampler();
+    while (!HasTemperatureSamples()) {
+        HalSimAdvance(1);
+        PollTemperatureSampler();
+    }
+    ApplyInitialFanSpeeds();
+}
+
+static void RunSimulation(unsigned long minutes, const char* flash_log_directory) {
+    const unsigned long duration_ms = minutes * 60000UL;
+    unsigned long last_report_ms = 0;
+    unsigned long stream_bytes = 0;
+
+    for (unsigned long now = 0; now < duration_ms; now++) {
+        HalSimAdvance(1);
+
+        if (now == duration_ms / 2) {
+            HalSimSetHeatLoad(350.0);
+            fprintf(stderr, "[%7.1fs] Load step to 350 W\n", now / 1000.0);
+        }
+        if (now % SAMPLER_PERIOD_MS == 0) PollTemperatureSampler();
+        if (now % CONTROL_PERIOD_MS == 0) {
+            RunFanControlTick();
+            RecordHistorySample(ReadControllerState());
+            RecordFlashLogSample(ReadControllerState());
+        }
+        if (now % UsbStreamPeriodMs() == 0) CaptureUsbStreamSample();
+        if (GetUsbStreamRate() > 0 && now % USB_STREAM_FLUSH_INTERVAL_MS == 0) {
+            uint8_t frames[USB_STREAM_FLUSH_MAX_BYTES];
+            stream_bytes += WriteUsbStreamFrames(frames, sizeof(frames));
+        }
+        if (now % LEDS_PERIOD_MS == 0) {
+            for (int i = 0; i < ACTIVE_LED_STRIPS; ++i) PlayLedEffect(i);
+        }
+        if (now % DISPLAY_PERIOD_MS == 0) RenderScreen(currentScreen, "127.0.0.1");
+        if (now % USB_TELEMETRY_PERIOD_MS == 0) {
+            AcquireTelemetrySnapshot(); // What the USB task does every second
+        }
+
+        if (now - last_report_ms >= 30000) {
+            last_report_ms = now;
+            char payload[TELEMETRY_PAYLOAD_MAX_BYTES];
+            WriteTelemetryPayload(payload, sizeof(payload), "sim");
+            fprintf(stderr, "[%7.1fs] T1 %.2f C  T2 %.2f C  duty %d/%d/%d/%d  %s\n", now / 1000.0,
+                    HalSimTemperature(0), HalSimTemperature(1),
+                    HalSimPwmDuty(0), HalSimPwmDuty(1), HalSimPwmDuty(2), HalSimPwmDuty(3), payload);
+        }
+    }
+    fprintf(stderr, "LED frames: %lu\n", HalSimLedFrames());
+    fprintf(stderr, "Telemetry snapshots built: %u\n", TelemetrySnapshotsBuilt());
+    for (HistoryTier tier : {HistoryTier::Raw, HistoryTier::Day, HistoryTier::Week}) {
+        // Drain /history through a small buffer, as a slow TCP window would
+        HistoryCursor cursor = OpenHistoryCursor(tier, 0);
+        char chunk[100];
+        size_t chunk_bytes, total_bytes = 0, chunks = 0;
+        std::string body;
+        while ((chunk_bytes = WriteHistoryChunk(cursor, chunk, sizeof(chunk))) > 0) {
+            body.append(chunk, chunk_bytes);
+            total_bytes += chunk_bytes;
+            chunks++;
+        }
+        fprintf(stderr, "History %-4s: %zu bytes in %zu chunks, ends ...%s\n", HistoryTierName(tier), total_bytes, chunks,
+                body.c_str() + (body.size() > 60 ? body.size() - 60 : 0));
+    }
+    if (FlashLogAvailable()) {
+        FlushFlashLog();
+        const FlashLogStats stats = GetFlashLogStats();
+        std::string export_path = std::string(flash_log_directory) + "/export.bin";
+        FILE* export_file = fopen(export_path.c_str(), "wb");
+        FlashLogExportCursor cursor = OpenFlashLogExport();
+        uint8_t chunk[512];
+        size_t chunk_bytes, export_bytes = 0;
+        while ((chunk_bytes = WriteFlashLogExportChunk(cursor, chunk, sizeof(chunk))) > 0) {
+            if (export_file) fwrite(chunk, 1, chunk_bytes, export_file);
+            export_bytes += chunk_bytes;
+        }
+        if (export_file) fclose(export_file);
+        fprintf(stderr, "Flash log: boot %u, %u raw + %u compacted segments, %u bytes on flash, %u batches written, "
+                "%zu bytes exported to %s\n", stats.boot, (unsigned)stats.raw_segments, (unsigned)stats.compacted_segments,
+                (unsigned)stats.bytes, (unsigned)stats.batches_written, export_bytes, export_path.c_str());
+    }
+    if (GetUsbStreamRate() > 0) {
+        fprintf(stderr, "USB stream: %u Hz, %lu bytes (%.0f B/s), %u samples dropped\n", GetUsbStreamRate(),
+                stream_bytes, stream_bytes * 1000.0 / duration_ms, UsbStreamDroppedSamples());
+    }
+}
+
+template <typename Fn>
+static double TimeNsPerOp(unsigned long iterations, Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < iterations; i++) {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+static void RunBenchmarks(unsigned long iterations) {
+    BenchResult results[24];
+    int count = 0;
+    volatile double sink = 0;
+
+    // The pipeline logs to stdout; keep that out of the report but still pay for it
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    dup2(devnull, STDOUT_FILENO);
+
+    int16_t adc_raw = 9000;
+    results[count++] = {"ReferenceAdcToCelsius", TimeNsPerOp(iterations, [&] { sink = sink + ReferenceAdcToCelsius(adc_raw); adc_raw ^= 1; })};
+    results[count++] = {"ConvertAdcToCelsius", TimeNsPerOp(iterations, [&] { sink = sink + ConvertAdcToCelsius(0, adc_raw); adc_raw ^= 1; })};
+    results[count++] = {"ReadTemperature", TimeNsPerOp(iterations, [&] { sink = sink + ReadTemperature(0); })};
+    FilterSettings filter = {5, 0.3f, 2.0f};
+    FilterState filter_state;
+    float filter_input = 30.0f;
+    results[count++] = {"ApplyFilter (median 5)", TimeNsPerOp(iterations, [&] { sink = sink + ApplyFilter(filter, filter_state, filter_input); filter_input = 60.0f - filter_input; })};
+    results[count++] = {"ReadFanRpm", TimeNsPerOp(iterations, [&] { sink = sink + ReadFanRpm(1); })};
+    results[count++] = {"CalculateFanSpeed", TimeNsPerOp(iterations, [&] { sink = sink + CalculateFanSpeed(0, 37.5f); })};
+    float curve_temperatures[ACTIVE_FANS] = {31.2f, 34.7f, 37.5f, 40.1f};
+    float curve_duties[ACTIVE_FANS];
+    results[count++] = {"EvaluateFanCurves (4 fans)", TimeNsPerOp(iterations, [&] {
+        EvaluateFanCurves(ReadControllerConfig()->curves, curve_temperatures, curve_duties);
+        sink = sink + curve_duties[0];
+        curve_temperatures[0] += 0.001f;
+    })};
+    PidSettings pid;
+    PidState pid_state;
+    float pid_measurement = 34.0f;
+    results[count++] = {"UpdatePid", TimeNsPerOp(iterations, [&] {
+        sink = sink + UpdatePid(pid, pid_state, pid_measurement, true, 128.0f, 0.25f);
+        pid_measurement = 70.0f - pid_measurement;
+    })};
+    results[count++] = {"RunFanControlTick", TimeNsPerOp(iterations, [] { RunFanControlTick(); })};
+    results[count++] = {"ReadControllerConfig", TimeNsPerOp(iterations, [&] { sink = sink + ReadControllerConfig()->fans[0].hysteresis; })};
+    results[count++] = {"UpdateControllerConfig", TimeNsPerOp(iterations / 10, [] {
+        UpdateControllerConfig([](ControllerConfig& config) { config.leds[1].speed ^= 1; });
+    })};
+    results[count++] = {"ReadControllerState", TimeNsPerOp(iterations, [&] { sink = sink + ReadControllerState().fans[0].rpm; })};
+    char payload[TELEMETRY_PAYLOAD_MAX_BYTES];
+    size_t payload_bytes = WriteTelemetryPayload(payload, sizeof(payload), "bench");
+    const std::string reference_payload = ReferenceTelemetryPayload("bench");
+    unsigned long allocations_before = s_HeapAllocations;
+    const int reference_index = count;
+    results[count++] = {"ReferenceTelemetryPayload", TimeNsPerOp(iterations, [&] { sink = sink + ReferenceTelemetryPayload("bench").size(); })};
+    const double reference_allocations = double(s_HeapAllocations - allocations_before) / iterations;
+    allocations_before = s_HeapAllocations;
+    const int writer_index = count;
+    results[count++] = {"WriteTelemetryPayload", TimeNsPerOp(iterations, [&] { sink = sink + WriteTelemetryPayload(payload, sizeof(payload), "bench"); })};
+    const double writer_allocations = double(s_HeapAllocations - allocations_before) / iterations;
+    uint8_t usb_frame[USB_FRAME_MAX_BYTES];
+    const ControllerState usb_state = ReadControllerState();
+    uint16_t usb_sequence = 0;
+    const size_t usb_frame_bytes = WriteUsbTelemetryFrame(usb_frame, sizeof(usb_frame), usb_state, usb_sequence);
+    results[count++] = {"WriteUsbTelemetryFrame", TimeNsPerOp(iterations, [&] {
+        sink = sink + WriteUsbTelemetryFrame(usb_frame, sizeof(usb_frame), usb_state, usb_sequence++);
+    })};
+    ControllerState snapshot_state = ReadControllerState();
+    const int snapshot_index = count;
+    allocations_before = s_HeapAllocations;
+    results[count++] = {"TelemetrySnapshot (new)", TimeNsPerOp(iterations, [&] {
+        snapshot_state.timestamp_ms++;
+        PublishControllerState(snapshot_state); // A new tick, so every call builds
+        sink = sink + AcquireTelemetrySnapshot()->JsonLength(TelemetrySink::Push);
+    })};
+    const double snapshot_allocations = double(s_HeapAllocations - allocations_before) / iterations;
+    results[count++] = {"TelemetrySnapshot (hit)", TimeNsPerOp(iterations, [&] {
+        sink = sink + AcquireTelemetrySnapshot()->JsonLength(TelemetrySink::Push);
+    })};
+    bool snapshot_matches = true;
+    const std::shared_ptr<const TelemetrySnapshot> snapshot = AcquireTelemetrySnapshot();
+    const char* const sink_events[TELEMETRY_SINK_COUNT] = {"usb_stream", "auto_mqtt", "manual_fetch", "web_push"};
+    for (int i = 0; i < TELEMETRY_SINK_COUNT; i++) {
+        char expected[TELEMETRY_PAYLOAD_MAX_BYTES];
+        WriteTelemetryPayload(expected, sizeof(expected), snapshot->state, sink_events[i]);
+        snapshot_matches = snapshot_matches && strcmp(expected, snapshot->json[i]) == 0;
+    }
+    ControllerState history_state = ReadControllerState();
+    results[count++] = {"RecordHistorySample", TimeNsPerOp(iterations, [&] {
+        history_state.timestamp_ms += 1000;
+        RecordHistorySample(history_state);
+    })};
+    char history_chunk[1024];
+    size_t history_bytes = 0;
+    HistoryCursor history_cursor = OpenHistoryCursor(HistoryTier::Raw, 0);
+    const int history_index = count;
+    results[count++] = {"WriteHistoryChunk (1 KB)", TimeNsPerOp(iterations / 10, [&] {
+        size_t length = WriteHistoryChunk(history_cursor, history_chunk, sizeof(history_chunk));
+        if (length == 0) history_cursor = OpenHistoryCursor(HistoryTier::Raw, 0);
+        history_bytes += length;
+    })};
+    const double history_mb_per_s = history_bytes * 1000.0 / (results[history_index].ns_per_op * (iterations / 10));
+    SetUsbStreamRate(USB_STREAM_MAX_RATE_HZ);
+    uint8_t stream_frames[USB_STREAM_FLUSH_MAX_BYTES];
+    unsigned long stream_samples = 0;
+    // One capture per op plus a full batch drained every USB_STREAM_BATCH_SAMPLES ops
+    results[count++] = {"UsbStream capture+flush", TimeNsPerOp(iterations, [&] {
+        CaptureUsbStreamSample();
+        if (++stream_samples % USB_STREAM_BATCH_SAMPLES == 0) {
+            sink = sink + WriteUsbStreamFrames(stream_frames, sizeof(stream_frames));
+        }
+    })};
+    SetUsbStreamRate(0);
+    results[count++] = {"PlayLedEffect (rainbow)", TimeNsPerOp(iterations, [] { PlayLedEffect(0); })};
+    results[count++] = {"RenderScreen", TimeNsPerOp(iterations, [] { RenderScreen(ScreenView::Temperatures, "127.0.0.1"); })};
+
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    close(devnull);
+
+    fprintf(stderr, "%-26s %12s\n", "stage", "ns/op");
+    for (int i = 0; i < count; i++) {
+        fprintf(stderr, "%-26s %12.1f\n", results[i].name, results[i].ns_per_op);
+    }
+    fprintf(stderr, "%-26s %12s %12s\n", "telemetry payload", "MB/s", "allocs/op");
+    fprintf(stderr, "%-26s %12.1f %12.1f\n", results[reference_index].name,
+            reference_payload.size() * 1000.0 / results[reference_index].ns_per_op, reference_allocations);
+    fprintf(stderr, "%-26s %12.1f %12.1f\n", results[writer_index].name,
+            payload_bytes * 1000.0 / results[writer_index].ns_per_op, writer_allocations);
+    fprintf(stderr, "%-26s %12.1f %12.1f\n", results[snapshot_index].name,
+            payload_bytes * TELEMETRY_SINK_COUNT * 1000.0 / results[snapshot_index].ns_per_op, snapshot_allocations);
+    fprintf(stderr, "Telemetry payload %s the reference (%zu bytes)\n",
+            reference_payload == payload ? "matches" : "DIFFERS FROM", payload_bytes);
+    fprintf(stderr, "USB frame %zu bytes vs %zu bytes JSON line (%.1fx smaller)\n", usb_frame_bytes, payload_bytes + 1,
+            (payload_bytes + 1.0) / usb_frame_bytes);
+    fprintf(stderr, "Telemetry snapshot payloads %s per-sink serialization\n", snapshot_matches ? "match" : "DIFFER FROM");
+    fprintf(stderr, "History stream %.1f MB/s out of PSRAM rings\n", history_mb_per_s);
+    fprintf(stderr, "Thermistor table max error vs formula: %.4f C (0..100 C), %.4f C (-20..120 C)\n",
+            MaxThermistorTableError(0, 100), MaxThermistorTableError(-20, 120));
+}
+
+int main(int argc, char** argv) {
+    bool bench = false;
+    unsigned long minutes = 20;
+    unsigned long iterations = 100000;
+    FanControlMode mode = FanControlMode::Curve;
+    float setpoint = 0;
+    uint16_t stream_rate_hz = 0;
+    const char* flash_log_directory = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else if (strcmp(argv[i], "--minutes") == 0 && i + 1 < argc) {
+            minutes = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+            mode = ParseFanControlMode(argv[++i]);
+        } else if (strcmp(argv[i], "--setpoint") == 0 && i + 1 < argc) {
+            setpoint = strtof(argv[++i], nullptr);
+        } else if (strcmp(argv[i], "--stream") == 0 && i + 1 < argc) {
+            stream_rate_hz = static_cast<uint16_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--flash-log") == 0 && i + 1 < argc) {
+            flash_log_directory = argv[++i];
+        }
+    }
+
+    StartHistory();
+    if (flash_log_directory && !StartFlashLog(flash_log_directory)) {
+        return 1;
+    }
+    InitializeSimulation(mode, setpoint);
+    if (!SetUsbStreamRate(stream_rate_hz)) {
+        fprintf(stderr, "Unsupported stream rate %u Hz\n", stream_rate_hz);
+        return 1;
+    }
+    if (bench) {
+        HalSimAdvance(5000); // Let fans spin up so tach readings are live
+        RunBenchmarks(iterations);
+    } else {
+        RunSimulation(minutes, flash_log_directory);
+    }
+    return 0;
+}
+
+#endif // !ARDUINO && !PIO_UNIT_TESTING
@@ -1,48 +1,64 @@
 #include "peripherals_manager.h"
-
-void IRAM_ATTR Fan0TachIsr() { unsigned long m = millis(); if ((m - fan0_TS2) > FAN_DEBOUNCE_MS) { fan0_TS1 = fan0_TS2; fan0_TS2 = m; } }
-void IRAM_ATTR Fan1TachIsr() { unsigned long m = millis(); if ((m - fan1_TS2) > FAN_DEBOUNCE_MS) { fan1_TS1 = fan1_TS2; fan1_TS2 = m; } }
-void IRAM_ATTR Fan2TachIsr() { unsigned long m = millis(); if ((m - fan2_TS2) > FAN_DEBOUNCE_MS) { fan2_TS1 = fan2_TS2; fan2_TS2 = m; } }
-void IRAM_ATTR Fan3TachIsr() { unsigned long m = millis(); if ((m - fan3_TS2) > FAN_DEBOUNCE_MS) { fan3_TS1 = fan3_TS2; fan3_TS2 = m; } }
+#include "control_manager.h"
+#include "config_manager.h"
+#include "i2c_bus_manager.h"
+#include "hal.h"
+
+void IRAM_ATTR AdsAlertIsr() { ads_ReadyCount++; }
+
+// Tach edges are counted by a PCNT unit per fan, so there is no interrupt per
+// pulse. The only interrupt left is the counter overflow every 32k pulses.
+static bool InitializeTachCounter(int fan_index, uint8_t tach_pin) {
+    pcnt_unit_config_t unit_config = {};
+    unit_config.low_limit = -1;
+    unit_config.high_limit = TACH_PCNT_HIGH_LIMIT;
+    unit_config.flags.accum_count = 1;
+    pcnt_unit_handle_t unit = nullptr;
+    if (pcnt_new_unit(&unit_config, &unit) != ESP_OK) return false;
+
+    pcnt_glitch_filter_config_t filter_config = {};
+    filter_config.max_glitch_ns = TACH_GLITCH_FILTER_NS;
+    pcnt_unit_set_glitch_filter(unit, &filter_config);
+
+    pcnt_chan_config_t channel_config = {};
+    channel_config.edge_gpio_num = tach_pin;
+    channel_config.level_gpio_num = -1;
+    pcnt_channel_handle_t channel = nullptr;
+    if (pcnt_new_channel(unit, &channel_config, &channel) != ESP_OK) return false;
+    pcnt_channel_set_edge_action(channel, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_HOLD);
+
+    // The channel setup reconfigures the pin, put the board's pull-down back
+    gpio_pullup_dis((gpio_num_t)tach_pin);
+    gpio_pulldown_en((gpio_num_t)tach_pin);
+
+    pcnt_unit_add_watch_point(unit, TACH_PCNT_HIGH_LIMIT);
+    pcnt_unit_enable(unit);
+    pcnt_unit_clear_count(unit);
+    pcnt_unit_start(unit);
+    a_TachCounters[fan_index] = unit;
+    return true;
+}
 
 void InitializeAdc() {
     ads.setGain(GAIN_TWOTHIRDS);
+    ads.setDataRate(RATE_ADS1115_128SPS); // Matches ADC_CONVERSION_MS
+    I2cBusAcquire(I2cDevice::Adc);
     ads.begin();
-    Serial.println("ADS1115 configured.");
-}
+    I2cBusRelease(I2cDevice::Adc);
 
-double ReadTemperature(int channel) {
-    int16_t adc_raw = ads.readADC_SingleEnded(channel);
-    if (adc_raw < 0) {
-        Serial.printf("ADS read error on channel %d: %d\n", channel, adc_raw);
-        return -1; // Error reading ADC
-    } 
-    // With GAIN_TWOTHIRDS, the full-scale range is +/- 6.144V
-    // This corresponds to a resolution of 0.1875mV per bit.
-    // But it's better to calculate voltage based on the max value.
-    double voltage = (adc_raw * 6.144) / 32767.0;
-    
-    // The thermistor is in a voltage divider with a 10k resistor (T_REFERENCE_RESISTANCE)
-    // connected to 3.3V (ADC_VOLTAGE). The voltage is measured across the thermistor.
-    // V_out = V_in * R_thermistor / (R_ref + R_thermistor)
-    // Solving for R_thermistor:
-    // R_thermistor = R_ref * V_out / (V_in - V_out)
-    double resistance = T_REFERENCE_RESISTANCE * (voltage / (ADC_VOLTAGE - voltage));
-
-    const double inverse_kelvin = 1.0 / (T_NOMINAL_TEMPERATURE + 273.15) +
-                        log(resistance / T_NOMINAL_RESISTANCE) / T_B_VALUE;
-
-    double kelvin = 1.0 / inverse_kelvin;
-
-    double celsius = kelvin - 273.15;
-    
-    printf("Temperature on channel %d: %.2f C (Resistance: %.2f Ohm)\n", channel, celsius, resistance);
-
-    return celsius;
+    if (PIN_ADS_ALERT >= 0) {
+        pinMode(PIN_ADS_ALERT, INPUT_PULLUP); // ALERT/RDY is open-drain
+        attachInterrupt(digitalPinToInterrupt(PIN_ADS_ALERT), AdsAlertIsr, FALLING);
+        Serial.printf("Attached ISR to ADS ALERT/RDY (Pin %d)\n", PIN_ADS_ALERT);
+    }
+    Serial.println("ADS1115 configured.");
 }
 
 void InitializeScreen() {
-    if (!oledDisplay.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDR)) {
+    I2cBusAcquire(I2cDevice::Display);
+    bool display_ready = oledDisplay.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDR, true, false); // Wire is set up by the bus manager
+    I2cBusRelease(I2cDevice::Display);
+    if (!display_ready) {
         Serial.println(F("SSD1306 allocation failed"));
         while (true); // Halt
     }
@@ -50,7 +66,7 @@ void InitializeScreen() {
     oledDisplay.setTextColor(SSD1306_WHITE, SSD1306_BLACK);
     oledDisplay.setTextSize(1);
     oledDisplay.println("WaKu-ctl Starting...");
-    oledDisplay.display();
+    HalDisplayFlush();
     delay(1000);
     Serial.println("Display configured.");
 }
@@ -78,19 +94,20 @@ void InitializeOutputs() {
 void InitializeInputs() {
     pinMode(PIN_RESET_SETTINGS, INPUT_PULLUP);
     analogReadResolution(12); // Corresponds to ESP32_ANALOG_RESOLUTION (4095)
-    
-    void (*isr_functions[ACTIVE_FANS])() = {Fan0TachIsr, Fan1TachIsr, Fan2TachIsr, Fan3TachIsr};
 
     for (int i = 0; i < ACTIVE_FANS; i++) {
         int fan_id = a_FanIds[i];
-        uint8_t tach_pin = PIN_FAN_MAP[fan_id].tach_pin;
-        uint8_t pwm_pin = PIN_FAN_MAP[fan_id].pwm_pin;
+        uint8_t tach_pin = PIN_FANS[i].tach_pin;
+        uint8_t pwm_pin = PIN_FANS[i].pwm_pin;
 
         pinMode(tach_pin, INPUT_PULLDOWN);
         Serial.printf("Setting pull-down on TACH %d (Pin %d)\n", fan_id, tach_pin);
 
-        attachInterrupt(digitalPinToInterrupt(tach_pin), isr_functions[i], RISING);
-        Serial.printf("Attached ISR to TACH %d (Pin %d)\n", fan_id, tach_pin);
+        if (InitializeTachCounter(i, tach_pin)) {
+            Serial.printf("Attached pulse counter to TACH %d (Pin %d)\n", fan_id, tach_pin);
+        } else {
+            Serial.printf("Failed to attach pulse counter to TACH %d (Pin %d)\n", fan_id, tach_pin);
+        }
 
         ledcAttach(pwm_pin, PWM_SIGNAL_FREQUENCY_HZ, PWM_RESOLUTION_BITS);
         Serial.printf("Attaching PWM channel to FAN %d (Pin %d)\n", fan_id, pwm_pin);
@@ -104,6 +121,7 @@ void InitializeInputs() {
 
 void InitializeLeds() {
     uint8_t led_pins[ACTIVE_LED_STRIPS] = {PIN_LED_HEADER_1, PIN_LED_HEADER_2};
+    LedSettings leds[ACTIVE_LED_STRIPS]; // Defaults from types.h until loaded
 
     for (int i = 0; i < ACTIVE_LED_STRIPS; i++) {
         String led_prefs_key = "LED_" + String(i);
@@ -116,87 +134,34 @@ void InitializeLeds() {
 
         if (error || led_prefs == "{}") {
             Serial.printf("No/Invalid settings for %s, using defaults.\n", led_prefs_key.c_str());
-            // Use default constructor values from types.h
-            m_LedSettings[i] = LedSettings();
 
             // Save defaults back
-            led_doc["mode"] = m_LedSettings[i].mode;
-            led_doc["speed"] = m_LedSettings[i].speed;
-            led_doc["start_color"] = m_LedSettings[i].start_color;
-            led_doc["end_color"] = m_LedSettings[i].end_color;
-            led_doc["num_leds"] = m_LedSettings[i].num_leds;
+            led_doc["mode"] = leds[i].mode;
+            led_doc["speed"] = leds[i].speed;
+            led_doc["start_color"] = leds[i].start_color;
+            led_doc["end_color"] = leds[i].end_color;
+            led_doc["num_leds"] = leds[i].num_leds;
             String settings_json;
             serializeJson(led_doc, settings_json);
             systemPreferences.putString(led_prefs_key.c_str(), settings_json);
         } else {
-            m_LedSettings[i].prev_mode = -1; // Initialize to -1 to force initial mode change
-            m_LedSettings[i].mode = led_doc["mode"].as<uint8_t>();
-            m_LedSettings[i].speed = led_doc["speed"].as<uint8_t>();
-            m_LedSettings[i].start_color = led_doc["start_color"].as<uint32_t>();
-            m_LedSettings[i].end_color = led_doc["end_color"].as<uint32_t>();
-            m_LedSettings[i].num_leds = led_doc["num_leds"].as<uint8_t>();
+            leds[i].mode = led_doc["mode"].as<uint8_t>();
+            leds[i].speed = led_doc["speed"].as<uint8_t>();
+            leds[i].start_color = led_doc["start_color"].as<uint32_t>();
+            leds[i].end_color = led_doc["end_color"].as<uint32_t>();
+            leds[i].num_leds = led_doc["num_leds"].as<uint8_t>();
         }
 
-        Serial.printf("Adding LED %d: %d LEDs, Mode %d\n", i, m_LedSettings[i].num_leds, m_LedSettings[i].mode);
+        Serial.printf("Adding LED %d: %d LEDs, Mode %d\n", i, leds[i].num_leds, leds[i].mode);
         
         if (i == 0) FastLED.addLeds<WS2812B, PIN_LED_HEADER_1, GRB>(a_LedBuffers[i], MAX_LEDS_PER_STRIP);
         if (i == 1) FastLED.addLeds<WS2812B, PIN_LED_HEADER_2, GRB>(a_LedBuffers[i], MAX_LEDS_PER_STRIP);
     }
-}
-
-int MapFanPercentToPwm(int percentage) {
-    return MapValue(percentage, 0, 100, 0, 255);
-}
-
-int MapValue(int value, int from_low, int from_high, int to_low, int to_high) {
-    return (value - from_low) * (to_high - to_low) / (from_high - from_low) + to_low;
-}
-
-unsigned long ReadFanRpm(int fan_index) {
-    volatile unsigned long *ts1 = nullptr, *ts2 = nullptr;
-
-    switch (fan_index) {
-        case 0: ts1 = &fan0_TS1; ts2 = &fan0_TS2; break;
-        case 1: ts1 = &fan1_TS1; ts2 = &fan1_TS2; break;
-        case 2: ts1 = &fan2_TS1; ts2 = &fan2_TS2; break;
-        case 3: ts1 = &fan3_TS1; ts2 = &fan3_TS2; break;
-        default: return 0;
-    }
 
-    // Disable interrupts briefly to read volatile variables atomically
-    unsigned long current_millis = millis();
-    unsigned long t1_val, t2_val;
-    noInterrupts();
-    t1_val = *ts1;
-    t2_val = *ts2;
-    interrupts();
-
-    if ((current_millis - t2_val) < FAN_STUCK_THRESHOLD_MD && t2_val > t1_val) {
-        double delta_t = t2_val - t1_val;
-        double rpm = (60000.0 / delta_t) / 2.0; // /2 because 2 pulses per revolution
-        return (rpm > 0) ? static_cast<unsigned long>(rpm) : 0;
+    const bool loaded = UpdateControllerConfig([&](ControllerConfig& config) {
+        for (int i = 0; i < ACTIVE_LED_STRIPS; i++) config.leds[i] = leds[i];
+    });
+    if (!loaded) {
+        Serial.println("Saved LED settings rejected, running defaults.");
     }
-    return 0; // Stuck or no reading
-}
-
-int CalculateFanSpeed(int fan_id, float temperature) {
-    auto it = m_SensorSettings.find(fan_id);
-    if (it == m_SensorSettings.end()) {
-        return 0; // Sensor not found
-    }
-
-    const auto& curve = it->second.fan_speed_curve;
-    if (curve.empty()) {
-        return 0; // No curve defined
-    }
-
-    // Find the first threshold the temperature is below or equal to
-    for (const auto& point : curve) {
-        if (temperature <= point.temperature_threshold) {
-            return point.fan_duty_cycle;
-        }
-    }
-
-    // If temp is higher than all thresholds, use the last (highest) speed
-    return curve.back().fan_duty_cycle;
-}
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#include "pid_controller.h"
+
+static float Clamp(float value, float low, float high) {
+    return value < low ? low : (value > high ? high : value);
+}
+
+float UpdatePid(const PidSettings& settings, PidState& state, float measurement, bool reverse_acting,
+                float current_output, float dt_seconds) {
+    const float sign = reverse_acting ? 1.0f : -1.0f; // d(error) / d(measurement)
+    const float error = sign * (measurement - settings.setpoint);
+    const float low = settings.min_duty;
+    const float high = settings.max_duty;
+
+    if (!state.primed) {
+        // Pick the integral that reproduces the current output
+        state.integral = Clamp(current_output - settings.kp * error, low, high);
+        state.previous_measurement = measurement;
+        state.primed = true;
+    }
+
+    const float proportional = settings.kp * error;
+    float derivative = 0;
+    if (dt_seconds > 0) {
+        derivative = settings.kd * sign * (measurement - state.previous_measurement) / dt_seconds;
+    }
+    state.previous_measurement = measurement;
+
+    float integral = state.integral + settings.ki * error * dt_seconds;
+    const float unclamped = proportional + integral + derivative;
+    if ((unclamped > high && error > 0) || (unclamped < low && error < 0)) {
+        integral = state.integral; // Saturated, integrating further would only wind up
+    }
+    state.integral = Clamp(integral, low, high);
+
+    return Clamp(proportional + state.integral + derivative, low, high);
+}
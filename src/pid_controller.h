@@ -0,0 +1,15 @@
+#ifndef PID_CONTROLLER_H
+#define PID_CONTROLLER_H
+
+#include "types.h"
+
+// PID on one fan's duty. Reverse acting loops (temperature) add duty when the
+// measurement is above the setpoint, direct ones (RPM) when it is below.
+// The derivative acts on the measurement so setpoint changes do not kick, the
+// integral stops while the output is saturated (anti-windup), and an unprimed
+// state starts from current_output (bumpless transfer).
+
+float UpdatePid(const PidSettings& settings, PidState& state, float measurement, bool reverse_acting,
+                float current_output, float dt_seconds);
+
+#endif // PID_CONTROLLER_H
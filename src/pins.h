@@ -28,8 +28,15 @@ constexpr uint8_t PIN_LED_TSB_CTRL_2 = 37; // LED header #2 TSB Control
 
 // --- Thermistor Pins ---
 // Replaced by ADS1115
+constexpr int8_t PIN_ADS_ALERT = -1; // ADS1115 ALERT/RDY, -1 to pace conversions by time instead
 
 // --- Fan Pins ---
-extern std::map<int, FanPinPair> PIN_FAN_MAP;
+// Tach and PWM pin by fan index (see a_FanIds)
+constexpr FanPinPair PIN_FANS[ACTIVE_FANS] = {
+    {14, 13},
+    {12, 11},
+    {10, 9},
+    {7, 6}
+};
 
 #endif // PINS_H
\ No newline at end of file
@@ -0,0 +1,78 @@
+#ifndef RCU_H
+#define RCU_H
+
+#include <atomic>
+#include <memory>
+#include "hal.h"
+
+// Read-copy-update cell for settings read far more often than they change.
+// Readers pin the current version with a ReadGuard: one counter increment and
+// one pointer load, no lock and no retry, so a reader never waits on a writer.
+// A writer builds the next version off to the side, swaps the pointer, then
+// waits until every reader that could still hold the previous version has
+// let go (the grace period) before freeing it. Writers must be serialized by
+// the caller and must not hold a ReadGuard on the same cell while publishing.
+template <typename T>
+class RcuCell {
+public:
+    class ReadGuard {
+    public:
+        explicit ReadGuard(const RcuCell& cell) : m_Cell(&cell) {
+            // Count ourselves in before loading the pointer: a writer that
+            // then sees zero readers has already swapped, so we get the new one
+            m_Cell->m_Readers.fetch_add(1, std::memory_order_seq_cst);
+            m_Value = m_Cell->m_Current.load(std::memory_order_seq_cst);
+        }
+        ReadGuard(ReadGuard&& other) : m_Cell(other.m_Cell), m_Value(other.m_Value) {
+            other.m_Cell = nullptr;
+        }
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+        ~ReadGuard() {
+            if (m_Cell) m_Cell->m_Readers.fetch_sub(1, std::memory_order_release);
+        }
+
+        const T& operator*() const { return *m_Value; }
+        const T* operator->() const { return m_Value; }
+
+    private:
+        const RcuCell* m_Cell;
+        const T* m_Value;
+    };
+
+    RcuCell() : m_Current(new T()) {}
+    explicit RcuCell(T* initial) : m_Current(initial) {}
+    ~RcuCell() { delete m_Current.load(); }
+    RcuCell(const RcuCell&) = delete;
+    RcuCell& operator=(const RcuCell&) = delete;
+
+    ReadGuard Read() const {
+        return ReadGuard(*this);
+    }
+
+    // Writer side only: the version the next one should be copied from
+    const T& Current() const {
+        return *m_Current.load(std::memory_order_acquire);
+    }
+
+    // Returns once the previous version has been reclaimed
+    void Publish(std::unique_ptr<T> next) {
+        const T* previous = m_Current.exchange(next.release(), std::memory_order_seq_cst);
+        m_Generation.fetch_add(1, std::memory_order_release);
+        while (m_Readers.load(std::memory_order_seq_cst) != 0) {
+            HalYield(); // Readers hold a version for microseconds, let them finish
+        }
+        delete previous;
+    }
+
+    uint32_t Generation() const {
+        return m_Generation.load(std::memory_order_acquire);
+    }
+
+private:
+    std::atomic<const T*> m_Current;
+    mutable std::atomic<uint32_t> m_Readers{0};
+    std::atomic<uint32_t> m_Generation{0};
+};
+
+#endif // RCU_H
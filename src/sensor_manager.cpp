@@ -0,0 +1,108 @@
+#include "sensor_manager.h"
+#include "config_manager.h"
+#include "hal.h"
+#include "seqlock.h"
+#include "thermistor_table.h"
+#include "signal_filter.h"
+
+struct TemperatureFilterSettings {
+    FilterSettings channels[ACTIVE_THERMISTORS];
+};
+
+static constexpr ThermistorTables THERMISTOR_TABLES = BuildThermistorTables();
+static Seqlock<TemperatureSnapshot> s_TemperatureSnapshot;
+static TemperatureSnapshot s_SamplerSnapshot; // Sampler's working copy
+static uint8_t s_SamplerChannel = 0;
+static Seqlock<TemperatureFilterSettings> s_TemperatureFilterSettings;
+static FilterState a_TemperatureFilters[ACTIVE_THERMISTORS]; // Sampler only
+static const char* const a_TemperatureSensorNames[ACTIVE_THERMISTORS] = {"TEMP_1", "TEMP_2"};
+
+void StartTemperatureSampler() {
+    s_SamplerChannel = 0;
+    HalAdcSelectChannel(s_SamplerChannel);
+}
+
+bool PollTemperatureSampler() {
+    if (!HalAdcConversionReady()) {
+        return false;
+    }
+
+    TemperatureSample& sample = s_SamplerSnapshot.channels[s_SamplerChannel];
+    sample.adc_raw = HalAdcReadLatest();
+    sample.timestamp_ms = HalMillis();
+    sample.valid = sample.adc_raw >= 0;
+    if (sample.valid) {
+        const FilterSettings filter = s_TemperatureFilterSettings.Read().channels[s_SamplerChannel];
+        sample.celsius = ApplyFilter(filter, a_TemperatureFilters[s_SamplerChannel],
+                                     ConvertAdcToCelsius(s_SamplerChannel, sample.adc_raw));
+    }
+    s_TemperatureSnapshot.Write(s_SamplerSnapshot);
+
+    // Move the mux on so the next conversion is already running while we wait
+    s_SamplerChannel = (s_SamplerChannel + 1) % ACTIVE_THERMISTORS;
+    HalAdcSelectChannel(s_SamplerChannel);
+    return true;
+}
+
+double ConvertAdcToCelsius(uint8_t channel, int16_t adc_raw) {
+    if (adc_raw < 0) {
+        Serial.printf("ADS read error: %d\n", adc_raw);
+        return -1; // Error reading ADC
+    }
+    if (channel >= ACTIVE_THERMISTORS) {
+        return -1;
+    }
+    const int32_t* table = THERMISTOR_TABLES.channels[channel].millicelsius;
+    const int32_t raw = adc_raw < THERMISTOR_TABLE_MAX_RAW ? adc_raw : THERMISTOR_TABLE_MAX_RAW;
+    const int index = raw >> THERMISTOR_TABLE_SHIFT;
+    const int32_t fraction = raw & (THERMISTOR_TABLE_STEP - 1);
+    const int32_t low = table[index];
+    const int32_t high = table[index + 1];
+    return (low + (high - low) * fraction / THERMISTOR_TABLE_STEP) / 1000.0;
+}
+
+const char* TemperatureSensorName(int channel) {
+    return (channel >= 0 && channel < ACTIVE_THERMISTORS) ? a_TemperatureSensorNames[channel] : "N/A";
+}
+
+int ParseTemperatureSensor(const char* name) {
+    for (int channel = 0; name != nullptr && channel < ACTIVE_THERMISTORS; channel++) {
+        if (strcmp(name, a_TemperatureSensorNames[channel]) == 0) return channel;
+    }
+    return -1;
+}
+
+void ConfigureTemperatureFilters() {
+    // A channel is filtered as smoothly as the most demanding fan that follows it
+    TemperatureFilterSettings settings;
+    bool configured[ACTIVE_THERMISTORS] = {};
+    const ControllerConfigGuard config = ReadControllerConfig();
+    for (const auto& fan_settings : config->fans) {
+        const int channel = fan_settings.sensor_channel;
+        settings.channels[channel] = configured[channel]
+            ? MergeFilterSettings(settings.channels[channel], fan_settings.temperature_filter)
+            : fan_settings.temperature_filter;
+        configured[channel] = true;
+    }
+    s_TemperatureFilterSettings.Write(settings);
+}
+
+TemperatureSnapshot GetTemperatureSnapshot() {
+    return s_TemperatureSnapshot.Read();
+}
+
+bool HasTemperatureSamples() {
+    // One publish per conversion, channels in order
+    return s_TemperatureSnapshot.Version() >= ACTIVE_THERMISTORS;
+}
+
+double ReadTemperature(int channel) {
+    if (channel < 0 || channel >= ACTIVE_THERMISTORS) {
+        return -1;
+    }
+    TemperatureSample sample = s_TemperatureSnapshot.Read().channels[channel];
+    if (!sample.valid || HalMillis() - sample.timestamp_ms > ADC_SAMPLE_STALE_MS) {
+        return -1; // No reading yet or the sampler stopped
+    }
+    return sample.celsius;
+}
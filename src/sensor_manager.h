@@ -0,0 +1,34 @@
+#ifndef SENSOR_MANAGER_H
+#define SENSOR_MANAGER_H
+
+#include "controller_state.h"
+
+struct TemperatureSample {
+    int16_t adc_raw = -1;
+    double celsius = -1;
+    unsigned long timestamp_ms = 0;
+    bool valid = false;
+};
+
+struct TemperatureSnapshot {
+    TemperatureSample channels[ACTIVE_THERMISTORS];
+};
+
+// Sampler side: only the sampling task (or the native simulation loop) talks to the ADC.
+void StartTemperatureSampler();
+bool PollTemperatureSampler();
+double ConvertAdcToCelsius(uint8_t channel, int16_t adc_raw);
+
+// "TEMP_1".. in the fan settings JSON, resolved to a channel once when loaded
+const char* TemperatureSensorName(int channel);
+int ParseTemperatureSensor(const char* name);
+
+// Rebuilds the per-channel filter chains from the current fan settings
+void ConfigureTemperatureFilters();
+
+// Consumer side: reads the latest published snapshot, never touches the bus.
+TemperatureSnapshot GetTemperatureSnapshot();
+bool HasTemperatureSamples();
+double ReadTemperature(int channel);
+
+#endif // SENSOR_MANAGER_H
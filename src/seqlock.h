@@ -0,0 +1,47 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include "hal.h"
+
+// Single-writer snapshot shared across tasks. The writer bumps the sequence to
+// odd, copies the value and bumps it back to even; readers copy the value and
+// retry if the sequence moved underneath them. Readers never block the writer
+// and never take a lock. The write runs inside a HAL critical section so a
+// reader preempting the writer on the same core cannot spin on a half-written
+// value.
+template <typename T>
+class Seqlock {
+public:
+    void Write(const T& value) {
+        HalEnterCritical();
+        uint32_t sequence = m_Sequence.load(std::memory_order_relaxed);
+        m_Sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_Value = value;
+        m_Sequence.store(sequence + 2, std::memory_order_release);
+        HalExitCritical();
+    }
+
+    T Read() const {
+        T copy;
+        uint32_t before, after;
+        do {
+            before = m_Sequence.load(std::memory_order_acquire);
+            copy = m_Value;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = m_Sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        return copy;
+    }
+
+    uint32_t Version() const {
+        return m_Sequence.load(std::memory_order_acquire) >> 1;
+    }
+
+private:
+    std::atomic<uint32_t> m_Sequence{0};
+    T m_Value{};
+};
+
+#endif // SEQLOCK_H
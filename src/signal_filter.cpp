@@ -0,0 +1,58 @@
+#include "signal_filter.h"
+#include <math.h>
+
+float ApplyFilter(const FilterSettings& settings, FilterState& state, float value) {
+    if (!state.primed) {
+        ResetFilter(state);
+        state.primed = true;
+        state.last_input = value;
+        state.output = value;
+    } else if (settings.spike_threshold > 0 &&
+               fabsf(value - state.last_input) > settings.spike_threshold &&
+               state.rejected < FILTER_SPIKE_MAX_REJECTS) {
+        state.rejected++;
+        return state.output; // Hold the last output over an outlier
+    }
+    state.rejected = 0;
+    state.last_input = value;
+
+    state.window[state.head] = value;
+    state.head = (state.head + 1) % FILTER_MAX_MEDIAN_WINDOW;
+    if (state.count < FILTER_MAX_MEDIAN_WINDOW) state.count++;
+
+    float median = value;
+    int window = settings.median_window < state.count ? settings.median_window : state.count;
+    if (window > 1) {
+        // Insertion sort of at most FILTER_MAX_MEDIAN_WINDOW values
+        float sorted[FILTER_MAX_MEDIAN_WINDOW];
+        for (int i = 0; i < window; i++) {
+            float v = state.window[(state.head - 1 - i + FILTER_MAX_MEDIAN_WINDOW) % FILTER_MAX_MEDIAN_WINDOW];
+            int j = i;
+            while (j > 0 && sorted[j - 1] > v) {
+                sorted[j] = sorted[j - 1];
+                j--;
+            }
+            sorted[j] = v;
+        }
+        median = sorted[window / 2];
+    }
+
+    float alpha = settings.ema_alpha;
+    if (alpha <= 0 || alpha > 1) alpha = 1;
+    state.output += alpha * (median - state.output);
+    return state.output;
+}
+
+void ResetFilter(FilterState& state) {
+    state = FilterState();
+}
+
+FilterSettings MergeFilterSettings(const FilterSettings& a, const FilterSettings& b) {
+    FilterSettings merged;
+    merged.median_window = a.median_window > b.median_window ? a.median_window : b.median_window;
+    merged.ema_alpha = a.ema_alpha < b.ema_alpha ? a.ema_alpha : b.ema_alpha;
+    if (a.spike_threshold <= 0) merged.spike_threshold = b.spike_threshold;
+    else if (b.spike_threshold <= 0) merged.spike_threshold = a.spike_threshold;
+    else merged.spike_threshold = a.spike_threshold < b.spike_threshold ? a.spike_threshold : b.spike_threshold;
+    return merged;
+}
@@ -0,0 +1,16 @@
+#ifndef SIGNAL_FILTER_H
+#define SIGNAL_FILTER_H
+
+#include "types.h"
+
+// Allocation-free filter chain for one input channel: a spike rejector, then
+// the median of the last N accepted values, then an EMA. State lives in a
+// caller-owned FilterState, so each channel keeps its own fixed ring buffer.
+
+float ApplyFilter(const FilterSettings& settings, FilterState& state, float value);
+void ResetFilter(FilterState& state);
+
+// Smoothest of the two: widest median, lowest alpha, tightest spike threshold
+FilterSettings MergeFilterSettings(const FilterSettings& a, const FilterSettings& b);
+
+#endif // SIGNAL_FILTER_H
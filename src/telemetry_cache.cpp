@@ -0,0 +1,82 @@
+#include "telemetry_cache.h"
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <mutex>
+#include <string.h>
+#include "telemetry_manager.h"
+
+static const char* const a_TelemetrySinkEvents[TELEMETRY_SINK_COUNT] = {"usb_stream", "auto_mqtt", "manual_fetch", "web_push"};
+
+// Preallocated on first use and reused once no sink holds them any more, so a
+// new tick does not touch the heap. Only if every slot is still held (e.g. by
+// slow HTTP clients) is an extra snapshot allocated for that tick.
+static std::shared_ptr<TelemetrySnapshot> a_TelemetrySnapshotPool[TELEMETRY_SNAPSHOT_POOL_SIZE];
+static std::shared_ptr<const TelemetrySnapshot> s_TelemetrySnapshot;
+static uint32_t s_TelemetrySnapshotsBuilt = 0;
+static std::mutex s_TelemetrySnapshotMutex; // Serializes the check-and-build, readers of a snapshot never lock
+
+// Serializes once with an empty event, then copies that document per sink
+// with the sink's event name inserted between the quotes
+static void BuildSinkPayloads(TelemetrySnapshot& snapshot) {
+    char base[TELEMETRY_PAYLOAD_MAX_BYTES];
+    const size_t base_length = WriteTelemetryPayload(base, sizeof(base), snapshot.state, "");
+    const char* event = base_length ? strstr(base, "\"event\":\"\"") : nullptr;
+    if (event == nullptr) {
+        return; // Did not fit, every length stays 0
+    }
+    const size_t head_length = event - base + strlen("\"event\":\"");
+    const size_t tail_length = base_length - head_length;
+
+    for (int i = 0; i < TELEMETRY_SINK_COUNT; i++) {
+        const size_t name_length = strlen(a_TelemetrySinkEvents[i]);
+        const size_t length = base_length + name_length;
+        if (length >= TELEMETRY_PAYLOAD_MAX_BYTES) {
+            continue;
+        }
+        char* out = snapshot.json[i];
+        memcpy(out, base, head_length);
+        memcpy(out + head_length, a_TelemetrySinkEvents[i], name_length);
+        memcpy(out + head_length + name_length, base + head_length, tail_length);
+        out[length] = '\0';
+        snapshot.json_length[i] = length;
+    }
+}
+
+// Caller holds s_TelemetrySnapshotMutex. A slot whose only owner is the pool
+// cannot gain a reader outside the mutex, so it is safe to rewrite in place.
+static std::shared_ptr<TelemetrySnapshot> AcquireFreeSnapshot() {
+    for (auto& slot : a_TelemetrySnapshotPool) {
+        if (!slot) {
+            slot = std::make_shared<TelemetrySnapshot>();
+            return slot;
+        }
+        if (slot.use_count() == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire); // Pairs with the last reader's release
+            std::fill(std::begin(slot->json_length), std::end(slot->json_length), 0); // The rest is rewritten by the caller
+            return slot;
+        }
+    }
+    return std::make_shared<TelemetrySnapshot>();
+}
+
+std::shared_ptr<const TelemetrySnapshot> AcquireTelemetrySnapshot() {
+    std::lock_guard<std::mutex> lock(s_TelemetrySnapshotMutex);
+    const uint32_t version = ControllerStateVersion();
+    if (s_TelemetrySnapshot && s_TelemetrySnapshot->state_version == version) {
+        return s_TelemetrySnapshot;
+    }
+
+    std::shared_ptr<TelemetrySnapshot> snapshot = AcquireFreeSnapshot();
+    snapshot->state_version = version;
+    snapshot->state = ReadControllerState(); // May already be newer than version, then the next reader rebuilds
+    BuildSinkPayloads(*snapshot);
+    s_TelemetrySnapshot = snapshot;
+    s_TelemetrySnapshotsBuilt++;
+    return s_TelemetrySnapshot;
+}
+
+uint32_t TelemetrySnapshotsBuilt() {
+    std::lock_guard<std::mutex> lock(s_TelemetrySnapshotMutex);
+    return s_TelemetrySnapshotsBuilt;
+}
@@ -0,0 +1,35 @@
+#ifndef TELEMETRY_CACHE_H
+#define TELEMETRY_CACHE_H
+
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include "controller_state.h"
+
+// --- Telemetry Snapshot ---
+// One control tick's telemetry, built at most once per tick on first demand
+// and shared by every sink: the canonical ControllerState plus the JSON
+// payload for each sink (same document, only "event" differs, spliced from
+// one serialization). Snapshots are immutable; a sink keeps one alive for as
+// long as it holds the shared_ptr, e.g. until an async HTTP response is sent,
+// while newer ticks replace the cached one. Serialization therefore costs
+// the same whether one sink or twenty read a tick, and snapshots come from a
+// small preallocated pool, so building one does not allocate either.
+
+struct TelemetrySnapshot {
+    uint32_t state_version = 0; // ControllerStateVersion() it was built from
+    ControllerState state;
+    char json[TELEMETRY_SINK_COUNT][TELEMETRY_PAYLOAD_MAX_BYTES];
+    size_t json_length[TELEMETRY_SINK_COUNT] = {}; // 0 if the payload did not fit
+
+    const char* Json(TelemetrySink sink) const { return json[static_cast<int>(sink)]; }
+    size_t JsonLength(TelemetrySink sink) const { return json_length[static_cast<int>(sink)]; }
+};
+
+// Any task. The cached snapshot while the control loop has not published a
+// newer state, otherwise builds and caches a new one.
+std::shared_ptr<const TelemetrySnapshot> AcquireTelemetrySnapshot();
+// Snapshots built so far, one per control tick that had a reader
+uint32_t TelemetrySnapshotsBuilt();
+
+#endif // TELEMETRY_CACHE_H
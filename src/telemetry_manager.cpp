@@ -0,0 +1,127 @@
+#include "telemetry_manager.h"
+#include <math.h>
+#include "json_writer.h"
+
+// Temperature as the payload reports it: user units, 0 for N/A
+static double ReportedTemperature(double celsius) {
+    if (!(celsius > -90.0)) return 0.0;
+    return systemSettings.units == "F" ? (celsius * 1.8) + 32 : celsius;
+}
+
+static void BeginTelemetryPayload(JsonWriter& payload, const char* event) {
+    payload.BeginObject();
+    payload.Key("client_id");
+    payload.StringValue(espChipIdStr.c_str());
+    payload.Key("event");
+    payload.StringValue(event);
+    payload.Key("units");
+    payload.StringValue(systemSettings.units.c_str());
+    payload.Key("data");
+    payload.BeginObject();
+}
+
+static size_t EndTelemetryPayload(JsonWriter& payload, char* buffer, size_t size) {
+    payload.EndObject();
+    payload.EndObject();
+    if (payload.Overflowed()) {
+        if (size > 0) buffer[0] = '\0'; // Never hand out a truncated document
+        return 0;
+    }
+    return payload.Length();
+}
+
+static void WriteTemperatureField(JsonWriter& payload, int channel, double celsius) {
+    payload.IndexedKey("temperature", channel + 1);
+    payload.DecimalValue(ReportedTemperature(celsius), 1);
+}
+
+static void WriteRpmField(JsonWriter& payload, int fan_index, unsigned long rpm) {
+    payload.IndexedKey("FAN_", a_FanIds[fan_index]);
+    payload.UnsignedValue(rpm);
+}
+
+size_t WriteTelemetryPayload(char* buffer, size_t size, const ControllerState& state, const char* event) {
+    JsonWriter payload(buffer, size);
+    BeginTelemetryPayload(payload, event);
+    for (int i = 0; i < ACTIVE_THERMISTORS; ++i) {
+        WriteTemperatureField(payload, i, state.temperatures[i]);
+    }
+    for (int i = 0; i < ACTIVE_FANS; ++i) {
+        WriteRpmField(payload, i, state.fans[i].rpm);
+    }
+    return EndTelemetryPayload(payload, buffer, size);
+}
+
+size_t WriteTelemetryPayload(char* buffer, size_t size, const char* event) {
+    return WriteTelemetryPayload(buffer, size, ReadControllerState(), event);
+}
+
+void SetTelemetryBaseline(TelemetryBaseline& baseline, const ControllerState& state) {
+    baseline.valid = true;
+    for (int i = 0; i < ACTIVE_THERMISTORS; ++i) baseline.temperatures[i] = state.temperatures[i];
+    for (int i = 0; i < ACTIVE_FANS; ++i) baseline.rpm[i] = state.fans[i].rpm;
+    baseline.temp_alarm_firing = state.temp_alarm_firing;
+    baseline.rpm_alarm_firing = state.rpm_alarm_firing;
+}
+
+static bool TemperatureMoved(double sent, double now) {
+    const bool sent_valid = sent > -90.0;
+    const bool now_valid = now > -90.0;
+    if (sent_valid != now_valid) return true; // Sensor dropped out or came back
+    return now_valid && fabs(now - sent) >= TELEMETRY_DEADBAND_CELSIUS;
+}
+
+static bool RpmMoved(unsigned long sent, unsigned long now) {
+    const unsigned long difference = now > sent ? now - sent : sent - now;
+    const unsigned long deadband = sent * TELEMETRY_DEADBAND_RPM_PERCENT / 100;
+    return difference >= (deadband > TELEMETRY_DEADBAND_RPM_MIN ? deadband : TELEMETRY_DEADBAND_RPM_MIN);
+}
+
+size_t WriteTelemetryChanges(char* buffer, size_t size, const ControllerState& state, TelemetryBaseline& baseline) {
+    if (!baseline.valid || state.temp_alarm_firing != baseline.temp_alarm_firing ||
+        state.rpm_alarm_firing != baseline.rpm_alarm_firing) {
+        // An alarm threshold was crossed either way: everything, right now
+        size_t length = WriteTelemetryPayload(buffer, size, state, baseline.valid ? "threshold" : "full");
+        if (length > 0) {
+            SetTelemetryBaseline(baseline, state);
+        }
+        return length;
+    }
+
+    bool temperature_moved[ACTIVE_THERMISTORS];
+    bool rpm_moved[ACTIVE_FANS];
+    bool any_moved = false;
+    for (int i = 0; i < ACTIVE_THERMISTORS; ++i) {
+        temperature_moved[i] = TemperatureMoved(baseline.temperatures[i], state.temperatures[i]);
+        any_moved |= temperature_moved[i];
+    }
+    for (int i = 0; i < ACTIVE_FANS; ++i) {
+        rpm_moved[i] = RpmMoved(baseline.rpm[i], state.fans[i].rpm);
+        any_moved |= rpm_moved[i];
+    }
+    if (!any_moved) {
+        if (size > 0) buffer[0] = '\0';
+        return 0;
+    }
+
+    JsonWriter payload(buffer, size);
+    BeginTelemetryPayload(payload, "delta");
+    for (int i = 0; i < ACTIVE_THERMISTORS; ++i) {
+        if (temperature_moved[i]) WriteTemperatureField(payload, i, state.temperatures[i]);
+    }
+    for (int i = 0; i < ACTIVE_FANS; ++i) {
+        if (rpm_moved[i]) WriteRpmField(payload, i, state.fans[i].rpm);
+    }
+    size_t length = EndTelemetryPayload(payload, buffer, size);
+    if (length == 0) {
+        return 0;
+    }
+    // Only what was sent moves the baseline, so slow drifts still add up to a delta
+    for (int i = 0; i < ACTIVE_THERMISTORS; ++i) {
+        if (temperature_moved[i]) baseline.temperatures[i] = state.temperatures[i];
+    }
+    for (int i = 0; i < ACTIVE_FANS; ++i) {
+        if (rpm_moved[i]) baseline.rpm[i] = state.fans[i].rpm;
+    }
+    return length;
+}
@@ -0,0 +1,34 @@
+#ifndef TELEMETRY_MANAGER_H
+#define TELEMETRY_MANAGER_H
+
+#include <stddef.h>
+#include "controller_state.h"
+
+// Formats the latest controller state as the telemetry JSON straight into the
+// caller's buffer (TELEMETRY_PAYLOAD_MAX_BYTES fits any event name up to 32
+// characters). Returns the length, or 0 if the payload did not fit.
+size_t WriteTelemetryPayload(char* buffer, size_t size, const char* event = "default");
+// Same for a state the caller already has, see telemetry_cache.h
+size_t WriteTelemetryPayload(char* buffer, size_t size, const ControllerState& state, const char* event);
+
+// --- On-change Telemetry ---
+// What one consumer last sent per field. Deltas go out when a field moves
+// past its deadband (TELEMETRY_DEADBAND_CELSIUS, TELEMETRY_DEADBAND_RPM_PERCENT
+// of the last sent RPM, at least TELEMETRY_DEADBAND_RPM_MIN), between full
+// heartbeat payloads.
+struct TelemetryBaseline {
+    bool valid = false;
+    double temperatures[ACTIVE_THERMISTORS] = {};
+    unsigned long rpm[ACTIVE_FANS] = {};
+    bool temp_alarm_firing = false;
+    bool rpm_alarm_firing = false;
+};
+
+// After a full payload of state went out
+void SetTelemetryBaseline(TelemetryBaseline& baseline, const ControllerState& state);
+// Event "delta" with only the fields past their deadband, or 0 if none moved.
+// An alarm turning on or off gives the full payload with event "threshold"
+// instead, and so does a baseline that was never set, with event "full".
+size_t WriteTelemetryChanges(char* buffer, size_t size, const ControllerState& state, TelemetryBaseline& baseline);
+
+#endif // TELEMETRY_MANAGER_H
@@ -1,13 +1,22 @@
 #ifndef TYPES_H
 #define TYPES_H
 
+#include <atomic>
 #include <string>
 #include <vector>
 #include <Arduino.h> // For String
+#include "config_constants.h"
 
 // --- Enums ---
 enum class LedChannel { Internal, External };
 enum class ScreenView { Overview, Temperatures, Fans, Rgb };
+enum class FanControlMode { Curve, PidTemperature, PidRpm };
+enum class I2cDevice { Adc, Display }; // Declaration order is bus priority, most urgent first
+enum class UsbTelemetryMode { Json, Binary };
+enum class WifiLinkState { AccessPoint, Connecting, Connected, Backoff };
+enum class MqttLinkState { Disabled, WaitingForWifi, Connected, Backoff };
+enum class TelemetrySink : uint8_t { Usb, Mqtt, Http, Push }; // Consumers of the shared telemetry snapshot
+enum class UsbRecordType : uint8_t { Hello = 1, Telemetry = 2, StreamBatch = 3 };
 
 // --- Structs ---
 struct Settings {
@@ -17,7 +26,7 @@ struct Settings {
   String hostname;
   bool setup_done = false;
   bool offline_mode = true;
-  int telemetry_interval = 30000;
+  std::atomic<int> telemetry_interval{30000}; // Also set by the MQTT task (telemetry_interval command)
   String units = "C";
 
   // MQTT settings
@@ -34,16 +43,69 @@ struct FanSpeedPoint {
   int fan_duty_cycle;
 };
 
+// Filter chain for one input, see signal_filter.h. A median window of 1, an
+// EMA alpha of 1 or a spike threshold of 0 turns that stage off.
+struct FilterSettings {
+  uint8_t median_window = 1;
+  float ema_alpha = 1.0f;
+  float spike_threshold = 0;
+};
+
+struct FilterState {
+  float window[FILTER_MAX_MEDIAN_WINDOW] = {};
+  uint8_t head = 0;
+  uint8_t count = 0;
+  uint8_t rejected = 0;
+  bool primed = false;
+  float last_input = 0;
+  float output = 0;
+};
+
+// Closed-loop mode, see pid_controller.h. Output limits are PWM duty counts.
+struct PidSettings {
+  float setpoint = PID_TEMP_DEFAULT_SETPOINT;
+  float kp = PID_TEMP_DEFAULT_KP;
+  float ki = PID_TEMP_DEFAULT_KI;
+  float kd = PID_TEMP_DEFAULT_KD;
+  int min_duty = 51; // 20%, the quietest speed the loop may settle at
+  int max_duty = 255;
+};
+
+struct PidState {
+  bool primed = false;
+  float integral = 0;
+  float previous_measurement = 0;
+};
+
 struct TemperatureSensorSettings {
-  String sensor_name;
+  int8_t sensor_channel = 0; // Thermistor channel this fan follows, -1 if the name did not resolve
   int temperature_alarm_threshold = 999;
   int rpm_alarm_threshold = -1;
-  uint8_t step_duration_seconds = 1;
+  float ramp_up_rate = FAN_RAMP_DEFAULT_UP_RATE;
+  float ramp_down_rate = FAN_RAMP_DEFAULT_DOWN_RATE;
   std::vector<FanSpeedPoint> fan_speed_curve;
+  float hysteresis = FAN_CURVE_DEFAULT_HYSTERESIS;
+  FanControlMode control_mode = FanControlMode::Curve;
+  PidSettings pid;
+  FilterSettings temperature_filter = {3, 0.5f, 2.0f}; // Applied to the bound sensor's channel
+  FilterSettings rpm_filter = {3, 1.0f, 0};
+  int16_t duty_override = -1; // Runtime only (MQTT fan_duty command): ramps to this duty instead of the control mode
+};
+
+// Fan curve as the control loop evaluates it: points sorted by temperature,
+// compiled from fan_speed_curve whenever the settings change
+struct CompiledFanCurve {
+  uint8_t count = 0;
+  float temperatures[FAN_CURVE_MAX_POINTS] = {};
+  float duties[FAN_CURVE_MAX_POINTS] = {};
+  float hysteresis = 0;
+};
+
+struct CompiledFanCurves {
+  CompiledFanCurve fans[ACTIVE_FANS];
 };
 
 struct LedSettings {
-  uint8_t prev_mode = 1;
   uint8_t mode = 1;
   uint8_t speed = 100;
   uint8_t num_leds = 32;
@@ -51,14 +113,81 @@ struct LedSettings {
   uint32_t end_color = 0xFF00FF;
 };
 
-struct FanRpmTarget {
-  unsigned long start_time_ms = 0;
-  int step_value = 0;
-  int current_rpm = 0;
-  int target_rpm = 0;
+// Fan and LED settings as one immutable version. A change copies the current
+// version, edits and validates the copy, then publishes it in one pointer swap.
+struct ControllerConfig {
+  TemperatureSensorSettings fans[ACTIVE_FANS]; // By fan index, see a_FanIds
+  CompiledFanCurves curves;                    // Compiled from fans[] before publishing
+  LedSettings leds[ACTIVE_LED_STRIPS];
+};
+
+// Pulse count snapshots for one fan, oldest overwritten first
+struct TachWindow {
+  uint32_t pulses[TACH_WINDOW_SAMPLES] = {};
+  unsigned long time_us[TACH_WINDOW_SAMPLES] = {};
+  int newest = 0;
+  int count = 0;
+  uint32_t last_pulses = 0;
+  unsigned long last_pulse_ms = 0;
+};
+
+// PWM duty the ramp is moving a fan towards. current_duty keeps the fraction
+// a slow ramp gains per tick.
+struct FanDutyTarget {
+  float current_duty = 0;
+  int target_duty = 0;
   bool is_adjusting = false;
 };
 
+// Live fan reading and output, as published by the control loop
+struct FanState {
+  unsigned long rpm = 0;
+  int target_duty = 0;
+  int current_duty = 0;
+  bool is_adjusting = false;
+};
+
+// One consistent control-loop sample, see ReadControllerState()
+struct ControllerState {
+  unsigned long timestamp_ms = 0;
+  double temperatures[ACTIVE_THERMISTORS] = {};
+  FanState fans[ACTIVE_FANS];
+  bool temp_alarm_firing = false;
+  bool rpm_alarm_firing = false;
+};
+
+// Raw inputs and outputs at one stream tick. Pulse counts wrap; the host
+// differences them over whatever window it wants an RPM for.
+struct UsbStreamSample {
+  uint32_t timestamp_us = 0;
+  int16_t centi_celsius[ACTIVE_THERMISTORS] = {};
+  uint16_t tach_pulses[ACTIVE_FANS] = {};
+  uint8_t duty[ACTIVE_FANS] = {};
+};
+
+// Per-device bus counters, see GetI2cBusStats()
+struct I2cBusStats {
+  uint32_t transactions = 0;
+  uint64_t wait_total_us = 0;
+  uint32_t wait_max_us = 0;
+  uint32_t hold_max_us = 0;
+};
+
+// Broker connection counters, see GetMqttStats()
+struct MqttStats {
+  MqttLinkState state = MqttLinkState::Disabled;
+  int client_state = 0; // PubSubClient state(), the CONNACK code or a negative socket error
+  uint32_t connect_attempts = 0;
+  uint32_t connects = 0;
+  uint32_t disconnects = 0;
+  uint32_t last_connect_ms = 0; // Latency of the last successful connect
+  uint32_t max_connect_ms = 0;
+  uint32_t backoff_ms = 0;
+  uint32_t published = 0;
+  uint32_t publish_failures = 0;
+  uint32_t backlog_published = 0; // Queued samples sent after an outage
+};
+
 struct FanPinPair {
   uint8_t tach_pin;
   uint8_t pwm_pin;
@@ -0,0 +1,165 @@
+#include "usb_protocol.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct Crc16Table {
+    uint16_t entries[256];
+};
+
+static constexpr Crc16Table BuildCrc16Table() {
+    Crc16Table table = {};
+    for (int byte = 0; byte < 256; byte++) {
+        uint16_t crc = static_cast<uint16_t>(byte << 8);
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+        }
+        table.entries[byte] = crc;
+    }
+    return table;
+}
+
+static constexpr Crc16Table CRC16_TABLE = BuildCrc16Table(); // Built at compile time, lives in flash
+
+// Unencoded record plus CRC; COBS adds one byte per 254 and the delimiter one more
+constexpr size_t USB_RECORD_MAX_BYTES = USB_STREAM_FRAME_MAX_BYTES - 2;
+
+struct RecordWriter {
+    uint8_t data[USB_RECORD_MAX_BYTES];
+    size_t length = 0;
+    bool overflowed = false;
+
+    void U8(uint8_t value) {
+        if (length + 1 > sizeof(data)) {
+            overflowed = true;
+            return;
+        }
+        data[length++] = value;
+    }
+    void U16(uint16_t value) {
+        U8(value & 0xFF);
+        U8(value >> 8);
+    }
+    void U32(uint32_t value) {
+        U16(value & 0xFFFF);
+        U16(value >> 16);
+    }
+};
+
+static size_t FinishFrame(RecordWriter& record, uint8_t* buffer, size_t size) {
+    record.U16(Crc16Ccitt(record.data, record.length));
+    if (record.overflowed) {
+        return 0;
+    }
+    const size_t encoded = CobsEncode(record.data, record.length, buffer, size);
+    if (encoded == 0 || encoded + 1 > size) {
+        return 0;
+    }
+    buffer[encoded] = 0x00;
+    return encoded + 1;
+}
+
+size_t WriteUsbHelloFrame(uint8_t* buffer, size_t size) {
+    RecordWriter record;
+    record.U8(USB_PROTOCOL_VERSION);
+    record.U8(static_cast<uint8_t>(UsbRecordType::Hello));
+    record.U8(ACTIVE_THERMISTORS);
+    record.U8(ACTIVE_FANS);
+    const char* client_id = espChipIdStr.c_str();
+    const size_t id_length = strlen(client_id);
+    record.U8(static_cast<uint8_t>(id_length));
+    for (size_t i = 0; i < id_length; i++) record.U8(static_cast<uint8_t>(client_id[i]));
+    return FinishFrame(record, buffer, size);
+}
+
+size_t WriteUsbTelemetryFrame(uint8_t* buffer, size_t size, const ControllerState& state, uint16_t sequence) {
+    RecordWriter record;
+    record.U8(USB_PROTOCOL_VERSION);
+    record.U8(static_cast<uint8_t>(UsbRecordType::Telemetry));
+    record.U32(static_cast<uint32_t>(state.timestamp_ms));
+    record.U16(sequence);
+    record.U8((state.temp_alarm_firing ? 0x01 : 0) | (state.rpm_alarm_firing ? 0x02 : 0) |
+              (systemSettings.units == "F" ? 0x04 : 0));
+    for (int i = 0; i < ACTIVE_THERMISTORS; i++) {
+        const double celsius = state.temperatures[i];
+        int16_t centi = INT16_MIN; // Same N/A cut-off as the JSON payload
+        if (celsius > -90.0) centi = static_cast<int16_t>(lround(fmin(celsius, 320.0) * 100));
+        record.U16(static_cast<uint16_t>(centi));
+    }
+    for (int i = 0; i < ACTIVE_FANS; i++) {
+        record.U16(static_cast<uint16_t>(state.fans[i].rpm > 0xFFFF ? 0xFFFF : state.fans[i].rpm));
+        record.U8(static_cast<uint8_t>(state.fans[i].current_duty));
+    }
+    return FinishFrame(record, buffer, size);
+}
+
+size_t WriteUsbStreamFrame(uint8_t* buffer, size_t size, const UsbStreamSample* samples, size_t count,
+                           uint16_t first_sequence, uint16_t dropped) {
+    RecordWriter record;
+    record.U8(USB_PROTOCOL_VERSION);
+    record.U8(static_cast<uint8_t>(UsbRecordType::StreamBatch));
+    record.U16(first_sequence);
+    record.U16(dropped);
+    record.U8(static_cast<uint8_t>(count));
+    for (size_t s = 0; s < count; s++) {
+        const UsbStreamSample& sample = samples[s];
+        record.U32(sample.timestamp_us);
+        for (int i = 0; i < ACTIVE_THERMISTORS; i++) record.U16(static_cast<uint16_t>(sample.centi_celsius[i]));
+        for (int i = 0; i < ACTIVE_FANS; i++) {
+            record.U16(sample.tach_pulses[i]);
+            record.U8(sample.duty[i]);
+        }
+    }
+    return FinishFrame(record, buffer, size);
+}
+
+UsbTelemetryMode ParseUsbCommand(const char* line, UsbTelemetryMode current) {
+    if (strcmp(line, "MODE JSON") == 0) return UsbTelemetryMode::Json;
+    if (strncmp(line, "MODE BIN ", 9) == 0) {
+        // A host asking for a newer version than ours keeps getting JSON
+        return atoi(line + 9) == USB_PROTOCOL_VERSION ? UsbTelemetryMode::Binary : UsbTelemetryMode::Json;
+    }
+    return current;
+}
+
+bool ParseUsbStreamCommand(const char* line, uint16_t& rate_hz) {
+    if (strncmp(line, "STREAM ", 7) != 0) return false;
+    char* end = nullptr;
+    const long value = strtol(line + 7, &end, 10);
+    if (end == line + 7 || *end != '\0' || value < 0 || value > 0xFFFF) return false;
+    rate_hz = static_cast<uint16_t>(value);
+    return true;
+}
+
+uint16_t Crc16Ccitt(const uint8_t* data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc = static_cast<uint16_t>((crc << 8) ^ CRC16_TABLE.entries[(crc >> 8) ^ data[i]]);
+    }
+    return crc;
+}
+
+size_t CobsEncode(const uint8_t* input, size_t length, uint8_t* output, size_t output_size) {
+    if (output_size == 0) {
+        return 0;
+    }
+    size_t code_index = 0;
+    size_t out = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < length; i++) {
+        if (input[i] != 0) {
+            if (out >= output_size) return 0;
+            output[out++] = input[i];
+            code++;
+        }
+        if (input[i] == 0 || code == 0xFF) {
+            output[code_index] = code;
+            code = 1;
+            code_index = out;
+            if (out >= output_size) return 0;
+            out++;
+        }
+    }
+    output[code_index] = code;
+    return out;
+}
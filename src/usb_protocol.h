@@ -0,0 +1,45 @@
+#ifndef USB_PROTOCOL_H
+#define USB_PROTOCOL_H
+
+#include <stddef.h>
+#include "controller_state.h"
+
+// --- USB Binary Telemetry ---
+// The CDC port starts every connection in JSON lines. A host that sends the
+// line "MODE BIN 1" gets a 0x00, a Hello frame, and from then on binary
+// frames in place of JSON; "MODE JSON" switches back. Each frame is
+//
+//   COBS( version u8 | type u8 | record ... | crc16 u16 ) 0x00
+//
+// little endian, CRC-16/CCITT-FALSE over everything before it. COBS keeps
+// 0x00 out of the frame body, so a reader resyncs at the next delimiter after
+// a partial read or a corrupt frame.
+//
+//   Hello:     thermistors u8 | fans u8 | client_id length u8 | client_id
+//   Telemetry: timestamp_ms u32 | sequence u16 | flags u8
+//              | per thermistor: centi-Celsius i16 (INT16_MIN = N/A)
+//              | per fan: rpm u16 | duty u8
+//   flags:     bit 0 temperature alarm, bit 1 RPM alarm, bit 2 display in Fahrenheit
+//   Stream:    first sequence u16 | dropped u16 | count u8
+//              | per sample: timestamp_us u32
+//                | per thermistor: centi-Celsius i16 | per fan: tach pulses u16 | duty u8
+//
+// Stream frames only flow in binary mode after the host sends "STREAM <hz>"
+// (see usb_stream.h); "STREAM 0" stops them. Sequences count samples, dropped
+// is how many were lost to a full buffer since the previous frame.
+
+// Each returns the encoded frame length including the delimiter, 0 if it did not fit
+size_t WriteUsbHelloFrame(uint8_t* buffer, size_t size);
+size_t WriteUsbTelemetryFrame(uint8_t* buffer, size_t size, const ControllerState& state, uint16_t sequence);
+size_t WriteUsbStreamFrame(uint8_t* buffer, size_t size, const UsbStreamSample* samples, size_t count,
+                           uint16_t first_sequence, uint16_t dropped);
+
+// Mode requested by one command line from the host, or current if it is not a mode command
+UsbTelemetryMode ParseUsbCommand(const char* line, UsbTelemetryMode current);
+// True for a well-formed "STREAM <hz>" line; whether the rate is supported is up to SetUsbStreamRate()
+bool ParseUsbStreamCommand(const char* line, uint16_t& rate_hz);
+
+uint16_t Crc16Ccitt(const uint8_t* data, size_t length);
+size_t CobsEncode(const uint8_t* input, size_t length, uint8_t* output, size_t output_size);
+
+#endif // USB_PROTOCOL_H
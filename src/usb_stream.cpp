@@ -0,0 +1,98 @@
+#include "usb_stream.h"
+#include <atomic>
+#include <math.h>
+#include "hal.h"
+#include "sensor_manager.h"
+#include "usb_protocol.h"
+
+static_assert((USB_STREAM_RING_SAMPLES & (USB_STREAM_RING_SAMPLES - 1)) == 0, "ring size must be a power of two");
+
+static UsbStreamSample a_StreamRing[USB_STREAM_RING_SAMPLES];
+static std::atomic<uint32_t> s_StreamHead{0}; // Written by the producer only
+static std::atomic<uint32_t> s_StreamTail{0}; // Written by the consumer only
+static std::atomic<uint32_t> s_StreamDropped{0};
+static uint32_t s_StreamDroppedReported = 0; // Consumer only
+static std::atomic<uint16_t> s_StreamRateHz{0};
+
+bool SetUsbStreamRate(uint16_t rate_hz) {
+    if (rate_hz != 0) {
+        if (rate_hz > USB_STREAM_MAX_RATE_HZ || 1000 % rate_hz != 0) return false;
+        if (CONTROL_LOOP_INTERVAL_MS % (1000 / rate_hz) != 0) return false;
+    }
+    s_StreamRateHz.store(rate_hz, std::memory_order_relaxed);
+    return true;
+}
+
+uint16_t GetUsbStreamRate() {
+    return s_StreamRateHz.load(std::memory_order_relaxed);
+}
+
+unsigned long UsbStreamPeriodMs() {
+    const uint16_t rate_hz = GetUsbStreamRate();
+    return rate_hz == 0 ? CONTROL_LOOP_INTERVAL_MS : 1000 / rate_hz;
+}
+
+void CaptureUsbStreamSample() {
+    if (GetUsbStreamRate() == 0) {
+        return;
+    }
+    const uint32_t head = s_StreamHead.load(std::memory_order_relaxed);
+    if (head - s_StreamTail.load(std::memory_order_acquire) >= USB_STREAM_RING_SAMPLES) {
+        s_StreamDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    UsbStreamSample& sample = a_StreamRing[head & (USB_STREAM_RING_SAMPLES - 1)];
+    sample.timestamp_us = static_cast<uint32_t>(HalMicros());
+    const TemperatureSnapshot temperatures = GetTemperatureSnapshot();
+    for (int i = 0; i < ACTIVE_THERMISTORS; i++) {
+        const TemperatureSample& channel = temperatures.channels[i];
+        sample.centi_celsius[i] = (channel.valid && channel.celsius > -90.0)
+            ? static_cast<int16_t>(lround(fmin(channel.celsius, 320.0) * 100))
+            : INT16_MIN;
+    }
+    const ControllerState state = ReadControllerState();
+    for (int i = 0; i < ACTIVE_FANS; i++) {
+        sample.tach_pulses[i] = static_cast<uint16_t>(HalTachReadPulseCount(i));
+        sample.duty[i] = static_cast<uint8_t>(state.fans[i].current_duty);
+    }
+    s_StreamHead.store(head + 1, std::memory_order_release);
+}
+
+size_t WriteUsbStreamFrames(uint8_t* buffer, size_t size) {
+    size_t written = 0;
+    while (true) {
+        const uint32_t tail = s_StreamTail.load(std::memory_order_relaxed);
+        const uint32_t queued = s_StreamHead.load(std::memory_order_acquire) - tail;
+        if (queued == 0) break;
+
+        UsbStreamSample batch[USB_STREAM_BATCH_SAMPLES];
+        size_t count = queued < USB_STREAM_BATCH_SAMPLES ? queued : USB_STREAM_BATCH_SAMPLES;
+        for (size_t i = 0; i < count; i++) batch[i] = a_StreamRing[(tail + i) & (USB_STREAM_RING_SAMPLES - 1)];
+
+        const uint32_t dropped_total = s_StreamDropped.load(std::memory_order_relaxed);
+        const uint32_t dropped = dropped_total - s_StreamDroppedReported;
+        size_t length = 0;
+        while (count > 0) { // A short frame when the port has little room
+            length = WriteUsbStreamFrame(buffer + written, size - written, batch, count, static_cast<uint16_t>(tail),
+                                         static_cast<uint16_t>(dropped > 0xFFFF ? 0xFFFF : dropped));
+            if (length > 0) break;
+            count--;
+        }
+        if (length == 0) break; // No room, the samples wait for the next flush
+
+        written += length;
+        s_StreamDroppedReported = dropped_total;
+        s_StreamTail.store(tail + count, std::memory_order_release);
+    }
+    return written;
+}
+
+void DiscardUsbStreamSamples() {
+    s_StreamTail.store(s_StreamHead.load(std::memory_order_acquire), std::memory_order_release);
+    s_StreamDroppedReported = s_StreamDropped.load(std::memory_order_relaxed);
+}
+
+uint32_t UsbStreamDroppedSamples() {
+    return s_StreamDropped.load(std::memory_order_relaxed);
+}
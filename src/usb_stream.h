@@ -0,0 +1,30 @@
+#ifndef USB_STREAM_H
+#define USB_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "controller_state.h"
+
+// --- USB Sample Streaming ---
+// The control task captures one UsbStreamSample per stream tick into a
+// lock-free single-producer/single-consumer ring; the USB task drains it in
+// batched frames (see usb_protocol.h). Capturing never waits: when the host
+// stops reading and the ring fills, new samples are dropped and counted.
+
+// 0 stops streaming. Only rates whose period divides CONTROL_LOOP_INTERVAL_MS
+// are accepted (10, 20, 25, 40, 50, 100 Hz), so control ticks stay on stream ticks.
+bool SetUsbStreamRate(uint16_t rate_hz);
+uint16_t GetUsbStreamRate();
+// Control task period: the stream period while streaming, else CONTROL_LOOP_INTERVAL_MS
+unsigned long UsbStreamPeriodMs();
+
+// Producer side: control task only
+void CaptureUsbStreamSample();
+
+// Consumer side: USB task only. Writes as many whole frames as fit in size,
+// leaving the rest queued; returns the bytes written.
+size_t WriteUsbStreamFrames(uint8_t* buffer, size_t size);
+void DiscardUsbStreamSamples();
+uint32_t UsbStreamDroppedSamples();
+
+#endif // USB_STREAM_H
@@ -0,0 +1,103 @@
+#include "web_assets_manager.h"
+#include "hal.h"
+
+struct WebAsset {
+    bool gzipped = false;
+    String etag; // Quoted, as it goes on the wire
+    bool cache_tried = false;
+    uint8_t* cached = nullptr; // Stored (possibly gzipped) bytes in PSRAM
+    size_t cached_length = 0;
+};
+
+// Filled once before the server starts, afterwards only the async_tcp task
+// (request handlers) touches it
+static std::map<String, WebAsset> m_WebAssets;
+static size_t s_WebAssetCacheBytes = 0;
+
+void LoadWebAssets() {
+    File manifest = LittleFS.open("/assets.txt", "r");
+    if (!manifest) {
+        Serial.println("HTTP: No asset manifest, serving files uncompressed.");
+        return;
+    }
+    while (manifest.available()) {
+        String line = manifest.readStringUntil('\n');
+        char path[64];
+        int gzipped = 0;
+        char etag[33];
+        if (sscanf(line.c_str(), "%63s %d %32s", path, &gzipped, etag) != 3) {
+            continue;
+        }
+        WebAsset& asset = m_WebAssets[path];
+        asset.gzipped = gzipped != 0;
+        asset.etag = String("\"") + etag + "\"";
+    }
+    manifest.close();
+    Serial.printf("HTTP: %u assets in manifest.\n", (unsigned)m_WebAssets.size());
+}
+
+static void CacheWebAsset(WebAsset& asset, const String& stored_path) {
+    asset.cache_tried = true; // One attempt; too big or out of budget stays on flash
+    File file = LittleFS.open(stored_path, "r");
+    if (!file) {
+        return;
+    }
+    size_t length = file.size();
+    if (length > WEB_ASSET_CACHE_MAX_BYTES || s_WebAssetCacheBytes + length > WEB_ASSET_CACHE_BUDGET_BYTES) {
+        return;
+    }
+    uint8_t* bytes = static_cast<uint8_t*>(HalAllocLarge(length));
+    if (bytes == nullptr) {
+        return; // No PSRAM
+    }
+    if (file.read(bytes, length) != length) {
+        free(bytes);
+        return;
+    }
+    asset.cached = bytes;
+    asset.cached_length = length;
+    s_WebAssetCacheBytes += length;
+}
+
+static void AddCacheHeaders(AsyncWebServerResponse* response, const WebAsset& asset, uint32_t max_age_s) {
+    response->addHeader("ETag", asset.etag);
+    response->addHeader("Cache-Control", max_age_s > 0 ? "max-age=" + String(max_age_s) : String("no-cache"));
+}
+
+void ServeWebAsset(AsyncWebServerRequest* request, const char* path, const char* mimetype, uint32_t max_age_s) {
+    auto it = m_WebAssets.find(path);
+    if (it == m_WebAssets.end()) {
+        if (!LittleFS.exists(path)) {
+            Serial.printf("HTTP: File %s not found!\n", path);
+            request->send(404, "text/plain", "File Not Found");
+            return;
+        }
+        AsyncWebServerResponse* response = request->beginResponse(LittleFS, path, mimetype);
+        if (max_age_s > 0) {
+            response->addHeader("Cache-Control", "max-age=" + String(max_age_s));
+        }
+        request->send(response);
+        return;
+    }
+
+    WebAsset& asset = it->second;
+    if (request->hasHeader("If-None-Match") && request->header("If-None-Match").indexOf(asset.etag) >= 0) {
+        AsyncWebServerResponse* response = request->beginResponse(304);
+        AddCacheHeaders(response, asset, max_age_s);
+        request->send(response);
+        return;
+    }
+
+    String stored_path = asset.gzipped ? String(path) + ".gz" : String(path);
+    if (!asset.cache_tried) {
+        CacheWebAsset(asset, stored_path);
+    }
+    AsyncWebServerResponse* response = asset.cached != nullptr
+        ? request->beginResponse(200, mimetype, asset.cached, asset.cached_length)
+        : request->beginResponse(LittleFS, stored_path, mimetype);
+    if (asset.gzipped) {
+        response->addHeader("Content-Encoding", "gzip"); // Every browser this UI targets accepts it
+    }
+    AddCacheHeaders(response, asset, max_age_s);
+    request->send(response);
+}
@@ -0,0 +1,24 @@
+#ifndef WEB_ASSETS_MANAGER_H
+#define WEB_ASSETS_MANAGER_H
+
+#include "globals.h"
+
+// --- Web Assets ---
+// Pages, scripts and images as extra_script.py stages data/ for uploadfs:
+// every file that compresses is stored as <path>.gz, and /assets.txt lists
+//
+//   <path> <gzipped 0|1> <etag>
+//
+// per asset, the ETag being a hash of the uncompressed content. Responses
+// carry the ETag and an If-None-Match that matches gets an empty 304. The
+// first request for an asset up to WEB_ASSET_CACHE_MAX_BYTES keeps its stored
+// bytes in PSRAM, within WEB_ASSET_CACHE_BUDGET_BYTES, so the pages actually
+// in use stop touching LittleFS. Files missing from the manifest (data/
+// uploaded by other means) are served as they are.
+
+// Reads the manifest; LittleFS must be mounted
+void LoadWebAssets();
+// max_age_s 0 makes browsers revalidate on every load, which costs a 304
+void ServeWebAsset(AsyncWebServerRequest* request, const char* path, const char* mimetype, uint32_t max_age_s);
+
+#endif // WEB_ASSETS_MANAGER_H
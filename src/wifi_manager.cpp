@@ -1,29 +1,71 @@
 #include "wifi_manager.h"
+#include "hal.h"
 #include <esp_wifi.h> // Used for mpdu_rx_disable android workaround
+#include <atomic>
+
+// Station link state, written only by RunWifiStateMachine() and read from other
+// tasks through WifiConnected()/WifiAddress(); the event handler only reports
+// link changes through the atomics
+static std::atomic<WifiLinkState> s_WifiState{WifiLinkState::AccessPoint};
+static std::atomic<bool> s_WifiLinkUp{false};
+static unsigned long s_WifiStateSinceMs = 0;
+static unsigned long s_WifiOfflineSinceMs = 0;
+static unsigned long s_WifiBackoffMs = WIFI_BACKOFF_MIN_MS;
+static std::atomic<bool> s_WifiFallbackAp{false};
+
+static void OnWifiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+    if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+        s_WifiLinkUp = true;
+    } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+        s_WifiLinkUp = false;
+    }
+}
+
+static void EnterWifiState(WifiLinkState state) {
+    s_WifiState = state;
+    s_WifiStateSinceMs = millis();
+}
+
+static void StartStationAttempt() {
+    Serial.printf("WiFi: Connecting to %s...\n", systemSettings.ssid.c_str());
+    WiFi.begin(systemSettings.ssid, systemSettings.password);
+    EnterWifiState(WifiLinkState::Connecting);
+}
+
+static void SetFallbackAccessPoint(bool enabled) {
+    if (enabled == s_WifiFallbackAp) {
+        return;
+    }
+    s_WifiFallbackAp = enabled;
+    if (enabled) {
+        // AP+STA keeps retrying the configured network while the AP serves the UI
+        WiFi.mode(WIFI_AP_STA);
+        WiFi.softAPConfig(AP_LOCAL_IP, AP_GATEWAY_IP, AP_SUBNET_MASK);
+        WiFi.softAP("WaKu-ctl", "");
+        dnsServer.start(53, "*", AP_LOCAL_IP); // Same captive portal as the setup AP
+        Serial.printf("WiFi: Still offline, access point up at %s\n", AP_LOCAL_IP.toString().c_str());
+    } else {
+        dnsServer.stop();
+        WiFi.softAPdisconnect(true);
+        WiFi.mode(WIFI_STA);
+        Serial.println("WiFi: Back online, access point closed.");
+    }
+}
 
 void InitializeWifi() {
     if (systemSettings.setup_done && !systemSettings.offline_mode) {
+        // Returns right away; RunWifiStateMachine() connects and reconnects in the background
         WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE); // ESP32 specific to clear previous static IP config
         WiFi.mode(WIFI_STA);
         WiFi.setHostname(systemSettings.hostname.c_str());
-        WiFi.begin(systemSettings.ssid, systemSettings.password);
+        WiFi.setAutoReconnect(false); // Retries follow our backoff instead
         WiFi.setSleep(false); // Disable WiFi sleep mode
+        WiFi.onEvent(OnWifiEvent);
+        s_WifiOfflineSinceMs = millis();
+        StartStationAttempt();
 
-        Serial.print("Connecting to WiFi");
         oledDisplay.println("Connecting to WiFi");
-        oledDisplay.display();
-
-        // Original loop from main.cpp:
-        while (WiFi.status() != WL_CONNECTED) {
-            delay(500);
-            Serial.print(".");
-            oledDisplay.print(".");
-            oledDisplay.display();
-        }
-
-        Serial.println("\nWiFi connected.");
-        Serial.print("IP address: ");
-        Serial.println(WiFi.localIP());
+        HalDisplayFlush();
     } else {
         WiFi.mode(WIFI_AP);
         WiFi.softAPConfig(AP_LOCAL_IP, AP_GATEWAY_IP, AP_SUBNET_MASK);
@@ -48,6 +90,67 @@ void InitializeWifi() {
     }
 }
 
+void RunWifiStateMachine() {
+    if (s_WifiState == WifiLinkState::AccessPoint) {
+        return; // Offline mode or setup: nothing to connect to
+    }
+    unsigned long now_ms = millis();
+    bool link_up = s_WifiLinkUp;
+
+    switch (s_WifiState) {
+        case WifiLinkState::Connecting:
+            if (link_up) {
+                Serial.printf("WiFi: Connected after %lu ms, IP address: %s\n",
+                              now_ms - s_WifiOfflineSinceMs, WiFi.localIP().toString().c_str());
+                s_WifiBackoffMs = WIFI_BACKOFF_MIN_MS;
+                SetFallbackAccessPoint(false);
+                EnterWifiState(WifiLinkState::Connected);
+                InitializeNtpTime();
+            } else if (now_ms - s_WifiStateSinceMs >= WIFI_CONNECT_TIMEOUT_MS) {
+                WiFi.disconnect();
+                Serial.printf("WiFi: Attempt timed out, retrying in %lu ms\n", s_WifiBackoffMs);
+                EnterWifiState(WifiLinkState::Backoff);
+            }
+            break;
+        case WifiLinkState::Connected:
+            if (!link_up) {
+                Serial.println("WiFi: Connection lost, reconnecting.");
+                s_WifiOfflineSinceMs = now_ms;
+                StartStationAttempt();
+            }
+            break;
+        case WifiLinkState::Backoff:
+            if (link_up) {
+                EnterWifiState(WifiLinkState::Connecting); // Associated late, settles on the next tick
+            } else if (now_ms - s_WifiStateSinceMs >= s_WifiBackoffMs) {
+                s_WifiBackoffMs = min(s_WifiBackoffMs * 2, WIFI_BACKOFF_MAX_MS);
+                StartStationAttempt();
+            }
+            break;
+        default:
+            break;
+    }
+
+    if (s_WifiState != WifiLinkState::Connected && now_ms - s_WifiOfflineSinceMs >= WIFI_AP_FALLBACK_MS) {
+        SetFallbackAccessPoint(true);
+    }
+}
+
+WifiLinkState GetWifiLinkState() {
+    return s_WifiState;
+}
+
+bool WifiConnected() {
+    return s_WifiState == WifiLinkState::Connected;
+}
+
+IPAddress WifiAddress() {
+    if (s_WifiState == WifiLinkState::AccessPoint || (s_WifiFallbackAp && !WifiConnected())) {
+        return AP_LOCAL_IP;
+    }
+    return WiFi.localIP();
+}
+
 void ScanWifiNetworks(JsonDocument& doc) {
     Serial.println("Scanning WiFi networks...");
     int n = WiFi.scanNetworks();
@@ -67,24 +170,12 @@ void ScanWifiNetworks(JsonDocument& doc) {
 }
 
 void InitializeNtpTime() {
-    if (systemSettings.offline_mode) return;
+    static bool started = false;
+    if (started || systemSettings.offline_mode) return;
+    started = true;
 
+    // SNTP keeps syncing in the background; HalEpochSeconds() is 0 until its first answer
     configTime(0, 0, "pool.ntp.org", "time.nist.gov");
-    sntp_sync_status_t sync_status;
-    int retries = 0;
-
-    Serial.print("Synchronizing time");
-    do {
-        sync_status = sntp_get_sync_status();
-        if (sync_status == SNTP_SYNC_STATUS_COMPLETED) break;
-        if (retries++ > 100) {
-            Serial.println("\nNTP Sync failed. Check internet connection.");
-            return;
-        }
-        Serial.print(".");
-        delay(100);
-    } while (sync_status != SNTP_SYNC_STATUS_COMPLETED);
-
-    Serial.println("\nTime synchronized.");
+    Serial.println("NTP: Time sync started.");
 }
 
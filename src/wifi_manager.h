@@ -4,8 +4,16 @@
 #include "globals.h" // For gSettings, display, AP_LOCAL_IP, kGatewayIp, kSubnetMask, WiFi object
 #include "ArduinoJson.h" // For JsonDocument used in ScanWifiNetworks
 
+// Station mode only starts the first attempt; RunWifiStateMachine() then
+// connects, reconnects with exponential backoff and opens the setup AP next
+// to the retries after WIFI_AP_FALLBACK_MS offline. AP mode is set up here.
 void InitializeWifi();
+// Wifi task only, every WIFI_STATE_INTERVAL_MS
+void RunWifiStateMachine();
+WifiLinkState GetWifiLinkState();
+bool WifiConnected();
+IPAddress WifiAddress(); // Where the UI is reachable right now
 void ScanWifiNetworks(JsonDocument& doc); // Helper for the /networks endpoint
-void InitializeNtpTime();
+void InitializeNtpTime(); // Wifi task, once connected; starts SNTP without waiting for it
 
 #endif // WIFI_MANAGER_H
\ No newline at end of file
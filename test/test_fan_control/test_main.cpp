@@ -0,0 +1,311 @@
+// Fan curves, PID (pid_controller.h), slew ramps, config updates
+// (config_manager.h) and the control tick (control_manager.h) with the
+// controller state and tach RPM it publishes, driven against the simulated
+// loop in hal_native.cpp.
+
+#include <unity.h>
+#include <string>
+#include "config_manager.h"
+#include "control_manager.h"
+#include "hal.h"
+#include "hal_native.h"
+#include "pid_controller.h"
+#include "sensor_manager.h"
+
+static CompiledFanCurve CompileCurve(const std::vector<FanSpeedPoint>& points, float hysteresis) {
+    ControllerConfig config;
+    config.fans[0].fan_speed_curve = points;
+    config.fans[0].hysteresis = hysteresis;
+    CompileFanCurves(config);
+    return config.curves.fans[0];
+}
+
+static void SetFlatCurves(int duty) {
+    TEST_ASSERT_TRUE(UpdateControllerConfig([&](ControllerConfig& config) {
+        for (auto& fan : config.fans) fan.fan_speed_curve = {{30, duty}};
+    }));
+}
+
+// One control period with the sampler polled on its own schedule, as the tasks run on the board
+static void RunControlTicks(int ticks) {
+    for (int tick = 0; tick < ticks; tick++) {
+        for (unsigned long ms = 0; ms < CONTROL_LOOP_INTERVAL_MS; ms += ADC_SAMPLE_INTERVAL_MS) {
+            HalSimAdvance(ADC_SAMPLE_INTERVAL_MS);
+            PollTemperatureSampler();
+        }
+        RunFanControlTick();
+    }
+}
+
+void setUp() {
+    UpdateControllerConfig([](ControllerConfig& config) {
+        for (auto& fan : config.fans) ApplyDefaultFanSettings(fan);
+    });
+    HalSimSetHeatLoad(0); // Coolant stays at ambient, below the first curve point
+}
+
+void tearDown() {
+}
+
+void test_compile_sorts_points_and_keeps_the_last_duplicate() {
+    const CompiledFanCurve curve = CompileCurve({{40, 200}, {30, 80}, {35, 120}, {30, 90}}, 1.5f);
+    TEST_ASSERT_EQUAL_UINT8(3, curve.count);
+    const float temperatures[] = {30, 35, 40};
+    const float duties[] = {90, 120, 200};
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_FLOAT(temperatures[i], curve.temperatures[i]);
+        TEST_ASSERT_EQUAL_FLOAT(duties[i], curve.duties[i]);
+    }
+    TEST_ASSERT_EQUAL_FLOAT(1.5f, curve.hysteresis);
+}
+
+void test_compile_drops_points_beyond_the_maximum() {
+    std::vector<FanSpeedPoint> points;
+    for (int i = 0; i < FAN_CURVE_MAX_POINTS + 4; i++) points.push_back({20.0f + i, i});
+    const CompiledFanCurve curve = CompileCurve(points, -1.0f);
+    TEST_ASSERT_EQUAL_UINT8(FAN_CURVE_MAX_POINTS, curve.count);
+    TEST_ASSERT_EQUAL_FLOAT(20.0f + FAN_CURVE_MAX_POINTS - 1, curve.temperatures[FAN_CURVE_MAX_POINTS - 1]);
+    TEST_ASSERT_EQUAL_FLOAT(0, curve.hysteresis); // Negative hysteresis is treated as none
+}
+
+void test_curve_interpolates_and_clamps_at_the_ends() {
+    const CompiledFanCurve curve = CompileCurve({{30, 80}, {35, 120}, {40, 200}}, 0);
+    TEST_ASSERT_EQUAL_FLOAT(80, EvaluateFanCurve(curve, 10));
+    TEST_ASSERT_EQUAL_FLOAT(80, EvaluateFanCurve(curve, 30));
+    TEST_ASSERT_EQUAL_FLOAT(100, EvaluateFanCurve(curve, 32.5f));
+    TEST_ASSERT_EQUAL_FLOAT(120, EvaluateFanCurve(curve, 35));
+    TEST_ASSERT_EQUAL_FLOAT(184, EvaluateFanCurve(curve, 39));
+    TEST_ASSERT_EQUAL_FLOAT(200, EvaluateFanCurve(curve, 90));
+    TEST_ASSERT_EQUAL_FLOAT(0, EvaluateFanCurve(CompiledFanCurve(), 35)); // No curve defined
+}
+
+void test_curves_hold_duty_inside_the_hysteresis_band() {
+    CompiledFanCurves curves;
+    for (auto& curve : curves.fans) curve = CompileCurve({{30, 100}, {40, 200}}, 1.0f);
+
+    float temperatures[ACTIVE_FANS];
+    float duties[ACTIVE_FANS];
+    const float sequence[] = {35.0f, 34.5f, 33.5f, 33.6f, 36.0f, -1.0f};
+    const float expected[] = {150, 150, 145, 145, 160, -1};
+    for (int step = 0; step < 6; step++) {
+        for (float& temperature : temperatures) temperature = sequence[step];
+        EvaluateFanCurves(curves, temperatures, duties);
+        for (int i = 0; i < ACTIVE_FANS; i++) TEST_ASSERT_EQUAL_FLOAT(expected[step], duties[i]);
+    }
+
+    // A restart forgets the held input on every fan, so 35.5 is no longer held up at 36
+    for (float& temperature : temperatures) temperature = 36.0f;
+    EvaluateFanCurves(curves, temperatures, duties);
+    ApplyInitialFanSpeeds();
+    for (float& temperature : temperatures) temperature = 35.5f;
+    EvaluateFanCurves(curves, temperatures, duties);
+    for (int i = 0; i < ACTIVE_FANS; i++) TEST_ASSERT_EQUAL_FLOAT(155, duties[i]);
+}
+
+void test_pid_prime_is_bumpless() {
+    PidSettings settings;
+    PidState state;
+    // Only the first tick's integral step is added to the output it took over
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 140.0f + settings.ki * 0.1f, UpdatePid(settings, state, settings.setpoint + 1.0f, true, 140.0f, 0.1f));
+    TEST_ASSERT_TRUE(state.primed);
+}
+
+void test_pid_direction_follows_acting_sense() {
+    PidSettings temperature;
+    PidState temperature_state;
+    UpdatePid(temperature, temperature_state, temperature.setpoint, true, 100.0f, 0);
+    const float hotter = UpdatePid(temperature, temperature_state, temperature.setpoint + 2.0f, true, 100.0f, 0.1f);
+    TEST_ASSERT_TRUE(hotter > 100.0f); // Above the setpoint, more duty
+
+    PidSettings rpm;
+    rpm.setpoint = PID_RPM_DEFAULT_SETPOINT;
+    rpm.kp = PID_RPM_DEFAULT_KP;
+    rpm.ki = PID_RPM_DEFAULT_KI;
+    PidState rpm_state;
+    UpdatePid(rpm, rpm_state, rpm.setpoint, false, 100.0f, 0);
+    const float slower = UpdatePid(rpm, rpm_state, rpm.setpoint - 300.0f, false, 100.0f, 0.1f);
+    TEST_ASSERT_TRUE(slower > 100.0f); // Below the setpoint, more duty too
+}
+
+void test_pid_integral_does_not_wind_up_while_saturated() {
+    PidSettings settings;
+    PidState state;
+    const float hot = settings.setpoint + 15.0f; // Proportional term alone is past max_duty
+    TEST_ASSERT_EQUAL_FLOAT(settings.max_duty, UpdatePid(settings, state, hot, true, settings.max_duty, 0.1f));
+    const float primed_integral = state.integral;
+    for (int i = 0; i < 1000; i++) UpdatePid(settings, state, hot, true, settings.max_duty, 0.1f);
+    TEST_ASSERT_EQUAL_FLOAT(primed_integral, state.integral);
+
+    // Back at the setpoint the output drops straight to the integral instead of unwinding 100 s of error
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, primed_integral, UpdatePid(settings, state, settings.setpoint, true, settings.max_duty, 0.1f));
+    TEST_ASSERT_EQUAL_FLOAT(settings.min_duty, primed_integral);
+}
+
+void test_pid_derivative_ignores_setpoint_changes() {
+    PidSettings settings;
+    settings.ki = 0;
+    settings.kd = 50.0f;
+    PidState state;
+    UpdatePid(settings, state, 40.0f, true, 150.0f, 0.1f);
+    const float before = UpdatePid(settings, state, 40.0f, true, 150.0f, 0.1f);
+    settings.setpoint += 1.0f;
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, before - settings.kp, UpdatePid(settings, state, 40.0f, true, 150.0f, 0.1f));
+}
+
+void test_curve_changes_ramp_at_the_configured_rates() {
+    ApplyInitialFanSpeeds();
+    RunControlTicks(2); // Let the loop settle on the curve's lowest point
+    const int start = HalSimPwmDuty(0);
+    TEST_ASSERT_EQUAL_INT(MapFanPercentToPwm(30), start);
+
+    SetFlatCurves(255);
+    const float up_step = 255 * FAN_RAMP_DEFAULT_UP_RATE / 100.0f * CONTROL_LOOP_INTERVAL_MS / 1000.0f;
+    for (int tick = 1; tick <= 10; tick++) {
+        RunControlTicks(1);
+        TEST_ASSERT_INT_WITHIN(1, lroundf(start + up_step * tick), HalSimPwmDuty(0));
+        TEST_ASSERT_TRUE(ReadControllerState().fans[0].is_adjusting);
+        TEST_ASSERT_EQUAL_INT(255, ReadControllerState().fans[0].target_duty);
+    }
+    RunControlTicks(40);
+    TEST_ASSERT_EQUAL_INT(255, HalSimPwmDuty(0));
+    TEST_ASSERT_FALSE(ReadControllerState().fans[0].is_adjusting);
+
+    SetFlatCurves(0);
+    const float down_step = 255 * FAN_RAMP_DEFAULT_DOWN_RATE / 100.0f * CONTROL_LOOP_INTERVAL_MS / 1000.0f;
+    RunControlTicks(10);
+    TEST_ASSERT_INT_WITHIN(1, lroundf(255 - down_step * 10), HalSimPwmDuty(0));
+
+    // A new target takes over mid-ramp instead of waiting for the old one to finish
+    SetFlatCurves(255);
+    RunControlTicks(1);
+    TEST_ASSERT_INT_WITHIN(1, lroundf(255 - down_step * 10 + up_step), HalSimPwmDuty(0));
+}
+
+void test_config_update_publishes_a_compiled_version() {
+    const uint32_t generation = ControllerConfigGeneration();
+    TEST_ASSERT_TRUE(UpdateControllerConfig([](ControllerConfig& config) {
+        config.fans[2].fan_speed_curve = {{40, 200}, {30, 80}};
+    }));
+    TEST_ASSERT_EQUAL_UINT32(generation + 1, ControllerConfigGeneration());
+    const ControllerConfigGuard config = ReadControllerConfig();
+    TEST_ASSERT_EQUAL_UINT8(2, config->curves.fans[2].count);
+    TEST_ASSERT_EQUAL_FLOAT(30, config->curves.fans[2].temperatures[0]);
+}
+
+void test_rejected_config_edit_keeps_the_running_version() {
+    const uint32_t generation = ControllerConfigGeneration();
+    TEST_ASSERT_FALSE(UpdateControllerConfig([](ControllerConfig& config) {
+        config.fans[0].fan_speed_curve.clear();
+    }));
+    TEST_ASSERT_FALSE(UpdateControllerConfig([](ControllerConfig& config) {
+        config.fans[1].fan_speed_curve.push_back({45, 300});
+    }));
+    TEST_ASSERT_FALSE(UpdateControllerConfig([](ControllerConfig& config) {
+        config.fans[2].sensor_channel = ACTIVE_THERMISTORS;
+    }));
+    TEST_ASSERT_EQUAL_UINT32(generation, ControllerConfigGeneration());
+    const ControllerConfigGuard config = ReadControllerConfig();
+    TEST_ASSERT_EQUAL_UINT32(5, config->fans[0].fan_speed_curve.size());
+    TEST_ASSERT_EQUAL_UINT32(5, config->fans[1].fan_speed_curve.size());
+}
+
+void test_tick_publishes_one_consistent_state() {
+    ApplyInitialFanSpeeds();
+    const uint32_t version = ControllerStateVersion();
+    RunControlTicks(4);
+    TEST_ASSERT_EQUAL_UINT32(version + 4, ControllerStateVersion());
+
+    const ControllerState state = ReadControllerState();
+    TEST_ASSERT_EQUAL_UINT32(HalMillis(), state.timestamp_ms);
+    for (int channel = 0; channel < ACTIVE_THERMISTORS; channel++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.2, HalSimTemperature(channel), state.temperatures[channel]);
+    }
+    for (int i = 0; i < ACTIVE_FANS; i++) {
+        TEST_ASSERT_EQUAL_INT(MapFanPercentToPwm(30), state.fans[i].target_duty);
+        TEST_ASSERT_EQUAL_INT(HalSimPwmDuty(a_FanIds[i]), state.fans[i].current_duty);
+        TEST_ASSERT_FALSE(state.fans[i].is_adjusting);
+    }
+}
+
+void test_alarms_follow_the_published_readings() {
+    ApplyInitialFanSpeeds();
+    RunControlTicks(1);
+    TEST_ASSERT_FALSE(ReadControllerState().temp_alarm_firing);
+    TEST_ASSERT_FALSE(ReadControllerState().rpm_alarm_firing);
+
+    // Ambient is 25 C, so a 20 C threshold fires on the next tick and clears once raised again
+    UpdateControllerConfig([](ControllerConfig& config) { config.fans[0].temperature_alarm_threshold = 20; });
+    RunControlTicks(1);
+    TEST_ASSERT_TRUE(ReadControllerState().temp_alarm_firing);
+    UpdateControllerConfig([](ControllerConfig& config) { config.fans[0].temperature_alarm_threshold = 999; });
+    RunControlTicks(1);
+    TEST_ASSERT_FALSE(ReadControllerState().temp_alarm_firing);
+
+    // No fan reaches 100000 RPM
+    UpdateControllerConfig([](ControllerConfig& config) { config.fans[1].rpm_alarm_threshold = 100000; });
+    RunControlTicks(1);
+    TEST_ASSERT_TRUE(ReadControllerState().rpm_alarm_firing);
+    TEST_ASSERT_FALSE(ReadControllerState().temp_alarm_firing);
+}
+
+void test_rpm_tracks_the_simulated_fans() {
+    const double max_rpm[ACTIVE_FANS] = {3000, 1800, 1800, 1800}; // hal_native.cpp plant
+    SetFlatCurves(255);
+    RunControlTicks(120);
+    for (int i = 0; i < ACTIVE_FANS; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(max_rpm[i] * 0.03, max_rpm[i], ReadControllerState().fans[i].rpm);
+    }
+
+    SetFlatCurves(0);
+    RunControlTicks(300); // Ramp-down, spin-down, then FAN_STUCK_THRESHOLD_MD without a pulse
+    for (int i = 0; i < ACTIVE_FANS; i++) TEST_ASSERT_EQUAL_UINT32(0, ReadControllerState().fans[i].rpm);
+}
+
+void test_fans_follow_their_bound_sensor() {
+    TEST_ASSERT_EQUAL_INT(0, ParseTemperatureSensor("TEMP_1"));
+    TEST_ASSERT_EQUAL_INT(1, ParseTemperatureSensor("TEMP_2"));
+    TEST_ASSERT_EQUAL_INT(-1, ParseTemperatureSensor("TEMP_9"));
+    TEST_ASSERT_EQUAL_INT(-1, ParseTemperatureSensor(nullptr));
+    const std::string name = TemperatureSensorName(1);
+    TEST_ASSERT_EQUAL_STRING("TEMP_2", name.c_str());
+
+    // Same curve on both fans, fan 1 follows the cooler exhaust sensor
+    TEST_ASSERT_TRUE(UpdateControllerConfig([](ControllerConfig& config) {
+        for (auto& fan : config.fans) fan.fan_speed_curve = {{20, 0}, {60, 255}};
+        config.fans[1].sensor_channel = 1;
+    }));
+    HalSimSetHeatLoad(500); // Runs last, the coolant stays warm afterwards
+    RunControlTicks(1200);
+
+    const ControllerState state = ReadControllerState();
+    TEST_ASSERT_TRUE(state.temperatures[0] > state.temperatures[1] + 2);
+    TEST_ASSERT_TRUE(state.fans[0].target_duty > state.fans[1].target_duty);
+    TEST_ASSERT_EQUAL_INT(state.fans[0].target_duty, state.fans[2].target_duty);
+}
+
+int main() {
+    HalSimReset(25.0);
+    StartTemperatureSampler();
+    while (!HasTemperatureSamples()) {
+        HalSimAdvance(1);
+        PollTemperatureSampler();
+    }
+
+    UNITY_BEGIN();
+    RUN_TEST(test_compile_sorts_points_and_keeps_the_last_duplicate);
+    RUN_TEST(test_compile_drops_points_beyond_the_maximum);
+    RUN_TEST(test_curve_interpolates_and_clamps_at_the_ends);
+    RUN_TEST(test_curves_hold_duty_inside_the_hysteresis_band);
+    RUN_TEST(test_pid_prime_is_bumpless);
+    RUN_TEST(test_pid_direction_follows_acting_sense);
+    RUN_TEST(test_pid_integral_does_not_wind_up_while_saturated);
+    RUN_TEST(test_pid_derivative_ignores_setpoint_changes);
+    RUN_TEST(test_curve_changes_ramp_at_the_configured_rates);
+    RUN_TEST(test_config_update_publishes_a_compiled_version);
+    RUN_TEST(test_rejected_config_edit_keeps_the_running_version);
+    RUN_TEST(test_tick_publishes_one_consistent_state);
+    RUN_TEST(test_alarms_follow_the_published_readings);
+    RUN_TEST(test_rpm_tracks_the_simulated_fans);
+    RUN_TEST(test_fans_follow_their_bound_sensor);
+    return UNITY_END();
+}
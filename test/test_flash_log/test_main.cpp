@@ -0,0 +1,201 @@
+// Flash log batches and the varint export (flash_log_manager.h), written to a
+// scratch directory and decoded here the way an export reader would.
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "flash_log_manager.h"
+#include "hal.h"
+
+constexpr int BATCH_POINTS = sizeof(FlashLogBatch::points) / sizeof(HistoryPoint);
+constexpr int FIRST_BOOT_SAMPLES = 2 * BATCH_POINTS + BATCH_POINTS / 2; // Two full batches on flash, the rest in RAM
+constexpr int SECOND_BOOT_SAMPLES = 5;
+
+static char s_LogDirectory[] = "/tmp/flash_log_XXXXXX";
+
+struct ExportContext {
+    uint32_t boot;
+    uint32_t epoch_offset;
+    uint32_t interval_s;
+    size_t first_point; // Index into ExportedLog::points
+};
+
+struct ExportedLog {
+    std::vector<ExportContext> contexts;
+    std::vector<HistoryPoint> points;
+};
+
+static ControllerState MakeState(int sample) {
+    ControllerState state;
+    state.timestamp_ms = sample * FLASH_LOG_INTERVAL_S * 1000UL;
+    state.temperatures[0] = 30.0 + sample * 0.37;
+    state.temperatures[1] = (sample % 7 == 3) ? -127 : 25.0 - sample * 0.11; // N/A now and then
+    for (int i = 0; i < ACTIVE_FANS; i++) {
+        state.fans[i].rpm = 900 + (sample * 53 + i * 200) % 1500;
+        state.fans[i].current_duty = (sample * 17 + i) % 256;
+    }
+    return state;
+}
+
+static bool ReadVarint(const std::vector<uint8_t>& data, size_t& offset, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && offset < data.size(); shift += 7) {
+        const uint8_t byte = data[offset++];
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+static int32_t ReadZigzag(const std::vector<uint8_t>& data, size_t& offset) {
+    uint32_t value = 0;
+    TEST_ASSERT_TRUE(ReadVarint(data, offset, value));
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+static std::vector<uint8_t> ReadExport(size_t chunk_size) {
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> chunk(chunk_size);
+    FlashLogExportCursor cursor = OpenFlashLogExport();
+    while (size_t length = WriteFlashLogExportChunk(cursor, chunk.data(), chunk.size())) {
+        data.insert(data.end(), chunk.begin(), chunk.begin() + length);
+    }
+    return data;
+}
+
+static ExportedLog DecodeExport(const std::vector<uint8_t>& data) {
+    ExportedLog log;
+    TEST_ASSERT_GREATER_OR_EQUAL(6, data.size());
+    TEST_ASSERT_EQUAL_MEMORY("WLX1", data.data(), 4);
+    TEST_ASSERT_EQUAL_UINT8(ACTIVE_THERMISTORS, data[4]);
+    TEST_ASSERT_EQUAL_UINT8(ACTIVE_FANS, data[5]);
+
+    HistoryPoint previous = {};
+    size_t offset = 6;
+    while (offset < data.size()) {
+        const uint8_t tag = data[offset++];
+        if (tag == 0x01) {
+            ExportContext context;
+            TEST_ASSERT_TRUE(ReadVarint(data, offset, context.boot));
+            TEST_ASSERT_TRUE(ReadVarint(data, offset, context.epoch_offset));
+            TEST_ASSERT_TRUE(ReadVarint(data, offset, context.interval_s));
+            context.first_point = log.points.size();
+            log.contexts.push_back(context);
+            previous = HistoryPoint();
+            continue;
+        }
+        TEST_ASSERT_EQUAL_UINT8(0x02, tag);
+        TEST_ASSERT_FALSE(log.contexts.empty()); // Points always follow a context
+        HistoryPoint point = previous;
+        point.uptime_s += ReadZigzag(data, offset);
+        for (int t = 0; t < ACTIVE_THERMISTORS; t++) point.values.centi_celsius[t] += ReadZigzag(data, offset);
+        for (int f = 0; f < ACTIVE_FANS; f++) point.values.rpm[f] += ReadZigzag(data, offset);
+        for (int f = 0; f < ACTIVE_FANS; f++) point.values.duty[f] += ReadZigzag(data, offset);
+        log.points.push_back(point);
+        previous = point;
+    }
+    return log;
+}
+
+static void AssertPointEqual(const HistoryPoint& expected, const HistoryPoint& actual) {
+    TEST_ASSERT_EQUAL_UINT32(expected.uptime_s, actual.uptime_s);
+    for (int t = 0; t < ACTIVE_THERMISTORS; t++) TEST_ASSERT_EQUAL_INT16(expected.values.centi_celsius[t], actual.values.centi_celsius[t]);
+    for (int f = 0; f < ACTIVE_FANS; f++) {
+        TEST_ASSERT_EQUAL_UINT16(expected.values.rpm[f], actual.values.rpm[f]);
+        TEST_ASSERT_EQUAL_UINT8(expected.values.duty[f], actual.values.duty[f]);
+    }
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_export_round_trips_written_and_pending_points() {
+    const int samples = FIRST_BOOT_SAMPLES;
+    for (int sample = 0; sample < samples; sample++) {
+        RecordFlashLogSample(MakeState(sample));
+        ControllerState early = MakeState(sample);
+        early.timestamp_ms += 1000; // Inside FLASH_LOG_INTERVAL_S, dropped
+        RecordFlashLogSample(early);
+    }
+    const FlashLogStats stats = GetFlashLogStats();
+    TEST_ASSERT_EQUAL_UINT32(2, stats.batches_written);
+    TEST_ASSERT_EQUAL_UINT32(2 * FLASH_LOG_BATCH_BYTES, stats.bytes);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.raw_segments);
+
+    const ExportedLog log = DecodeExport(ReadExport(4096));
+    TEST_ASSERT_EQUAL_size_t(1, log.contexts.size());
+    TEST_ASSERT_EQUAL_UINT32(0, log.contexts[0].boot);
+    TEST_ASSERT_EQUAL_UINT32(HalEpochSeconds() - HalMillis() / 1000, log.contexts[0].epoch_offset);
+    TEST_ASSERT_EQUAL_UINT32(FLASH_LOG_INTERVAL_S, log.contexts[0].interval_s);
+    TEST_ASSERT_EQUAL_size_t(samples, log.points.size());
+    for (int sample = 0; sample < samples; sample++) {
+        AssertPointEqual(MakeHistoryPoint(MakeState(sample)), log.points[sample]);
+    }
+    TEST_ASSERT_EQUAL_INT16(INT16_MIN, log.points[3].values.centi_celsius[1]);
+}
+
+void test_export_is_the_same_whatever_the_chunk_size() {
+    const std::vector<uint8_t> whole = ReadExport(4096);
+    const size_t chunk_sizes[] = {1, 7, FLASH_LOG_EXPORT_MAX_ENTRY_BYTES};
+    for (size_t chunk_size : chunk_sizes) {
+        const std::vector<uint8_t> chunked = ReadExport(chunk_size);
+        TEST_ASSERT_EQUAL_size_t(whole.size(), chunked.size());
+        TEST_ASSERT_EQUAL_MEMORY(whole.data(), chunked.data(), whole.size());
+    }
+}
+
+void test_restart_continues_with_the_next_boot() {
+    FlushFlashLog(); // The partial batch goes to flash before the restart
+    TEST_ASSERT_EQUAL_UINT32(3, GetFlashLogStats().batches_written);
+
+    TEST_ASSERT_TRUE(StartFlashLog(s_LogDirectory));
+    TEST_ASSERT_EQUAL_UINT16(1, GetFlashLogStats().boot);
+    for (int sample = 0; sample < SECOND_BOOT_SAMPLES; sample++) RecordFlashLogSample(MakeState(sample)); // Uptime starts over
+
+    const ExportedLog log = DecodeExport(ReadExport(4096));
+    TEST_ASSERT_EQUAL_size_t(2, log.contexts.size());
+    TEST_ASSERT_EQUAL_UINT32(1, log.contexts[1].boot);
+    TEST_ASSERT_EQUAL_size_t(FIRST_BOOT_SAMPLES, log.contexts[1].first_point);
+    TEST_ASSERT_EQUAL_size_t(FIRST_BOOT_SAMPLES + SECOND_BOOT_SAMPLES, log.points.size());
+    AssertPointEqual(MakeHistoryPoint(MakeState(SECOND_BOOT_SAMPLES - 1)), log.points.back());
+}
+
+void test_corrupt_batch_is_skipped() {
+    char path[64];
+    snprintf(path, sizeof(path), "%s/r00000.bin", s_LogDirectory);
+    FILE* file = fopen(path, "r+b");
+    TEST_ASSERT_NOT_NULL(file);
+    fseek(file, 20, SEEK_SET); // Inside the first batch's points
+    const int byte = fgetc(file);
+    fseek(file, 20, SEEK_SET);
+    fputc(byte ^ 0x01, file);
+    fclose(file);
+
+    const uint32_t corrupt_before = GetFlashLogStats().corrupt_batches;
+    const ExportedLog log = DecodeExport(ReadExport(4096));
+    TEST_ASSERT_EQUAL_UINT32(corrupt_before + 1, GetFlashLogStats().corrupt_batches);
+    TEST_ASSERT_EQUAL_size_t(FIRST_BOOT_SAMPLES + SECOND_BOOT_SAMPLES - BATCH_POINTS, log.points.size());
+    AssertPointEqual(MakeHistoryPoint(MakeState(BATCH_POINTS)), log.points[0]);
+}
+
+int main() {
+    if (!mkdtemp(s_LogDirectory)) return 1;
+    if (!StartFlashLog(s_LogDirectory)) return 1;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_export_round_trips_written_and_pending_points);
+    RUN_TEST(test_export_is_the_same_whatever_the_chunk_size);
+    RUN_TEST(test_restart_continues_with_the_next_boot);
+    RUN_TEST(test_corrupt_batch_is_skipped);
+    const int failures = UNITY_END();
+
+    char command[64];
+    snprintf(command, sizeof(command), "rm -rf %s", s_LogDirectory);
+    if (system(command) != 0) return 1;
+    return failures;
+}
@@ -0,0 +1,173 @@
+// Trend history rings and the chunked /history JSON (history_manager.h),
+// parsed back with ArduinoJson and checked row by row.
+
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <string>
+#include "history_manager.h"
+
+static uint32_t s_NowSeconds = 0; // Uptime the next recorded point carries, only ever moves forward
+
+static ControllerState MakeState(unsigned long uptime_ms, double t1, unsigned long rpm) {
+    ControllerState state;
+    state.timestamp_ms = uptime_ms;
+    state.temperatures[0] = t1;
+    state.temperatures[1] = -127; // N/A
+    for (int i = 0; i < ACTIVE_FANS; i++) {
+        state.fans[i].rpm = rpm + i;
+        state.fans[i].current_duty = 100 + i;
+    }
+    return state;
+}
+
+// One point per second from s_NowSeconds on
+static void RecordSeconds(uint32_t seconds, double t1, unsigned long rpm) {
+    for (uint32_t i = 0; i < seconds; i++) RecordHistorySample(MakeState(1000UL * s_NowSeconds++, t1, rpm));
+}
+
+static std::string ReadHistory(HistoryTier tier, uint32_t seconds, size_t chunk_size) {
+    HistoryCursor cursor = OpenHistoryCursor(tier, seconds);
+    std::string json;
+    char chunk[4096];
+    size_t length;
+    while ((length = WriteHistoryChunk(cursor, chunk, chunk_size)) > 0) json.append(chunk, length);
+    return json;
+}
+
+void setUp() {
+    systemSettings.units = "C";
+}
+
+void tearDown() {
+}
+
+void test_raw_tier_keeps_one_point_per_interval() {
+    TEST_ASSERT_TRUE(HistoryAvailable());
+
+    // Control ticks every 100 ms, only the first of each second is kept
+    const uint32_t start_s = s_NowSeconds;
+    for (unsigned long ms = 0; ms < 10000; ms += 100) {
+        RecordHistorySample(MakeState(1000UL * start_s + ms, 31.2, 1200));
+    }
+    s_NowSeconds = start_s + 10;
+
+    const std::string json = ReadHistory(HistoryTier::Raw, 10, 4096);
+    JsonDocument document;
+    TEST_ASSERT_FALSE(deserializeJson(document, json));
+    const std::string tier = document["tier"].as<const char*>();
+    TEST_ASSERT_EQUAL_STRING("raw", tier.c_str());
+    TEST_ASSERT_EQUAL_UINT32(HISTORY_RAW_INTERVAL_S, document["interval_s"].as<uint32_t>());
+    TEST_ASSERT_EQUAL_INT(ACTIVE_FANS, document["fans"].as<int>());
+
+    JsonVariant points = document["points"];
+    TEST_ASSERT_EQUAL_size_t(10, points.size());
+    for (int row = 0; row < 10; row++) {
+        JsonVariant point = points[row];
+        TEST_ASSERT_EQUAL_size_t(1 + ACTIVE_THERMISTORS + 2 * ACTIVE_FANS, point.size());
+        TEST_ASSERT_EQUAL_UINT32(start_s + row, point[0].as<uint32_t>());
+        TEST_ASSERT_EQUAL_FLOAT(31.2f, point[1].as<float>());
+        TEST_ASSERT_TRUE(point[2].isNull()); // N/A temperature
+        TEST_ASSERT_EQUAL_UINT32(1200, point[1 + ACTIVE_THERMISTORS].as<uint32_t>());
+        TEST_ASSERT_EQUAL_UINT32(100 + ACTIVE_FANS - 1, point[ACTIVE_THERMISTORS + 2 * ACTIVE_FANS].as<uint32_t>());
+    }
+}
+
+void test_rollups_carry_min_avg_max_per_bucket() {
+    // Start on a 10 minute boundary so both rollup tiers see whole buckets
+    s_NowSeconds += HISTORY_WEEK_INTERVAL_S - s_NowSeconds % HISTORY_WEEK_INTERVAL_S;
+    const uint32_t start_s = s_NowSeconds;
+    for (uint32_t second = 0; second < 2 * HISTORY_DAY_INTERVAL_S; second++) {
+        RecordHistorySample(MakeState(1000UL * s_NowSeconds++, 30.0 + (second % 60) / 10.0, 1000 + second % 60));
+    }
+    RecordSeconds(1, 25.0, 500); // Closes the second minute
+
+    const std::string json = ReadHistory(HistoryTier::Day, 2 * HISTORY_DAY_INTERVAL_S, 4096);
+    JsonDocument document;
+    TEST_ASSERT_FALSE(deserializeJson(document, json));
+    JsonVariant points = document["points"];
+    TEST_ASSERT_EQUAL_size_t(2, points.size());
+    for (int row = 0; row < 2; row++) {
+        JsonVariant rollup = points[row];
+        TEST_ASSERT_EQUAL_UINT32(start_s + row * HISTORY_DAY_INTERVAL_S, rollup[0].as<uint32_t>());
+        JsonVariant minimum = rollup[1];
+        JsonVariant average = rollup[2];
+        JsonVariant maximum = rollup[3];
+        TEST_ASSERT_EQUAL_FLOAT(30.0f, minimum[0].as<float>());
+        TEST_ASSERT_EQUAL_FLOAT(35.9f, maximum[0].as<float>());
+        TEST_ASSERT_TRUE(average[1].isNull()); // No readings in the bucket
+        TEST_ASSERT_EQUAL_UINT32(1000, minimum[ACTIVE_THERMISTORS].as<uint32_t>());
+        TEST_ASSERT_EQUAL_UINT32(1030, average[ACTIVE_THERMISTORS].as<uint32_t>()); // 1029.5 rounded
+        TEST_ASSERT_EQUAL_UINT32(1059, maximum[ACTIVE_THERMISTORS].as<uint32_t>());
+    }
+
+    // Their week bucket is still open, the newest week rollup is the one before it
+    const std::string week = ReadHistory(HistoryTier::Week, HISTORY_WEEK_INTERVAL_S, 4096);
+    JsonDocument week_document;
+    TEST_ASSERT_FALSE(deserializeJson(week_document, week));
+    JsonVariant week_points = week_document["points"];
+    TEST_ASSERT_EQUAL_size_t(1, week_points.size());
+    TEST_ASSERT_EQUAL_UINT32(start_s - HISTORY_WEEK_INTERVAL_S, week_points[0][0].as<uint32_t>());
+}
+
+void test_small_chunks_stream_the_same_document() {
+    systemSettings.units = "F";
+    const std::string whole = ReadHistory(HistoryTier::Raw, 0, 4096);
+    const std::string sevens = ReadHistory(HistoryTier::Raw, 0, 7);
+    const std::string bytes = ReadHistory(HistoryTier::Raw, 0, 1);
+    TEST_ASSERT_EQUAL_STRING(whole.c_str(), sevens.c_str());
+    TEST_ASSERT_EQUAL_STRING(whole.c_str(), bytes.c_str());
+
+    JsonDocument document;
+    TEST_ASSERT_FALSE(deserializeJson(document, whole));
+    const std::string units = document["units"].as<const char*>();
+    TEST_ASSERT_EQUAL_STRING("F", units.c_str());
+    JsonVariant points = document["points"];
+    JsonVariant newest = points[points.size() - 1];
+    TEST_ASSERT_EQUAL_UINT32(0, points[0][0].as<uint32_t>());
+    TEST_ASSERT_EQUAL_UINT32(s_NowSeconds - 1, newest[0].as<uint32_t>());
+    TEST_ASSERT_EQUAL_FLOAT(77.0f, newest[1].as<float>()); // 25 C
+}
+
+void test_lapped_rows_are_skipped_not_torn() {
+    HistoryCursor cursor = OpenHistoryCursor(HistoryTier::Raw, 0);
+    std::string json;
+    char chunk[64];
+    json.append(chunk, WriteHistoryChunk(cursor, chunk, sizeof(chunk)));
+
+    // The writer laps every row the cursor has not reached yet
+    RecordSeconds(HISTORY_RAW_POINTS + 10, 40.0, 2000);
+    size_t length;
+    while ((length = WriteHistoryChunk(cursor, chunk, sizeof(chunk))) > 0) json.append(chunk, length);
+
+    JsonDocument document;
+    TEST_ASSERT_FALSE(deserializeJson(document, json));
+    JsonVariant points = document["points"];
+    TEST_ASSERT_TRUE(points.size() < 10); // Only what was already formatted
+    uint32_t previous = 0;
+    for (JsonVariant point : points.as<JsonArray>()) {
+        TEST_ASSERT_TRUE(point[0].as<uint32_t>() >= previous);
+        previous = point[0].as<uint32_t>();
+    }
+}
+
+void test_tier_names_round_trip() {
+    HistoryTier tier = HistoryTier::Raw;
+    TEST_ASSERT_TRUE(ParseHistoryTier("week", tier));
+    TEST_ASSERT_TRUE(tier == HistoryTier::Week);
+    const std::string name = HistoryTierName(HistoryTier::Day);
+    TEST_ASSERT_EQUAL_STRING("day", name.c_str());
+    TEST_ASSERT_FALSE(ParseHistoryTier("hour", tier));
+    TEST_ASSERT_TRUE(tier == HistoryTier::Week);
+}
+
+int main() {
+    StartHistory(); // Backed by the heap on the host
+
+    UNITY_BEGIN();
+    RUN_TEST(test_raw_tier_keeps_one_point_per_interval);
+    RUN_TEST(test_rollups_carry_min_avg_max_per_bucket);
+    RUN_TEST(test_small_chunks_stream_the_same_document);
+    RUN_TEST(test_lapped_rows_are_skipped_not_torn);
+    RUN_TEST(test_tier_names_round_trip);
+    return UNITY_END();
+}
@@ -0,0 +1,247 @@
+// Commands received on <mqtt_topic>/cmd and their acks (mqtt_command.h), and
+// the offline sample queue drained to <mqtt_topic>/backlog (mqtt_queue.h).
+
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <string.h>
+#include <string>
+#include "config_manager.h"
+#include "control_manager.h"
+#include "mqtt_command.h"
+#include "mqtt_queue.h"
+#include "hal.h"
+#include "hal_native.h"
+
+static JsonDocument s_Command;
+
+static const char* Apply(const char* json) {
+    s_Command.clear();
+    TEST_ASSERT_FALSE(deserializeJson(s_Command, json));
+    return ApplyMqttCommand(s_Command);
+}
+
+static int CountOf(const char* text, const char* needle) {
+    int count = 0;
+    for (const char* found = strstr(text, needle); found; found = strstr(found + 1, needle)) count++;
+    return count;
+}
+
+static ControllerState MakeState(unsigned long uptime_s) {
+    ControllerState state;
+    state.timestamp_ms = uptime_s * 1000;
+    state.temperatures[0] = 31.24;
+    state.temperatures[1] = -127;
+    for (int i = 0; i < ACTIVE_FANS; i++) state.fans[i].rpm = 1000 + i;
+    return state;
+}
+
+void setUp() {
+    systemSettings.units = "C";
+    espChipIdStr = "AA:BB:CC:DD:EE:FF";
+    UpdateControllerConfig([](ControllerConfig& config) {
+        for (auto& fan : config.fans) {
+            ApplyDefaultFanSettings(fan);
+            fan.duty_override = -1;
+        }
+        for (auto& led : config.leds) led = LedSettings();
+    });
+}
+
+void tearDown() {
+}
+
+void test_fan_duty_sets_and_clears_the_override() {
+    TEST_ASSERT_NULL(Apply("{\"cmd\":\"fan_duty\",\"fan\":1,\"duty\":200}"));
+    TEST_ASSERT_EQUAL_INT(200, ReadControllerConfig()->fans[FindFanIndex(1)].duty_override);
+    TEST_ASSERT_EQUAL_INT(-1, ReadControllerConfig()->fans[FindFanIndex(0)].duty_override);
+
+    TEST_ASSERT_NULL(Apply("{\"cmd\":\"fan_duty\",\"fan\":1,\"duty\":-1}"));
+    TEST_ASSERT_EQUAL_INT(-1, ReadControllerConfig()->fans[FindFanIndex(1)].duty_override);
+}
+
+void test_refused_commands_leave_the_config_untouched() {
+    const uint32_t generation = ControllerConfigGeneration();
+    TEST_ASSERT_EQUAL_STRING("duty must be an integer", Apply("{\"cmd\":\"fan_duty\",\"fan\":1}"));
+    TEST_ASSERT_EQUAL_STRING("unknown fan", Apply("{\"cmd\":\"fan_duty\",\"fan\":9,\"duty\":100}"));
+    TEST_ASSERT_EQUAL_STRING("unknown command", Apply("{\"cmd\":\"reboot\"}"));
+    TEST_ASSERT_EQUAL_STRING("unknown command", Apply("{}"));
+    TEST_ASSERT_EQUAL_UINT32(generation, ControllerConfigGeneration());
+    TEST_ASSERT_EQUAL_INT(-1, ReadControllerConfig()->fans[FindFanIndex(1)].duty_override);
+}
+
+void test_fan_duty_out_of_range_is_refused_before_narrowing() {
+    TEST_ASSERT_NULL(Apply("{\"cmd\":\"fan_duty\",\"fan\":1,\"duty\":120}"));
+    const uint32_t generation = ControllerConfigGeneration();
+
+    // 65536 and 65535 would wrap to 0 and -1 in the int16_t override
+    const char* const out_of_range[] = {"65536", "65535", "256", "-2"};
+    for (const char* duty : out_of_range) {
+        const std::string command = std::string("{\"cmd\":\"fan_duty\",\"fan\":1,\"duty\":") + duty + "}";
+        TEST_ASSERT_EQUAL_STRING("duty out of range", Apply(command.c_str()));
+    }
+    TEST_ASSERT_EQUAL_STRING("duty must be an integer", Apply("{\"cmd\":\"fan_duty\",\"fan\":1,\"duty\":2.5}"));
+    TEST_ASSERT_EQUAL_STRING("duty must be an integer", Apply("{\"cmd\":\"fan_duty\",\"fan\":1,\"duty\":\"x\"}"));
+    TEST_ASSERT_EQUAL_UINT32(generation, ControllerConfigGeneration());
+    TEST_ASSERT_EQUAL_INT(120, ReadControllerConfig()->fans[FindFanIndex(1)].duty_override);
+}
+
+void test_curve_point_replaces_and_appends() {
+    const int fan = FindFanIndex(2);
+    const size_t points = ReadControllerConfig()->fans[fan].fan_speed_curve.size();
+
+    TEST_ASSERT_NULL(Apply("{\"cmd\":\"curve_point\",\"fan\":2,\"index\":1,\"temp\":34,\"duty\":90}"));
+    const FanSpeedPoint replaced = ReadControllerConfig()->fans[fan].fan_speed_curve[1];
+    TEST_ASSERT_EQUAL_FLOAT(34, replaced.temperature_threshold);
+    TEST_ASSERT_EQUAL_INT(90, replaced.fan_duty_cycle);
+    TEST_ASSERT_EQUAL_FLOAT(90, EvaluateFanCurve(ReadControllerConfig()->curves.fans[fan], 34)); // Recompiled
+
+    char append[96];
+    snprintf(append, sizeof(append), "{\"cmd\":\"curve_point\",\"fan\":2,\"index\":%u,\"temp\":45,\"duty\":255}", (unsigned)points);
+    TEST_ASSERT_NULL(Apply(append));
+    TEST_ASSERT_EQUAL_size_t(points + 1, ReadControllerConfig()->fans[fan].fan_speed_curve.size());
+
+    snprintf(append, sizeof(append), "{\"cmd\":\"curve_point\",\"fan\":2,\"index\":%u,\"temp\":50,\"duty\":255}", (unsigned)points + 2);
+    TEST_ASSERT_EQUAL_STRING("curve point out of range", Apply(append));
+    TEST_ASSERT_EQUAL_STRING("curve point out of range", Apply("{\"cmd\":\"curve_point\",\"fan\":2,\"temp\":50,\"duty\":255}"));
+    TEST_ASSERT_EQUAL_STRING("rejected by validation", Apply("{\"cmd\":\"curve_point\",\"fan\":2,\"index\":0,\"duty\":255}"));
+    TEST_ASSERT_EQUAL_size_t(points + 1, ReadControllerConfig()->fans[fan].fan_speed_curve.size());
+}
+
+void test_led_mode_and_telemetry_interval() {
+    TEST_ASSERT_NULL(Apply("{\"cmd\":\"led_mode\",\"strip\":1,\"mode\":4}"));
+    TEST_ASSERT_EQUAL_UINT8(4, ReadControllerConfig()->leds[1].mode);
+    TEST_ASSERT_EQUAL_STRING("unknown LED strip", Apply("{\"cmd\":\"led_mode\",\"strip\":2,\"mode\":1}"));
+    TEST_ASSERT_EQUAL_STRING("missing LED mode", Apply("{\"cmd\":\"led_mode\",\"strip\":0}"));
+    TEST_ASSERT_EQUAL_STRING("rejected by validation", Apply("{\"cmd\":\"led_mode\",\"strip\":0,\"mode\":6}"));
+
+    TEST_ASSERT_NULL(Apply("{\"cmd\":\"telemetry_interval\",\"ms\":10000}"));
+    TEST_ASSERT_EQUAL_INT(10000, systemSettings.telemetry_interval);
+    TEST_ASSERT_EQUAL_STRING("interval below 1000 ms", Apply("{\"cmd\":\"telemetry_interval\",\"ms\":500}"));
+    TEST_ASSERT_EQUAL_INT(10000, systemSettings.telemetry_interval);
+}
+
+void test_ack_echoes_the_command_and_generation() {
+    char ack[MQTT_ACK_MAX_BYTES];
+    const char* error = Apply("{\"id\":\"7\",\"cmd\":\"fan_duty\",\"fan\":0,\"duty\":120}");
+    char expected[MQTT_ACK_MAX_BYTES];
+    snprintf(expected, sizeof(expected), "{\"id\":\"7\",\"cmd\":\"fan_duty\",\"status\":\"ok\",\"config_generation\":%u}",
+             (unsigned)ControllerConfigGeneration());
+    TEST_ASSERT_EQUAL_size_t(strlen(expected), WriteMqttCommandAck(ack, sizeof(ack), s_Command, error));
+    TEST_ASSERT_EQUAL_STRING(expected, ack);
+
+    error = Apply("{\"cmd\":\"led_mode\",\"strip\":5,\"mode\":1}");
+    snprintf(expected, sizeof(expected), "{\"id\":\"\",\"cmd\":\"led_mode\",\"status\":\"error\",\"error\":\"unknown LED strip\","
+             "\"config_generation\":%u}", (unsigned)ControllerConfigGeneration());
+    WriteMqttCommandAck(ack, sizeof(ack), s_Command, error);
+    TEST_ASSERT_EQUAL_STRING(expected, ack);
+
+    TEST_ASSERT_EQUAL_size_t(0, WriteMqttCommandAck(ack, 24, s_Command, error));
+}
+
+void test_queue_drains_in_batches_and_resends_until_committed() {
+    TEST_ASSERT_TRUE(StartMqttQueue());
+    const int samples = MQTT_QUEUE_BATCH_SAMPLES + 5;
+    for (int i = 0; i < samples; i++) QueueMqttSample(MakeState(100 + i));
+    TEST_ASSERT_EQUAL_UINT32(samples, MqttQueueDepth());
+
+    static char batch[MQTT_QUEUE_BATCH_MAX_BYTES];
+    static char again[MQTT_QUEUE_BATCH_MAX_BYTES];
+    uint32_t batch_end = 0;
+    TEST_ASSERT_GREATER_THAN(0, WriteMqttQueueBatch(batch, sizeof(batch), batch_end));
+    TEST_ASSERT_EQUAL_INT(MQTT_QUEUE_BATCH_SAMPLES, CountOf(batch, "\"uptime\":"));
+    TEST_ASSERT_NOT_NULL(strstr(batch, "{\"client_id\":\"AA:BB:CC:DD:EE:FF\",\"event\":\"backlog\",\"units\":\"C\",\"samples\":[{"));
+    TEST_ASSERT_NOT_NULL(strstr(batch, "\"uptime\":100,\"data\":{\"temperature1\":31.2,\"temperature2\":0,\"FAN_0\":1000,"));
+
+    uint32_t again_end = 0;
+    WriteMqttQueueBatch(again, sizeof(again), again_end); // Not committed, so the same samples again
+    TEST_ASSERT_EQUAL_STRING(batch, again);
+    TEST_ASSERT_EQUAL_UINT32(batch_end, again_end);
+
+    TEST_ASSERT_EQUAL_UINT32(MQTT_QUEUE_BATCH_SAMPLES, CommitMqttQueueBatch(batch_end));
+    WriteMqttQueueBatch(batch, sizeof(batch), batch_end);
+    TEST_ASSERT_EQUAL_INT(5, CountOf(batch, "\"uptime\":"));
+    TEST_ASSERT_NOT_NULL(strstr(batch, "\"uptime\":120,"));
+    TEST_ASSERT_EQUAL_UINT32(5, CommitMqttQueueBatch(batch_end));
+    TEST_ASSERT_EQUAL_size_t(0, WriteMqttQueueBatch(batch, sizeof(batch), batch_end));
+}
+
+void test_queue_batch_shrinks_to_fit_the_buffer() {
+    for (int i = 0; i < MQTT_QUEUE_BATCH_SAMPLES; i++) QueueMqttSample(MakeState(i));
+    char small[400];
+    uint32_t batch_end = 0;
+    const size_t length = WriteMqttQueueBatch(small, sizeof(small), batch_end);
+    TEST_ASSERT_GREATER_THAN(0, length);
+    const int written = CountOf(small, "\"uptime\":");
+    TEST_ASSERT_GREATER_THAN(0, written);
+    TEST_ASSERT_LESS_THAN(MQTT_QUEUE_BATCH_SAMPLES, written);
+    TEST_ASSERT_EQUAL_UINT32(written, CommitMqttQueueBatch(batch_end));
+    TEST_ASSERT_EQUAL_UINT32(MQTT_QUEUE_BATCH_SAMPLES - written, MqttQueueDepth());
+    while (WriteMqttQueueBatch(small, sizeof(small), batch_end) > 0) CommitMqttQueueBatch(batch_end);
+}
+
+void test_full_queue_drops_the_oldest() {
+    const uint32_t dropped = MqttQueueDroppedSamples();
+    for (int i = 0; i < MQTT_QUEUE_SAMPLES + 3; i++) QueueMqttSample(MakeState(i));
+    TEST_ASSERT_EQUAL_UINT32(MQTT_QUEUE_SAMPLES, MqttQueueDepth());
+    TEST_ASSERT_EQUAL_UINT32(dropped + 3, MqttQueueDroppedSamples());
+
+    static char batch[MQTT_QUEUE_BATCH_MAX_BYTES];
+    uint32_t batch_end = 0;
+    WriteMqttQueueBatch(batch, sizeof(batch), batch_end);
+    TEST_ASSERT_NOT_NULL(strstr(batch, "\"samples\":[{\"time\":1767225600,\"uptime\":3,"));
+
+    // Samples dropped while a batch is in flight are not counted twice
+    QueueMqttSample(MakeState(99999));
+    TEST_ASSERT_EQUAL_UINT32(MQTT_QUEUE_BATCH_SAMPLES - 1, CommitMqttQueueBatch(batch_end));
+}
+
+void test_samples_queued_before_ntp_replay_with_their_time() {
+    static char batch[MQTT_QUEUE_BATCH_MAX_BYTES];
+    uint32_t batch_end = 0;
+    while (WriteMqttQueueBatch(batch, sizeof(batch), batch_end) > 0) CommitMqttQueueBatch(batch_end);
+
+    // Offline from boot: no clock while the samples are taken, one a minute
+    HalSimReset(25.0);
+    HalSimSetClockSynced(false);
+    for (int i = 0; i < 5; i++) {
+        HalSimAdvance(60000);
+        QueueMqttSample(MakeState(HalMillis() / 1000));
+    }
+    TEST_ASSERT_EQUAL_size_t(5, MqttQueueDepth());
+    TEST_ASSERT_GREATER_THAN(0, WriteMqttQueueBatch(batch, sizeof(batch), batch_end));
+    TEST_ASSERT_EQUAL_INT(5, CountOf(batch, "\"time\":0,")); // Still unknown
+
+    HalSimAdvance(30000);
+    HalSimSetClockSynced(true);
+    const uint32_t now_epoch_s = HalEpochSeconds();
+    const uint32_t now_uptime_s = HalMillis() / 1000;
+    TEST_ASSERT_GREATER_THAN(0, WriteMqttQueueBatch(batch, sizeof(batch), batch_end));
+    JsonDocument document;
+    TEST_ASSERT_FALSE(deserializeJson(document, batch));
+    JsonVariant samples = document["samples"];
+    TEST_ASSERT_EQUAL_size_t(5, samples.size());
+    uint32_t previous = 0;
+    for (int i = 0; i < 5; i++) {
+        const uint32_t time = samples[i]["time"].as<uint32_t>();
+        const uint32_t uptime = samples[i]["uptime"].as<uint32_t>();
+        TEST_ASSERT_TRUE(time > previous);
+        TEST_ASSERT_EQUAL_UINT32(now_epoch_s - (now_uptime_s - uptime), time);
+        previous = time;
+    }
+    TEST_ASSERT_EQUAL_UINT32(5, CommitMqttQueueBatch(batch_end));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_fan_duty_sets_and_clears_the_override);
+    RUN_TEST(test_refused_commands_leave_the_config_untouched);
+    RUN_TEST(test_fan_duty_out_of_range_is_refused_before_narrowing);
+    RUN_TEST(test_curve_point_replaces_and_appends);
+    RUN_TEST(test_led_mode_and_telemetry_interval);
+    RUN_TEST(test_ack_echoes_the_command_and_generation);
+    RUN_TEST(test_queue_drains_in_batches_and_resends_until_committed);
+    RUN_TEST(test_queue_batch_shrinks_to_fit_the_buffer);
+    RUN_TEST(test_full_queue_drops_the_oldest);
+    RUN_TEST(test_samples_queued_before_ntp_replay_with_their_time);
+    return UNITY_END();
+}
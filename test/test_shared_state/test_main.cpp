@@ -0,0 +1,164 @@
+// Seqlock (seqlock.h) and RcuCell (rcu.h) under real threads: readers must
+// only ever see whole values, and a published RCU version must outlive every
+// guard still holding it.
+
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "rcu.h"
+#include "seqlock.h"
+
+// Every field derives from `version`, so a torn copy shows up as a mismatch
+struct Sample {
+    uint32_t version = 0;
+    uint32_t words[15] = {};
+
+    static Sample Make(uint32_t version) {
+        Sample sample;
+        sample.version = version;
+        for (uint32_t i = 0; i < 15; i++) sample.words[i] = version * 2654435761u + i;
+        return sample;
+    }
+
+    bool Consistent() const {
+        for (uint32_t i = 0; i < 15; i++) {
+            if (words[i] != version * 2654435761u + i) return false;
+        }
+        return true;
+    }
+};
+
+constexpr int READER_THREADS = 3;
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_seqlock_version_counts_writes() {
+    Seqlock<Sample> cell;
+    TEST_ASSERT_EQUAL_UINT32(0, cell.Version());
+    TEST_ASSERT_EQUAL_UINT32(0, cell.Read().version);
+    for (uint32_t i = 1; i <= 5; i++) {
+        cell.Write(Sample::Make(i));
+        TEST_ASSERT_EQUAL_UINT32(i, cell.Version());
+        TEST_ASSERT_EQUAL_UINT32(i, cell.Read().version);
+    }
+}
+
+void test_seqlock_readers_never_see_a_torn_value() {
+    Seqlock<Sample> cell;
+    cell.Write(Sample::Make(0));
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+    std::atomic<int> backwards{0};
+    std::atomic<long> reads{0};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < READER_THREADS; r++) {
+        readers.emplace_back([&] {
+            uint32_t last = 0;
+            while (!done.load()) {
+                const Sample sample = cell.Read();
+                if (!sample.Consistent()) torn++;
+                if (sample.version < last) backwards++; // One writer, so versions only grow
+                last = sample.version;
+                reads++;
+            }
+        });
+    }
+    for (uint32_t version = 1; version <= 200000; version++) cell.Write(Sample::Make(version));
+    done = true;
+    for (auto& reader : readers) reader.join();
+
+    TEST_ASSERT_EQUAL_INT(0, torn.load());
+    TEST_ASSERT_EQUAL_INT(0, backwards.load());
+    TEST_ASSERT_GREATER_THAN(0, reads.load());
+    TEST_ASSERT_EQUAL_UINT32(200000, cell.Read().version);
+}
+
+void test_rcu_publish_swaps_versions_and_counts_generations() {
+    RcuCell<Sample> cell;
+    TEST_ASSERT_EQUAL_UINT32(0, cell.Generation());
+    TEST_ASSERT_EQUAL_UINT32(0, cell.Read()->version);
+
+    cell.Publish(std::unique_ptr<Sample>(new Sample(Sample::Make(7))));
+    TEST_ASSERT_EQUAL_UINT32(1, cell.Generation());
+    TEST_ASSERT_EQUAL_UINT32(7, cell.Current().version);
+    const auto guard = cell.Read();
+    TEST_ASSERT_EQUAL_UINT32(7, guard->version);
+    TEST_ASSERT_TRUE((*guard).Consistent());
+}
+
+void test_rcu_publish_waits_for_the_guard_holding_the_old_version() {
+    RcuCell<Sample> cell(new Sample(Sample::Make(1)));
+    std::atomic<bool> published{false};
+    std::thread writer;
+    {
+        auto guard = cell.Read();
+        auto moved = std::move(guard); // Still one reader, handed over
+        writer = std::thread([&] {
+            cell.Publish(std::unique_ptr<Sample>(new Sample(Sample::Make(2))));
+            published = true;
+        });
+        while (cell.Generation() == 0) std::this_thread::yield();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        // Swapped for new readers, but the old version is still ours
+        TEST_ASSERT_FALSE(published.load());
+        TEST_ASSERT_EQUAL_UINT32(2, cell.Current().version);
+        TEST_ASSERT_EQUAL_UINT32(1, moved->version);
+        TEST_ASSERT_TRUE(moved->Consistent());
+    }
+    writer.join();
+    TEST_ASSERT_TRUE(published.load());
+    TEST_ASSERT_EQUAL_UINT32(2, cell.Read()->version);
+}
+
+void test_rcu_readers_see_whole_versions_while_a_writer_publishes() {
+    RcuCell<Sample> cell(new Sample(Sample::Make(0)));
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+    std::atomic<int> backwards{0};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < READER_THREADS; r++) {
+        readers.emplace_back([&] {
+            uint32_t last = 0;
+            while (!done.load()) {
+                {
+                    const auto guard = cell.Read();
+                    if (!guard->Consistent()) torn++; // A freed version would trip ASan here too
+                    if (guard->version < last) backwards++;
+                    last = guard->version;
+                }
+                std::this_thread::yield(); // Like the tasks, readers let go between reads so grace periods end
+            }
+        });
+    }
+    const uint32_t publishes = 5000;
+    for (uint32_t version = 1; version <= publishes; version++) {
+        cell.Publish(std::unique_ptr<Sample>(new Sample(Sample::Make(version))));
+    }
+    done = true;
+    for (auto& reader : readers) reader.join();
+
+    TEST_ASSERT_EQUAL_INT(0, torn.load());
+    TEST_ASSERT_EQUAL_INT(0, backwards.load());
+    TEST_ASSERT_EQUAL_UINT32(publishes, cell.Generation());
+    TEST_ASSERT_EQUAL_UINT32(publishes, cell.Read()->version);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_seqlock_version_counts_writes);
+    RUN_TEST(test_seqlock_readers_never_see_a_torn_value);
+    RUN_TEST(test_rcu_publish_swaps_versions_and_counts_generations);
+    RUN_TEST(test_rcu_publish_waits_for_the_guard_holding_the_old_version);
+    RUN_TEST(test_rcu_readers_see_whole_versions_while_a_writer_publishes);
+    return UNITY_END();
+}
@@ -0,0 +1,126 @@
+// Spike rejector, median and EMA stages of the per-channel filter chain
+// (signal_filter.h), each alone and chained.
+
+#include <unity.h>
+#include "signal_filter.h"
+
+static FilterSettings MakeSettings(uint8_t median_window, float ema_alpha, float spike_threshold) {
+    FilterSettings settings;
+    settings.median_window = median_window;
+    settings.ema_alpha = ema_alpha;
+    settings.spike_threshold = spike_threshold;
+    return settings;
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_disabled_stages_pass_values_through() {
+    const FilterSettings settings = MakeSettings(1, 1.0f, 0);
+    FilterState state;
+    const float values[] = {20.0f, 80.0f, -5.0f, 31.5f};
+    for (float value : values) TEST_ASSERT_EQUAL_FLOAT(value, ApplyFilter(settings, state, value));
+}
+
+void test_first_value_primes_the_chain() {
+    const FilterSettings settings = MakeSettings(5, 0.1f, 1.0f);
+    FilterState state;
+    TEST_ASSERT_EQUAL_FLOAT(42.0f, ApplyFilter(settings, state, 42.0f));
+    TEST_ASSERT_TRUE(state.primed);
+}
+
+void test_spike_is_held_then_accepted_as_a_real_step() {
+    const FilterSettings settings = MakeSettings(1, 1.0f, 2.0f);
+    FilterState state;
+    ApplyFilter(settings, state, 30.0f);
+    TEST_ASSERT_EQUAL_FLOAT(30.5f, ApplyFilter(settings, state, 30.5f)); // Within the threshold
+
+    for (int i = 0; i < FILTER_SPIKE_MAX_REJECTS; i++) {
+        TEST_ASSERT_EQUAL_FLOAT(30.5f, ApplyFilter(settings, state, 60.0f));
+    }
+    TEST_ASSERT_EQUAL_FLOAT(60.0f, ApplyFilter(settings, state, 60.0f));
+    TEST_ASSERT_EQUAL_FLOAT(60.5f, ApplyFilter(settings, state, 60.5f)); // Compared against the new level
+}
+
+void test_isolated_spike_never_reaches_the_output() {
+    const FilterSettings settings = MakeSettings(1, 1.0f, 2.0f);
+    FilterState state;
+    ApplyFilter(settings, state, 30.0f);
+    TEST_ASSERT_EQUAL_FLOAT(30.0f, ApplyFilter(settings, state, -127.0f));
+    TEST_ASSERT_EQUAL_FLOAT(30.1f, ApplyFilter(settings, state, 30.1f));
+    TEST_ASSERT_EQUAL_UINT8(0, state.rejected);
+}
+
+void test_median_removes_a_single_outlier() {
+    const FilterSettings settings = MakeSettings(3, 1.0f, 0);
+    FilterState state;
+    TEST_ASSERT_EQUAL_FLOAT(10.0f, ApplyFilter(settings, state, 10.0f));
+    TEST_ASSERT_EQUAL_FLOAT(11.0f, ApplyFilter(settings, state, 11.0f)); // Window of two, upper middle
+    TEST_ASSERT_EQUAL_FLOAT(11.0f, ApplyFilter(settings, state, 99.0f));
+    TEST_ASSERT_EQUAL_FLOAT(12.0f, ApplyFilter(settings, state, 12.0f));
+    TEST_ASSERT_EQUAL_FLOAT(13.0f, ApplyFilter(settings, state, 13.0f));
+}
+
+void test_median_window_wraps_the_ring_buffer() {
+    const FilterSettings settings = MakeSettings(FILTER_MAX_MEDIAN_WINDOW, 1.0f, 0);
+    FilterState state;
+    for (int i = 0; i < 3 * FILTER_MAX_MEDIAN_WINDOW; i++) {
+        const float output = ApplyFilter(settings, state, static_cast<float>(i));
+        const int window = i + 1 < FILTER_MAX_MEDIAN_WINDOW ? i + 1 : FILTER_MAX_MEDIAN_WINDOW;
+        TEST_ASSERT_EQUAL_FLOAT(static_cast<float>(i - (window - 1) / 2), output); // Median of a ramp lags by half a window
+    }
+}
+
+void test_ema_step_response_follows_alpha() {
+    const FilterSettings settings = MakeSettings(1, 0.5f, 0);
+    FilterState state;
+    ApplyFilter(settings, state, 0.0f);
+    const float expected[] = {50.0f, 75.0f, 87.5f, 93.75f};
+    for (float value : expected) TEST_ASSERT_FLOAT_WITHIN(1e-4f, value, ApplyFilter(settings, state, 100.0f));
+}
+
+void test_out_of_range_alpha_disables_the_ema() {
+    const FilterSettings settings = MakeSettings(1, 0.0f, 0);
+    FilterState state;
+    ApplyFilter(settings, state, 0.0f);
+    TEST_ASSERT_EQUAL_FLOAT(100.0f, ApplyFilter(settings, state, 100.0f));
+}
+
+void test_reset_starts_over_from_the_next_value() {
+    const FilterSettings settings = MakeSettings(3, 0.2f, 2.0f);
+    FilterState state;
+    for (int i = 0; i < 10; i++) ApplyFilter(settings, state, 25.0f);
+    ResetFilter(state);
+    TEST_ASSERT_FALSE(state.primed);
+    TEST_ASSERT_EQUAL_FLOAT(70.0f, ApplyFilter(settings, state, 70.0f)); // No spike check against the old level
+}
+
+void test_merge_picks_the_smoothest_settings() {
+    const FilterSettings merged = MergeFilterSettings(MakeSettings(3, 0.5f, 2.0f), MakeSettings(5, 0.8f, 4.0f));
+    TEST_ASSERT_EQUAL_UINT8(5, merged.median_window);
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, merged.ema_alpha);
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, merged.spike_threshold);
+
+    // A disabled spike rejector does not switch the other fan's off
+    TEST_ASSERT_EQUAL_FLOAT(4.0f, MergeFilterSettings(MakeSettings(1, 1.0f, 0), MakeSettings(1, 1.0f, 4.0f)).spike_threshold);
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, MergeFilterSettings(MakeSettings(1, 1.0f, 2.0f), MakeSettings(1, 1.0f, 0)).spike_threshold);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, MergeFilterSettings(MakeSettings(1, 1.0f, 0), MakeSettings(1, 1.0f, 0)).spike_threshold);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_disabled_stages_pass_values_through);
+    RUN_TEST(test_first_value_primes_the_chain);
+    RUN_TEST(test_spike_is_held_then_accepted_as_a_real_step);
+    RUN_TEST(test_isolated_spike_never_reaches_the_output);
+    RUN_TEST(test_median_removes_a_single_outlier);
+    RUN_TEST(test_median_window_wraps_the_ring_buffer);
+    RUN_TEST(test_ema_step_response_follows_alpha);
+    RUN_TEST(test_out_of_range_alpha_disables_the_ema);
+    RUN_TEST(test_reset_starts_over_from_the_next_value);
+    RUN_TEST(test_merge_picks_the_smoothest_settings);
+    return UNITY_END();
+}
@@ -0,0 +1,155 @@
+// The host HAL (hal_native.cpp) that the other suites and the simulator run
+// on: clock, PWM, thermistor counts and tach pulses derived from the plant, and
+// the temperature sampler reading them back.
+
+#include <unity.h>
+#include <string>
+#include "hal.h"
+#include "hal_native.h"
+#include "control_manager.h"
+#include "sensor_manager.h"
+
+constexpr int MAX_DUTY = (1 << PWM_RESOLUTION_BITS) - 1;
+
+static void SetAllFans(int duty) {
+    for (int i = 0; i < ACTIVE_FANS; i++) {
+        HalPwmWrite(i, duty);
+    }
+}
+
+void setUp() {
+    HalSimReset(25.0);
+}
+
+void tearDown() {
+}
+
+void test_clock_follows_simulated_time() {
+    TEST_ASSERT_EQUAL_UINT32(0, HalMillis());
+    HalSimAdvance(1500);
+    TEST_ASSERT_EQUAL_UINT32(1500, HalMillis());
+    TEST_ASSERT_EQUAL_UINT32(1500000, HalMicros());
+}
+
+void test_pwm_writes_reach_the_plant() {
+    HalPwmWrite(1, 200);
+    TEST_ASSERT_EQUAL_INT(200, HalSimPwmDuty(1));
+    TEST_ASSERT_EQUAL_INT(0, HalSimPwmDuty(0));
+
+    // Unknown fans are ignored rather than written past the table
+    HalPwmWrite(ACTIVE_FANS, 100);
+    HalPwmWrite(-1, 100);
+    TEST_ASSERT_EQUAL_INT(0, HalSimPwmDuty(ACTIVE_FANS));
+    TEST_ASSERT_EQUAL_INT(0, HalSimPwmDuty(-1));
+}
+
+void test_adc_conversion_needs_a_full_cycle_after_select() {
+    HalAdcSelectChannel(0);
+    TEST_ASSERT_FALSE(HalAdcConversionReady());
+    HalSimAdvance(ADC_CONVERSION_MS);
+    TEST_ASSERT_FALSE(HalAdcConversionReady());
+    HalSimAdvance(ADC_CONVERSION_MS);
+    TEST_ASSERT_TRUE(HalAdcConversionReady());
+
+    HalAdcSelectChannel(ACTIVE_THERMISTORS);
+    HalSimAdvance(2 * ADC_CONVERSION_MS);
+    TEST_ASSERT_TRUE(HalAdcReadLatest() < 0);
+}
+
+void test_sampler_reads_back_plant_temperature() {
+    HalSimSetHeatLoad(150.0);
+    StartTemperatureSampler();
+    TEST_ASSERT_FALSE(HasTemperatureSamples());
+    TEST_ASSERT_EQUAL_FLOAT(-1, ReadTemperature(0));
+
+    for (unsigned long ms = 0; ms < 10 * 60000UL; ms++) {
+        HalSimAdvance(1);
+        PollTemperatureSampler();
+    }
+    TEST_ASSERT_TRUE(HasTemperatureSamples());
+    for (int channel = 0; channel < ACTIVE_THERMISTORS; channel++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.2, HalSimTemperature(channel), ReadTemperature(channel));
+    }
+    TEST_ASSERT_EQUAL_FLOAT(-1, ReadTemperature(ACTIVE_THERMISTORS));
+
+    // Once the sampler stops, readers get N/A instead of an old value
+    HalSimAdvance(ADC_SAMPLE_STALE_MS + 1);
+    TEST_ASSERT_EQUAL_FLOAT(-1, ReadTemperature(0));
+}
+
+void test_fans_cool_the_loop() {
+    HalSimSetHeatLoad(150.0);
+    HalSimAdvance(10 * 60000UL);
+    const double stopped = HalSimTemperature(0);
+    TEST_ASSERT_TRUE(stopped > 25.0);
+    // The exhaust sensor sits between ambient and the coolant
+    TEST_ASSERT_TRUE(HalSimTemperature(1) > 25.0 && HalSimTemperature(1) < stopped);
+
+    HalSimReset(25.0);
+    SetAllFans(MAX_DUTY);
+    HalSimAdvance(10 * 60000UL);
+    TEST_ASSERT_TRUE(HalSimTemperature(0) < stopped);
+}
+
+// Reads every fan's RPM every 100 ms, the way the control tick polls them
+static void PollFanRpm(unsigned long ms, unsigned long rpm[ACTIVE_FANS]) {
+    for (unsigned long elapsed = 0; elapsed < ms; elapsed += 100) {
+        HalSimAdvance(100);
+        for (int i = 0; i < ACTIVE_FANS; i++) rpm[i] = ReadFanRpm(i);
+    }
+}
+
+void test_tach_pulses_give_duty_proportional_rpm() {
+    unsigned long rpm[ACTIVE_FANS];
+    HalPwmWrite(0, MAX_DUTY);
+    HalPwmWrite(1, MAX_DUTY / 2);
+    PollFanRpm(10000, rpm);
+
+    // Full duty spins fan 0 to 3000 RPM, half duty fan 1 to about 900
+    TEST_ASSERT_UINT32_WITHIN(60, 3000, rpm[0]);
+    TEST_ASSERT_UINT32_WITHIN(30, 1800 * (MAX_DUTY / 2) / MAX_DUTY, rpm[1]);
+    TEST_ASSERT_EQUAL_UINT32(0, rpm[2]);
+    TEST_ASSERT_EQUAL_UINT32(0, ReadFanRpm(ACTIVE_FANS));
+
+    // Averaging over the window keeps a steady fan's reading steady
+    unsigned long low = rpm[0], high = rpm[0];
+    for (int i = 0; i < 20; i++) {
+        PollFanRpm(100, rpm);
+        if (rpm[0] < low) low = rpm[0];
+        if (rpm[0] > high) high = rpm[0];
+    }
+    TEST_ASSERT_TRUE(high - low <= 10);
+
+    // A fan that stops reads 0 once no pulse arrived for the stuck threshold
+    HalPwmWrite(0, 0);
+    PollFanRpm(20000, rpm);
+    TEST_ASSERT_EQUAL_UINT32(0, rpm[0]);
+}
+
+void test_led_and_display_sinks_record_output() {
+    HalLedShow();
+    HalLedShow();
+    TEST_ASSERT_EQUAL_UINT32(2, HalSimLedFrames());
+
+    HalDisplayPrintf("FAN %d", 1);
+    HalDisplaySetCursor(0, 10);
+    HalDisplayPrintf("%s", "OK");
+    const std::string text = HalSimDisplayText();
+    TEST_ASSERT_EQUAL_STRING("FAN 1\nOK", text.c_str());
+
+    HalDisplayClear();
+    const std::string cleared = HalSimDisplayText();
+    TEST_ASSERT_EQUAL_STRING("", cleared.c_str());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_clock_follows_simulated_time);
+    RUN_TEST(test_pwm_writes_reach_the_plant);
+    RUN_TEST(test_adc_conversion_needs_a_full_cycle_after_select);
+    RUN_TEST(test_sampler_reads_back_plant_temperature);
+    RUN_TEST(test_fans_cool_the_loop);
+    RUN_TEST(test_tach_pulses_give_duty_proportional_rpm);
+    RUN_TEST(test_led_and_display_sinks_record_output);
+    return UNITY_END();
+}
@@ -0,0 +1,246 @@
+// Telemetry JSON (json_writer.h, telemetry_manager.h) against the ArduinoJson
+// document it replaced, on-change deltas, and the shared per-tick snapshots
+// (telemetry_cache.h).
+
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <string.h>
+#include <string>
+#include "json_writer.h"
+#include "telemetry_manager.h"
+#include "telemetry_cache.h"
+
+// The JsonDocument serializer WriteTelemetryPayload replaced, see native_main.cpp
+static std::string ReferenceTelemetryPayload(const ControllerState& state, const char* event) {
+    double t1 = state.temperatures[0];
+    double t2 = state.temperatures[1];
+    if (systemSettings.units == "F") {
+        if (t1 > -90.0) t1 = (t1 * 1.8) + 32;
+        if (t2 > -90.0) t2 = (t2 * 1.8) + 32;
+    }
+
+    JsonDocument payload;
+    payload["client_id"] = espChipIdStr.c_str();
+    payload["event"] = event;
+    payload["units"] = systemSettings.units.c_str();
+    JsonObject data = payload["data"].to<JsonObject>();
+    data["temperature1"] = (t1 > -90.0) ? String(t1, 1).toFloat() : 0.0f;
+    data["temperature2"] = (t2 > -90.0) ? String(t2, 1).toFloat() : 0.0f;
+    for (int i = 0; i < ACTIVE_FANS; ++i) {
+        data["FAN_" + std::to_string(a_FanIds[i])] = state.fans[i].rpm;
+    }
+
+    std::string buffer;
+    serializeJson(payload, buffer);
+    return buffer;
+}
+
+static ControllerState MakeState(double t1, double t2, unsigned long rpm) {
+    ControllerState state;
+    state.temperatures[0] = t1;
+    state.temperatures[1] = t2;
+    for (int i = 0; i < ACTIVE_FANS; i++) state.fans[i].rpm = rpm + 100 * i;
+    return state;
+}
+
+void setUp() {
+    systemSettings.units = "C";
+    espChipIdStr = "AA:BB:CC:DD:EE:FF";
+}
+
+void tearDown() {
+}
+
+void test_writer_escapes_strings_and_nests() {
+    char buffer[128];
+    JsonWriter writer(buffer, sizeof(buffer));
+    writer.BeginObject();
+    writer.Key("text");
+    writer.StringValue("quote \" slash \\ tab \t");
+    writer.IndexedKey("FAN_", 12);
+    writer.DecimalValue(-2.25, 1);
+    writer.Key("missing");
+    writer.DecimalValue(NAN, 1);
+    writer.Key("list");
+    writer.BeginArray();
+    writer.UnsignedValue(0);
+    writer.BeginObject();
+    writer.EndObject();
+    writer.EndArray();
+    writer.EndObject();
+    TEST_ASSERT_FALSE(writer.Overflowed());
+    TEST_ASSERT_EQUAL_size_t(strlen(buffer), writer.Length());
+    TEST_ASSERT_EQUAL_STRING("{\"text\":\"quote \\\" slash \\\\ tab \\u0009\",\"FAN_12\":-2.2,"
+                             "\"missing\":null,\"list\":[0,{}]}", buffer);
+
+    JsonDocument document;
+    TEST_ASSERT_FALSE(deserializeJson(document, buffer));
+    TEST_ASSERT_EQUAL_STRING("quote \" slash \\ tab \t", document["text"].as<const char*>());
+    TEST_ASSERT_EQUAL_FLOAT(-2.2f, document["FAN_12"].as<float>());
+    TEST_ASSERT_TRUE(document["missing"].isNull());
+}
+
+void test_writer_decimals_drop_trailing_zeros_and_round_like_printf() {
+    // Halfway cases round like printf("%.1f"): on the exact binary value, true ties to even
+    const double values[] = {0, 25, 25.04, 25.06, 0.05, -0.04, -12.5, 1234.0, 0.25, 0.75, 0.35, -19.65};
+    const char* const expected[] = {"0", "25", "25", "25.1", "0.1", "0", "-12.5", "1234", "0.2", "0.8", "0.3", "-19.6"};
+    for (int i = 0; i < 12; i++) {
+        char buffer[16];
+        JsonWriter writer(buffer, sizeof(buffer));
+        writer.DecimalValue(values[i], 1);
+        TEST_ASSERT_EQUAL_STRING(expected[i], buffer);
+    }
+}
+
+void test_writer_overflow_keeps_the_buffer_terminated() {
+    char buffer[8];
+    JsonWriter writer(buffer, sizeof(buffer));
+    writer.BeginObject();
+    writer.Key("longer_than_the_buffer");
+    TEST_ASSERT_TRUE(writer.Overflowed());
+    TEST_ASSERT_EQUAL_size_t(7, strlen(buffer));
+}
+
+void test_payload_matches_arduinojson_across_a_sweep() {
+    const char* const units[] = {"C", "F"};
+    for (const char* unit : units) {
+        systemSettings.units = unit;
+        for (int centi = -2000; centi <= 12000; centi += 7) {
+            const ControllerState state = MakeState(centi / 100.0, (centi % 300 == 0) ? -127 : 30 + centi / 1000.0, centi + 2000);
+            char payload[TELEMETRY_PAYLOAD_MAX_BYTES];
+            const size_t length = WriteTelemetryPayload(payload, sizeof(payload), state, "default");
+            const std::string expected = ReferenceTelemetryPayload(state, "default");
+            TEST_ASSERT_EQUAL_STRING(expected.c_str(), payload);
+            TEST_ASSERT_EQUAL_size_t(strlen(payload), length);
+        }
+    }
+}
+
+void test_payload_that_does_not_fit_is_dropped_whole() {
+    char payload[64];
+    TEST_ASSERT_EQUAL_size_t(0, WriteTelemetryPayload(payload, sizeof(payload), MakeState(30, 25, 1200), "default"));
+    TEST_ASSERT_EQUAL_STRING("", payload);
+}
+
+void test_changes_start_full_then_send_deltas_past_the_deadband() {
+    char payload[TELEMETRY_PAYLOAD_MAX_BYTES];
+    TelemetryBaseline baseline;
+    ControllerState state = MakeState(30.0, 25.0, 1000);
+    const std::string full = ReferenceTelemetryPayload(state, "full");
+    TEST_ASSERT_EQUAL_size_t(full.size(), WriteTelemetryChanges(payload, sizeof(payload), state, baseline));
+    TEST_ASSERT_EQUAL_STRING(full.c_str(), payload);
+
+    state.temperatures[0] = 30.05; // Inside TELEMETRY_DEADBAND_CELSIUS
+    state.fans[0].rpm = 1015;      // Inside TELEMETRY_DEADBAND_RPM_MIN
+    TEST_ASSERT_EQUAL_size_t(0, WriteTelemetryChanges(payload, sizeof(payload), state, baseline));
+
+    state.temperatures[0] = 30.1; // Drift adds up against the last value sent
+    state.fans[2].rpm = 1250;
+    TEST_ASSERT_GREATER_THAN(0, WriteTelemetryChanges(payload, sizeof(payload), state, baseline));
+    TEST_ASSERT_EQUAL_STRING("{\"client_id\":\"AA:BB:CC:DD:EE:FF\",\"event\":\"delta\",\"units\":\"C\","
+                             "\"data\":{\"temperature1\":30.1,\"FAN_2\":1250}}", payload);
+    TEST_ASSERT_EQUAL_size_t(0, WriteTelemetryChanges(payload, sizeof(payload), state, baseline));
+
+    state.temperatures[1] = -127; // Dropping out is a change whatever the deadband
+    TEST_ASSERT_GREATER_THAN(0, WriteTelemetryChanges(payload, sizeof(payload), state, baseline));
+    TEST_ASSERT_NOT_NULL(strstr(payload, "\"data\":{\"temperature2\":0}"));
+}
+
+void test_alarm_edges_send_the_full_payload() {
+    char payload[TELEMETRY_PAYLOAD_MAX_BYTES];
+    TelemetryBaseline baseline;
+    ControllerState state = MakeState(30.0, 25.0, 1000);
+    SetTelemetryBaseline(baseline, state);
+
+    state.rpm_alarm_firing = true;
+    const std::string threshold = ReferenceTelemetryPayload(state, "threshold");
+    TEST_ASSERT_EQUAL_size_t(threshold.size(), WriteTelemetryChanges(payload, sizeof(payload), state, baseline));
+    TEST_ASSERT_EQUAL_STRING(threshold.c_str(), payload);
+    TEST_ASSERT_EQUAL_size_t(0, WriteTelemetryChanges(payload, sizeof(payload), state, baseline));
+
+    state.rpm_alarm_firing = false; // Clearing is an edge too
+    TEST_ASSERT_GREATER_THAN(0, WriteTelemetryChanges(payload, sizeof(payload), state, baseline));
+    TEST_ASSERT_NOT_NULL(strstr(payload, "\"threshold\""));
+}
+
+void test_published_alarm_edges_are_counted_once() {
+    ControllerState state = MakeState(30.0, 25.0, 1000);
+    PublishControllerState(state);
+    const uint32_t edges = ControllerAlarmEdges();
+
+    state.temp_alarm_firing = true;
+    PublishControllerState(state);
+    PublishControllerState(state); // Still firing, not another edge
+    TEST_ASSERT_EQUAL_UINT32(edges + 1, ControllerAlarmEdges());
+
+    state.temp_alarm_firing = false;
+    state.rpm_alarm_firing = true; // Both alarms change in one tick
+    PublishControllerState(state);
+    TEST_ASSERT_EQUAL_UINT32(edges + 2, ControllerAlarmEdges());
+    state.rpm_alarm_firing = false;
+    PublishControllerState(state);
+    TEST_ASSERT_EQUAL_UINT32(edges + 3, ControllerAlarmEdges());
+}
+
+void test_snapshot_is_shared_within_a_tick() {
+    ControllerState state = MakeState(31.2, 24.9, 900);
+    state.timestamp_ms = 1000;
+    PublishControllerState(state);
+    const uint32_t built = TelemetrySnapshotsBuilt();
+    const std::shared_ptr<const TelemetrySnapshot> first = AcquireTelemetrySnapshot();
+    const std::shared_ptr<const TelemetrySnapshot> second = AcquireTelemetrySnapshot();
+    TEST_ASSERT_EQUAL_PTR(first.get(), second.get());
+    TEST_ASSERT_EQUAL_UINT32(built + 1, TelemetrySnapshotsBuilt());
+
+    const char* const events[TELEMETRY_SINK_COUNT] = {"usb_stream", "auto_mqtt", "manual_fetch", "web_push"};
+    for (int i = 0; i < TELEMETRY_SINK_COUNT; i++) {
+        const std::string expected = ReferenceTelemetryPayload(state, events[i]);
+        TEST_ASSERT_EQUAL_STRING(expected.c_str(), first->json[i]);
+        TEST_ASSERT_EQUAL_size_t(expected.size(), first->json_length[i]);
+    }
+}
+
+void test_snapshot_held_by_a_sink_outlives_newer_ticks() {
+    ControllerState state = MakeState(31.2, 24.9, 900);
+    state.timestamp_ms = 2000;
+    PublishControllerState(state);
+    const std::shared_ptr<const TelemetrySnapshot> held = AcquireTelemetrySnapshot();
+    const std::string held_json = held->Json(TelemetrySink::Push);
+
+    // Enough ticks to cycle the pool several times over, each one new
+    const TelemetrySnapshot* reused = nullptr;
+    for (int tick = 1; tick <= 4 * TELEMETRY_SNAPSHOT_POOL_SIZE; tick++) {
+        state.timestamp_ms += 100;
+        state.fans[0].rpm = 900 + tick;
+        PublishControllerState(state);
+        const std::shared_ptr<const TelemetrySnapshot> snapshot = AcquireTelemetrySnapshot();
+        TEST_ASSERT_TRUE(snapshot.get() != held.get());
+        TEST_ASSERT_EQUAL_UINT32(900 + tick, snapshot->state.fans[0].rpm);
+        if (tick == 2 * TELEMETRY_SNAPSHOT_POOL_SIZE) reused = snapshot.get();
+    }
+    TEST_ASSERT_EQUAL_STRING(held_json.c_str(), held->Json(TelemetrySink::Push));
+
+    // Released slots come back round instead of new ones being allocated
+    bool seen_again = false;
+    for (int tick = 0; tick < 2 * TELEMETRY_SNAPSHOT_POOL_SIZE; tick++) {
+        state.timestamp_ms += 100;
+        PublishControllerState(state);
+        seen_again = seen_again || AcquireTelemetrySnapshot().get() == reused;
+    }
+    TEST_ASSERT_TRUE(seen_again);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_writer_escapes_strings_and_nests);
+    RUN_TEST(test_writer_decimals_drop_trailing_zeros_and_round_like_printf);
+    RUN_TEST(test_writer_overflow_keeps_the_buffer_terminated);
+    RUN_TEST(test_payload_matches_arduinojson_across_a_sweep);
+    RUN_TEST(test_payload_that_does_not_fit_is_dropped_whole);
+    RUN_TEST(test_changes_start_full_then_send_deltas_past_the_deadband);
+    RUN_TEST(test_alarm_edges_send_the_full_payload);
+    RUN_TEST(test_published_alarm_edges_are_counted_once);
+    RUN_TEST(test_snapshot_is_shared_within_a_tick);
+    RUN_TEST(test_snapshot_held_by_a_sink_outlives_newer_ticks);
+    return UNITY_END();
+}
@@ -0,0 +1,84 @@
+// ADS1115 counts to Celsius through the compile-time lookup table
+// (thermistor_table.h), checked against the B-parameter formula it replaces.
+
+#include <unity.h>
+#include <math.h>
+#include "sensor_manager.h"
+#include "thermistor_table.h"
+
+// The float formula the sampler evaluated per reading before the table existed
+static double ReferenceCelsius(int16_t adc_raw) {
+    const double voltage = adc_raw * ADC_FULL_SCALE_VOLTAGE / ADC_MAX_COUNTS;
+    const double resistance = T_REFERENCE_RESISTANCE * (voltage / (ADC_VOLTAGE - voltage));
+    const double inverse_kelvin = 1.0 / (T_NOMINAL_TEMPERATURE + 273.15) + log(resistance / T_NOMINAL_RESISTANCE) / T_B_VALUE;
+    return 1.0 / inverse_kelvin - 273.15;
+}
+
+// Raw count the divider produces at a temperature, the inverse of ReferenceCelsius
+static int16_t RawAt(double celsius) {
+    const double resistance = T_NOMINAL_RESISTANCE * exp(T_B_VALUE * (1.0 / (celsius + 273.15) - 1.0 / (T_NOMINAL_TEMPERATURE + 273.15)));
+    const double voltage = ADC_VOLTAGE * resistance / (T_REFERENCE_RESISTANCE + resistance);
+    return static_cast<int16_t>(voltage * ADC_MAX_COUNTS / ADC_FULL_SCALE_VOLTAGE);
+}
+
+static double MaxErrorBetween(int channel, double low_celsius, double high_celsius) {
+    double max_error = 0;
+    // Higher temperature, lower resistance, fewer counts
+    for (int16_t raw = RawAt(high_celsius); raw <= RawAt(low_celsius); raw++) {
+        max_error = fmax(max_error, fabs(ConvertAdcToCelsius(channel, raw) - ReferenceCelsius(raw)));
+    }
+    return max_error;
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_table_matches_formula_over_coolant_range() {
+    for (int channel = 0; channel < ACTIVE_THERMISTORS; channel++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.01, 0, MaxErrorBetween(channel, 0, 100));
+    }
+}
+
+void test_table_stays_close_beyond_coolant_range() {
+    for (int channel = 0; channel < ACTIVE_THERMISTORS; channel++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.02, 0, MaxErrorBetween(channel, -20, 120));
+    }
+}
+
+void test_nominal_point_reads_nominal_temperature() {
+    // Equal resistors put the divider at half of ADC_VOLTAGE
+    const int16_t raw = static_cast<int16_t>(ADC_VOLTAGE / 2 / ADC_FULL_SCALE_VOLTAGE * ADC_MAX_COUNTS);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, T_NOMINAL_TEMPERATURE, ConvertAdcToCelsius(0, raw));
+}
+
+void test_conversion_falls_monotonically_with_counts() {
+    for (int channel = 0; channel < ACTIVE_THERMISTORS; channel++) {
+        double previous = ConvertAdcToCelsius(channel, 0);
+        for (int16_t raw = 1; raw <= THERMISTOR_TABLE_MAX_RAW; raw++) {
+            const double celsius = ConvertAdcToCelsius(channel, raw);
+            TEST_ASSERT_TRUE(celsius <= previous);
+            previous = celsius;
+        }
+    }
+}
+
+void test_out_of_range_input_is_clamped_or_rejected() {
+    TEST_ASSERT_EQUAL_FLOAT(-1, ConvertAdcToCelsius(0, -1));
+    TEST_ASSERT_EQUAL_FLOAT(-1, ConvertAdcToCelsius(ACTIVE_THERMISTORS, RawAt(25)));
+    // An open thermistor saturates at the end of the table instead of reading past it
+    TEST_ASSERT_TRUE(ConvertAdcToCelsius(0, THERMISTOR_TABLE_MAX_RAW) == ConvertAdcToCelsius(0, INT16_MAX));
+    TEST_ASSERT_TRUE(ConvertAdcToCelsius(0, 0) <= THERMISTOR_TABLE_MAX_MILLICELSIUS / 1000.0);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_table_matches_formula_over_coolant_range);
+    RUN_TEST(test_table_stays_close_beyond_coolant_range);
+    RUN_TEST(test_nominal_point_reads_nominal_temperature);
+    RUN_TEST(test_conversion_falls_monotonically_with_counts);
+    RUN_TEST(test_out_of_range_input_is_clamped_or_rejected);
+    return UNITY_END();
+}
@@ -0,0 +1,242 @@
+// COBS/CRC framing of the binary USB telemetry (usb_protocol.h) and the
+// sample stream ring (usb_stream.h): frames are decoded here the way
+// usb-cdc-daemon does and checked field by field.
+
+#include <unity.h>
+#include <string.h>
+#include "usb_protocol.h"
+#include "usb_stream.h"
+
+// Inverse of CobsEncode for one frame without its delimiter; 0 on a malformed frame
+static size_t CobsDecode(const uint8_t* input, size_t length, uint8_t* output, size_t output_size) {
+    size_t read = 0;
+    size_t written = 0;
+    while (read < length) {
+        const uint8_t code = input[read++];
+        if (code == 0 || read + code - 1 > length) return 0;
+        for (int i = 1; i < code; i++) {
+            if (written == output_size) return 0;
+            output[written++] = input[read++];
+        }
+        if (code < 0xFF && read < length) {
+            if (written == output_size) return 0;
+            output[written++] = 0;
+        }
+    }
+    return written;
+}
+
+// Strips the delimiter, decodes and checks the CRC; returns the record length without CRC, 0 if invalid
+static size_t DecodeFrame(const uint8_t* frame, size_t length, uint8_t* record, size_t record_size) {
+    if (length < 2 || frame[length - 1] != 0x00) return 0;
+    const size_t decoded = CobsDecode(frame, length - 1, record, record_size);
+    if (decoded < 4) return 0;
+    const uint16_t crc = record[decoded - 2] | (record[decoded - 1] << 8);
+    return Crc16Ccitt(record, decoded - 2) == crc ? decoded - 2 : 0;
+}
+
+static uint16_t U16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t U32(const uint8_t* p) {
+    return U16(p) | (static_cast<uint32_t>(U16(p + 2)) << 16);
+}
+
+static ControllerState MakeState() {
+    ControllerState state;
+    state.timestamp_ms = 0x01020304;
+    state.temperatures[0] = 34.56;
+    state.temperatures[1] = -127; // N/A, anything at or below -90
+    for (int i = 0; i < ACTIVE_FANS; i++) {
+        state.fans[i].rpm = 1000 + i * 250;
+        state.fans[i].current_duty = 60 + i;
+    }
+    state.rpm_alarm_firing = true;
+    return state;
+}
+
+void setUp() {
+    systemSettings.units = "C";
+    espChipIdStr = "AA:BB:CC:DD:EE:FF";
+}
+
+void tearDown() {
+}
+
+void test_crc16_matches_ccitt_false_check_value() {
+    const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    TEST_ASSERT_EQUAL_HEX16(0x29B1, Crc16Ccitt(check, sizeof(check)));
+    TEST_ASSERT_EQUAL_HEX16(0xFFFF, Crc16Ccitt(check, 0));
+}
+
+void test_cobs_round_trips_zeros_and_long_runs() {
+    uint8_t input[600];
+    uint8_t encoded[620];
+    uint8_t decoded[600];
+    const size_t lengths[] = {1, 2, 253, 254, 255, 300, 600};
+    for (size_t length : lengths) {
+        for (size_t i = 0; i < length; i++) input[i] = (i % 97 == 5) ? 0 : static_cast<uint8_t>(i * 7 + 1);
+        const size_t encoded_length = CobsEncode(input, length, encoded, sizeof(encoded));
+        TEST_ASSERT_GREATER_THAN(length, encoded_length);
+        TEST_ASSERT_LESS_OR_EQUAL(length + 1 + length / 254 + 1, encoded_length);
+        TEST_ASSERT_NULL(memchr(encoded, 0, encoded_length)); // The delimiter never appears inside a frame
+        TEST_ASSERT_EQUAL_size_t(length, CobsDecode(encoded, encoded_length, decoded, sizeof(decoded)));
+        TEST_ASSERT_EQUAL_MEMORY(input, decoded, length);
+    }
+
+    const uint8_t zeros[3] = {0, 0, 0};
+    const uint8_t expected[4] = {0x01, 0x01, 0x01, 0x01};
+    TEST_ASSERT_EQUAL_size_t(4, CobsEncode(zeros, sizeof(zeros), encoded, sizeof(encoded)));
+    TEST_ASSERT_EQUAL_MEMORY(expected, encoded, sizeof(expected));
+}
+
+void test_cobs_reports_a_short_output_buffer() {
+    uint8_t input[32];
+    uint8_t encoded[32];
+    memset(input, 0x55, sizeof(input));
+    TEST_ASSERT_EQUAL_size_t(0, CobsEncode(input, sizeof(input), encoded, sizeof(input)));
+}
+
+void test_telemetry_frame_round_trips() {
+    uint8_t frame[USB_FRAME_MAX_BYTES];
+    uint8_t record[USB_FRAME_MAX_BYTES];
+    const size_t length = WriteUsbTelemetryFrame(frame, sizeof(frame), MakeState(), 0xBEEF);
+    TEST_ASSERT_GREATER_THAN(0, length);
+    TEST_ASSERT_NULL(memchr(frame, 0, length - 1));
+
+    const size_t record_length = DecodeFrame(frame, length, record, sizeof(record));
+    TEST_ASSERT_EQUAL_size_t(2 + 4 + 2 + 1 + 2 * ACTIVE_THERMISTORS + 3 * ACTIVE_FANS, record_length);
+    TEST_ASSERT_EQUAL_UINT8(USB_PROTOCOL_VERSION, record[0]);
+    TEST_ASSERT_EQUAL_UINT8(static_cast<uint8_t>(UsbRecordType::Telemetry), record[1]);
+    TEST_ASSERT_EQUAL_UINT32(0x01020304, U32(record + 2));
+    TEST_ASSERT_EQUAL_UINT16(0xBEEF, U16(record + 6));
+    TEST_ASSERT_EQUAL_UINT8(0x02, record[8]); // RPM alarm only, Celsius
+    TEST_ASSERT_EQUAL_INT16(3456, static_cast<int16_t>(U16(record + 9)));
+    TEST_ASSERT_EQUAL_INT16(INT16_MIN, static_cast<int16_t>(U16(record + 11)));
+    const uint8_t* fans = record + 9 + 2 * ACTIVE_THERMISTORS;
+    for (int i = 0; i < ACTIVE_FANS; i++) {
+        TEST_ASSERT_EQUAL_UINT16(1000 + i * 250, U16(fans + 3 * i));
+        TEST_ASSERT_EQUAL_UINT8(60 + i, fans[3 * i + 2]);
+    }
+}
+
+void test_corrupted_and_truncated_frames_are_rejected() {
+    uint8_t frame[USB_FRAME_MAX_BYTES];
+    uint8_t record[USB_FRAME_MAX_BYTES];
+    const size_t length = WriteUsbTelemetryFrame(frame, sizeof(frame), MakeState(), 7);
+    TEST_ASSERT_GREATER_THAN(0, DecodeFrame(frame, length, record, sizeof(record)));
+
+    for (size_t i = 0; i + 1 < length; i++) {
+        uint8_t corrupted[USB_FRAME_MAX_BYTES];
+        memcpy(corrupted, frame, length);
+        corrupted[i] ^= 0x10; // Any single flipped bit fails COBS or the CRC
+        TEST_ASSERT_EQUAL_size_t(0, DecodeFrame(corrupted, length, record, sizeof(record)));
+    }
+    uint8_t truncated[USB_FRAME_MAX_BYTES];
+    memcpy(truncated, frame, length - 4);
+    truncated[length - 5] = 0x00;
+    TEST_ASSERT_EQUAL_size_t(0, DecodeFrame(truncated, length - 4, record, sizeof(record)));
+}
+
+void test_hello_frame_carries_counts_and_client_id() {
+    uint8_t frame[USB_FRAME_MAX_BYTES];
+    uint8_t record[USB_FRAME_MAX_BYTES];
+    const size_t record_length = DecodeFrame(frame, WriteUsbHelloFrame(frame, sizeof(frame)), record, sizeof(record));
+    TEST_ASSERT_EQUAL_size_t(5 + 17, record_length);
+    TEST_ASSERT_EQUAL_UINT8(static_cast<uint8_t>(UsbRecordType::Hello), record[1]);
+    TEST_ASSERT_EQUAL_UINT8(ACTIVE_THERMISTORS, record[2]);
+    TEST_ASSERT_EQUAL_UINT8(ACTIVE_FANS, record[3]);
+    TEST_ASSERT_EQUAL_UINT8(17, record[4]);
+    TEST_ASSERT_EQUAL_MEMORY("AA:BB:CC:DD:EE:FF", record + 5, 17);
+}
+
+void test_stream_frame_round_trips_a_batch() {
+    UsbStreamSample samples[USB_STREAM_BATCH_SAMPLES];
+    for (int s = 0; s < USB_STREAM_BATCH_SAMPLES; s++) {
+        samples[s].timestamp_us = 100000u * s;
+        for (int i = 0; i < ACTIVE_THERMISTORS; i++) samples[s].centi_celsius[i] = static_cast<int16_t>(2500 + s - i);
+        for (int i = 0; i < ACTIVE_FANS; i++) {
+            samples[s].tach_pulses[i] = static_cast<uint16_t>(65530 + s); // Wraps inside the batch
+            samples[s].duty[i] = static_cast<uint8_t>(s * 10);
+        }
+    }
+    uint8_t frame[USB_STREAM_FRAME_MAX_BYTES];
+    uint8_t record[USB_STREAM_FRAME_MAX_BYTES];
+    const size_t length = WriteUsbStreamFrame(frame, sizeof(frame), samples, USB_STREAM_BATCH_SAMPLES, 40, 3);
+    const size_t sample_bytes = 4 + 2 * ACTIVE_THERMISTORS + 3 * ACTIVE_FANS;
+    TEST_ASSERT_EQUAL_size_t(7 + USB_STREAM_BATCH_SAMPLES * sample_bytes, DecodeFrame(frame, length, record, sizeof(record)));
+    TEST_ASSERT_EQUAL_UINT16(40, U16(record + 2));
+    TEST_ASSERT_EQUAL_UINT16(3, U16(record + 4));
+    TEST_ASSERT_EQUAL_UINT8(USB_STREAM_BATCH_SAMPLES, record[6]);
+    const uint8_t* last = record + 7 + (USB_STREAM_BATCH_SAMPLES - 1) * sample_bytes;
+    TEST_ASSERT_EQUAL_UINT32(samples[USB_STREAM_BATCH_SAMPLES - 1].timestamp_us, U32(last));
+    TEST_ASSERT_EQUAL_UINT16(samples[USB_STREAM_BATCH_SAMPLES - 1].tach_pulses[0], U16(last + 4 + 2 * ACTIVE_THERMISTORS));
+
+    TEST_ASSERT_EQUAL_size_t(0, WriteUsbStreamFrame(frame, 16, samples, USB_STREAM_BATCH_SAMPLES, 40, 3));
+}
+
+void test_stream_ring_drops_when_full_and_reports_it() {
+    TEST_ASSERT_FALSE(SetUsbStreamRate(30)); // 33.3 ms period
+    TEST_ASSERT_FALSE(SetUsbStreamRate(USB_STREAM_MAX_RATE_HZ * 2));
+    TEST_ASSERT_TRUE(SetUsbStreamRate(40));
+    TEST_ASSERT_EQUAL_UINT32(25, UsbStreamPeriodMs());
+
+    const uint32_t dropped_before = UsbStreamDroppedSamples();
+    for (int i = 0; i < USB_STREAM_RING_SAMPLES + 3; i++) CaptureUsbStreamSample();
+    TEST_ASSERT_EQUAL_UINT32(dropped_before + 3, UsbStreamDroppedSamples());
+
+    // Drain in small writes, the way the USB task sees a busy port
+    static uint8_t buffer[1024];
+    uint8_t record[USB_STREAM_FRAME_MAX_BYTES];
+    int samples = 0;
+    int frames = 0;
+    size_t written;
+    while ((written = WriteUsbStreamFrames(buffer, sizeof(buffer))) > 0) {
+        size_t start = 0;
+        for (size_t i = 0; i < written; i++) {
+            if (buffer[i] != 0x00) continue;
+            const size_t record_length = DecodeFrame(buffer + start, i + 1 - start, record, sizeof(record));
+            TEST_ASSERT_GREATER_THAN(0, record_length);
+            TEST_ASSERT_EQUAL_UINT16(frames == 0 ? 3 : 0, U16(record + 4)); // Drops are reported once
+            samples += record[6];
+            frames++;
+            start = i + 1;
+        }
+        TEST_ASSERT_EQUAL_size_t(written, start); // Only whole frames are written
+    }
+    TEST_ASSERT_EQUAL_INT(USB_STREAM_RING_SAMPLES, samples);
+
+    TEST_ASSERT_TRUE(SetUsbStreamRate(0));
+    TEST_ASSERT_EQUAL_UINT32(CONTROL_LOOP_INTERVAL_MS, UsbStreamPeriodMs());
+    CaptureUsbStreamSample();
+    TEST_ASSERT_EQUAL_size_t(0, WriteUsbStreamFrames(buffer, sizeof(buffer)));
+}
+
+void test_commands_switch_mode_and_stream_rate() {
+    TEST_ASSERT_TRUE(ParseUsbCommand("MODE BIN 1", UsbTelemetryMode::Json) == UsbTelemetryMode::Binary);
+    TEST_ASSERT_TRUE(ParseUsbCommand("MODE BIN 9", UsbTelemetryMode::Binary) == UsbTelemetryMode::Json);
+    TEST_ASSERT_TRUE(ParseUsbCommand("MODE JSON", UsbTelemetryMode::Binary) == UsbTelemetryMode::Json);
+    TEST_ASSERT_TRUE(ParseUsbCommand("HELLO", UsbTelemetryMode::Binary) == UsbTelemetryMode::Binary);
+
+    uint16_t rate = 0;
+    TEST_ASSERT_TRUE(ParseUsbStreamCommand("STREAM 50", rate));
+    TEST_ASSERT_EQUAL_UINT16(50, rate);
+    TEST_ASSERT_FALSE(ParseUsbStreamCommand("STREAM", rate));
+    TEST_ASSERT_FALSE(ParseUsbStreamCommand("STREAM 5x", rate));
+    TEST_ASSERT_FALSE(ParseUsbStreamCommand("STREAM -1", rate));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_crc16_matches_ccitt_false_check_value);
+    RUN_TEST(test_cobs_round_trips_zeros_and_long_runs);
+    RUN_TEST(test_cobs_reports_a_short_output_buffer);
+    RUN_TEST(test_telemetry_frame_round_trips);
+    RUN_TEST(test_corrupted_and_truncated_frames_are_rejected);
+    RUN_TEST(test_hello_frame_carries_counts_and_client_id);
+    RUN_TEST(test_stream_frame_round_trips_a_batch);
+    RUN_TEST(test_stream_ring_drops_when_full_and_reports_it);
+    RUN_TEST(test_commands_switch_mode_and_stream_rate);
+    return UNITY_END();
+}
@@ -0,0 +1,137 @@
+package main
+
+import (
+	"bytes"
+	"encoding/binary"
+	"encoding/csv"
+	"errors"
+	"fmt"
+	"io"
+	"math"
+	"strconv"
+	"time"
+)
+
+// Flash log export from /export-log, see src/flash_log_manager.h:
+//
+//	"WLX1" | thermistors u8 | fans u8 | entries...
+//
+// Each entry is a tag byte and LEB128 varints. A context (boot, epoch offset,
+// interval) resets the delta base; every point holds zigzag deltas of uptime
+// and each value against the previous point.
+const (
+	logExportMagic = "WLX1"
+	logTagContext  = 0x01
+	logTagPoint    = 0x02
+)
+
+// LogPoint is one decoded flash log point. Time is wall clock when the device
+// clock was set at the time, otherwise the zero time plus uptime.
+type LogPoint struct {
+	Boot         uint16
+	Uptime       uint32
+	Time         time.Time
+	ClockSet     bool
+	IntervalS    uint32
+	Temperatures []float64 // Celsius, NaN when absent
+	RPM          []uint16
+	Duty         []uint8
+}
+
+// DecodeLogExport decodes a complete export.
+func DecodeLogExport(data []byte) ([]LogPoint, error) {
+	if len(data) < len(logExportMagic)+2 || string(data[:len(logExportMagic)]) != logExportMagic {
+		return nil, errors.New("not a flash log export")
+	}
+	thermistors := int(data[4])
+	fans := int(data[5])
+	r := bytes.NewReader(data[6:])
+
+	var points []LogPoint
+	var boot uint16
+	var epochOffset, interval uint32
+	hasContext := false
+	var uptime uint32
+	values := make([]int32, thermistors+2*fans)
+
+	for {
+		tag, err := r.ReadByte()
+		if err == io.EOF {
+			return points, nil
+		}
+		switch tag {
+		case logTagContext:
+			fields := make([]uint64, 3)
+			for i := range fields {
+				if fields[i], err = binary.ReadUvarint(r); err != nil {
+					return points, fmt.Errorf("truncated context: %w", err)
+				}
+			}
+			boot, epochOffset, interval = uint16(fields[0]), uint32(fields[1]), uint32(fields[2])
+			hasContext = true
+			uptime = 0
+			for i := range values {
+				values[i] = 0
+			}
+		case logTagPoint:
+			if !hasContext {
+				return points, errors.New("point before context")
+			}
+			delta, err := binary.ReadVarint(r)
+			if err != nil {
+				return points, fmt.Errorf("truncated point: %w", err)
+			}
+			uptime = uint32(int64(uptime) + delta)
+			for i := range values {
+				if delta, err = binary.ReadVarint(r); err != nil {
+					return points, fmt.Errorf("truncated point: %w", err)
+				}
+				values[i] += int32(delta)
+			}
+			p := LogPoint{Boot: boot, Uptime: uptime, ClockSet: epochOffset != 0, IntervalS: interval}
+			p.Time = time.Unix(int64(epochOffset)+int64(uptime), 0).UTC()
+			for i := 0; i < thermistors; i++ {
+				if values[i] == math.MinInt16 {
+					p.Temperatures = append(p.Temperatures, math.NaN())
+				} else {
+					p.Temperatures = append(p.Temperatures, float64(values[i])/100)
+				}
+			}
+			for i := 0; i < fans; i++ {
+				p.RPM = append(p.RPM, uint16(values[thermistors+i]))
+				p.Duty = append(p.Duty, uint8(values[thermistors+fans+i]))
+			}
+			points = append(points, p)
+		default:
+			return points, fmt.Errorf("unknown entry tag %#x", tag)
+		}
+	}
+}
+
+// WriteLogCSV writes decoded points as CSV with a header row.
+func WriteLogCSV(w io.Writer, points []LogPoint) error {
+	out := csv.NewWriter(w)
+	if len(points) > 0 {
+		header := []string{"time", "clock_set", "boot", "uptime_s", "interval_s"}
+		for i := range points[0].Temperatures {
+			header = append(header, fmt.Sprintf("temperature%d", i+1))
+		}
+		for i := range points[0].RPM {
+			header = append(header, fmt.Sprintf("fan%d_rpm", i), fmt.Sprintf("fan%d_duty", i))
+		}
+		out.Write(header)
+	}
+	for _, p := range points {
+		row := []string{p.Time.Format(time.RFC3339), strconv.FormatBool(p.ClockSet), strconv.Itoa(int(p.Boot)),
+			strconv.FormatUint(uint64(p.Uptime), 10), strconv.FormatUint(uint64(p.IntervalS), 10)}
+		for _, t := range p.Temperatures {
+			row = append(row, strconv.FormatFloat(t, 'f', 2, 64))
+		}
+		for i := range p.RPM {
+			row = append(row, strconv.Itoa(int(p.RPM[i])), strconv.Itoa(int(p.Duty[i])))
+		}
+		out.Write(row)
+	}
+	out.Flush()
+	return out.Error()
+}
@@ -1,11 +1,15 @@
 package main
 
 import (
+	"bytes"
+	"encoding/csv"
 	"encoding/json"
+	"flag"
 	"fmt"
 	"log"
 	"os"
 	"os/signal"
+	"strconv"
 	"strings"
 	"syscall"
 	"time"
@@ -47,6 +51,32 @@ type sensorRegistryInfo struct {
 
 var mStatus *systray.MenuItem // Global variable for the status menu item
 
+var jsonOnly = flag.Bool("json", false, "Keep the device on JSON telemetry instead of negotiating binary frames")
+var streamRate = flag.Int("stream", 0, "Request high-rate samples at this rate in Hz (10, 20, 25, 40, 50 or 100), binary mode only")
+var streamCSV = flag.String("stream-csv", "", "Append streamed samples to this CSV file")
+var decodeLog = flag.String("decode-log", "", "Print a flash log export (from /export-log) as CSV and exit")
+
+// writeStreamBatch appends one row per sample: timestamp, sequence, temperatures, tach pulses, duties.
+func writeStreamBatch(w *csv.Writer, batch StreamBatch) {
+	if batch.Dropped > 0 {
+		log.Printf("Device dropped %d stream samples", batch.Dropped)
+	}
+	if w == nil {
+		return
+	}
+	for _, s := range batch.Samples {
+		row := []string{strconv.FormatUint(uint64(s.TimestampUs), 10), strconv.Itoa(int(s.Sequence))}
+		for _, t := range s.Temperatures {
+			row = append(row, strconv.FormatFloat(t, 'f', 2, 64))
+		}
+		for i := range s.TachPulses {
+			row = append(row, strconv.Itoa(int(s.TachPulses[i])), strconv.Itoa(int(s.FanDuty[i])))
+		}
+		w.Write(row)
+	}
+	w.Flush()
+}
+
 // getTempUnit determines the unit for temperature sensors.
 func getTempUnit(td TelemetryData) string {
 	if td.Units != "" {
@@ -57,6 +87,21 @@ func getTempUnit(td TelemetryData) string {
 }
 
 func main() {
+	flag.Parse()
+	if *decodeLog != "" {
+		data, err := os.ReadFile(*decodeLog)
+		if err != nil {
+			log.Fatalf("Error reading %s: %v", *decodeLog, err)
+		}
+		points, err := DecodeLogExport(data)
+		if err != nil {
+			log.Printf("Export decoded up to an error: %v", err)
+		}
+		if err := WriteLogCSV(os.Stdout, points); err != nil {
+			log.Fatalf("Error writing CSV: %v", err)
+		}
+		return
+	}
 	c := make(chan os.Signal, 1)
 	signal.Notify(c, os.Interrupt, syscall.SIGTERM)
 	go func() {
@@ -106,6 +151,16 @@ func startTelemetryMonitor() {
 	var staleRetries int = 0
 	// var err error
 
+	var streamWriter *csv.Writer
+	if *streamCSV != "" {
+		file, err := os.OpenFile(*streamCSV, os.O_APPEND|os.O_CREATE|os.O_WRONLY, 0644)
+		if err != nil {
+			log.Fatalf("Error opening stream CSV %s: %v", *streamCSV, err)
+		}
+		defer file.Close()
+		streamWriter = csv.NewWriter(file)
+	}
+
 OUTER:
 	for {
 		// Find the COM port
@@ -135,6 +190,23 @@ OUTER:
 
 		reader := make([]byte, 4096)
 		var jsonBuffer []byte // Buffer to accumulate partial JSON messages
+		decoder := &FrameDecoder{}
+		binaryMode := false
+
+		if !*jsonOnly {
+			// Older firmware ignores this and keeps sending JSON lines
+			command := BinaryModeCommand
+			if *streamRate > 0 {
+				command += StreamCommand(*streamRate)
+			}
+			if _, err := port.Write([]byte(command)); err != nil {
+				log.Printf("Error requesting binary telemetry on %s: %v", portName, err)
+			}
+			decoder.OnStream = func(batch StreamBatch) {
+				staleRetries = 0
+				writeStreamBatch(streamWriter, batch)
+			}
+		}
 
 		for {
 			n, err := port.Read(reader)
@@ -165,7 +237,25 @@ OUTER:
 				}
 			}
 
-			jsonBuffer = append(jsonBuffer, reader[:n]...)
+			chunk := reader[:n]
+			if !binaryMode {
+				if i := bytes.IndexByte(chunk, 0); i >= 0 {
+					// The device switched: the delimiter ends its last JSON line
+					log.Printf("Binary telemetry on %s", portName)
+					binaryMode = true
+					jsonBuffer = jsonBuffer[:0]
+					chunk = chunk[i:]
+				}
+			}
+			if binaryMode {
+				decoder.Feed(chunk, func(record TelemetryRecord) {
+					staleRetries = 0
+					go updateRegistry(decoder.ToTelemetryData(record))
+				})
+				continue
+			}
+
+			jsonBuffer = append(jsonBuffer, chunk...)
 
 			// Try to find a complete JSON object
 			for {
@@ -246,6 +336,11 @@ func processTelemetry(jsonStr string) {
 		log.Printf("Error unmarshalling JSON: %v, JSON: %s", err, jsonStr)
 		return
 	}
+	updateRegistry(telemetry)
+}
+
+// updateRegistry publishes one telemetry sample to the HWiNFO custom sensors.
+func updateRegistry(telemetry TelemetryData) {
 
 	// Define sensor configurations
 	sensorInfos := []sensorRegistryInfo{
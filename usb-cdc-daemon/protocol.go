@@ -0,0 +1,285 @@
+package main
+
+import (
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"math"
+)
+
+// Binary telemetry framing, see src/usb_protocol.h in the firmware:
+//
+//	COBS( version u8 | type u8 | record ... | crc16 u16 ) 0x00
+//
+// The daemon asks for it with BinaryModeCommand right after opening the port.
+// Firmware without binary support ignores the line and keeps sending JSON.
+// StreamCommand then turns on high-rate sample batches.
+const (
+	ProtocolVersion   = 1
+	BinaryModeCommand = "MODE BIN 1\n"
+
+	recordHello     = 1
+	recordTelemetry = 2
+	recordStream    = 3
+
+	maxFrameBytes  = 256 // Anything longer without a delimiter is noise
+	tempNotPresent = math.MinInt16
+)
+
+// TelemetryRecord is one control-loop sample. Temperatures are Celsius, NaN when absent.
+type TelemetryRecord struct {
+	TimestampMs  uint32
+	Sequence     uint16
+	TempAlarm    bool
+	RPMAlarm     bool
+	Fahrenheit   bool
+	Temperatures []float64
+	FanRPM       []uint16
+	FanDuty      []uint8
+}
+
+// StreamSample is one high-rate sample. Tach pulses are free-running counters
+// that wrap at 16 bits; difference two samples for an RPM.
+type StreamSample struct {
+	TimestampUs  uint32
+	Sequence     uint16
+	Temperatures []float64
+	TachPulses   []uint16
+	FanDuty      []uint8
+}
+
+// StreamBatch is the content of one stream frame. Dropped counts samples the
+// device discarded because the host fell behind, since the previous batch.
+type StreamBatch struct {
+	Dropped uint16
+	Samples []StreamSample
+}
+
+// StreamCommand asks the device for stream samples at rateHz, 0 stops them.
+func StreamCommand(rateHz int) string {
+	return fmt.Sprintf("STREAM %d\n", rateHz)
+}
+
+// FrameDecoder turns a byte stream into records. It keeps no more than one
+// partial frame and drops anything that fails COBS, CRC or version checks,
+// so a reader that starts mid-frame or loses bytes recovers at the next 0x00.
+type FrameDecoder struct {
+	pending     []byte
+	overflowed  bool
+	thermistors int
+	fans        int
+	clientID    string
+
+	// OnStream, when set, receives every stream batch; otherwise they are skipped.
+	OnStream func(StreamBatch)
+
+	Frames  uint64
+	Dropped uint64
+}
+
+// Feed consumes bytes and calls onTelemetry for every complete, valid telemetry record.
+func (d *FrameDecoder) Feed(data []byte, onTelemetry func(TelemetryRecord)) {
+	for _, b := range data {
+		if b != 0 {
+			if len(d.pending) < maxFrameBytes {
+				d.pending = append(d.pending, b)
+			} else {
+				d.overflowed = true
+			}
+			continue
+		}
+		if len(d.pending) > 0 || d.overflowed {
+			if err := d.handleFrame(d.pending, onTelemetry); err != nil {
+				d.Dropped++
+			} else {
+				d.Frames++
+			}
+		}
+		d.pending = d.pending[:0]
+		d.overflowed = false
+	}
+}
+
+func (d *FrameDecoder) handleFrame(encoded []byte, onTelemetry func(TelemetryRecord)) error {
+	if d.overflowed {
+		return errors.New("frame too long")
+	}
+	frame, err := cobsDecode(encoded)
+	if err != nil {
+		return err
+	}
+	if len(frame) < 4 {
+		return errors.New("frame too short")
+	}
+	body := frame[:len(frame)-2]
+	if crc16CCITT(body) != binary.LittleEndian.Uint16(frame[len(frame)-2:]) {
+		return errors.New("bad CRC")
+	}
+	if body[0] != ProtocolVersion {
+		return fmt.Errorf("unsupported version %d", body[0])
+	}
+
+	switch body[1] {
+	case recordHello:
+		return d.parseHello(body[2:])
+	case recordTelemetry:
+		record, err := d.parseTelemetry(body[2:])
+		if err != nil {
+			return err
+		}
+		onTelemetry(record)
+		return nil
+	case recordStream:
+		batch, err := d.parseStream(body[2:])
+		if err != nil {
+			return err
+		}
+		if d.OnStream != nil {
+			d.OnStream(batch)
+		}
+		return nil
+	default:
+		return nil // Newer record types are skipped, not errors
+	}
+}
+
+func (d *FrameDecoder) parseHello(p []byte) error {
+	if len(p) < 3 || len(p) < 3+int(p[2]) {
+		return errors.New("short hello")
+	}
+	d.thermistors = int(p[0])
+	d.fans = int(p[1])
+	d.clientID = string(p[3 : 3+int(p[2])])
+	return nil
+}
+
+func (d *FrameDecoder) parseTelemetry(p []byte) (TelemetryRecord, error) {
+	if d.thermistors == 0 && d.fans == 0 {
+		return TelemetryRecord{}, errors.New("telemetry before hello")
+	}
+	if len(p) < 7+2*d.thermistors+3*d.fans {
+		return TelemetryRecord{}, errors.New("short telemetry")
+	}
+	r := TelemetryRecord{
+		TimestampMs: binary.LittleEndian.Uint32(p[0:]),
+		Sequence:    binary.LittleEndian.Uint16(p[4:]),
+		TempAlarm:   p[6]&0x01 != 0,
+		RPMAlarm:    p[6]&0x02 != 0,
+		Fahrenheit:  p[6]&0x04 != 0,
+	}
+	offset := 7
+	for i := 0; i < d.thermistors; i++ {
+		centi := int16(binary.LittleEndian.Uint16(p[offset:]))
+		if centi == tempNotPresent {
+			r.Temperatures = append(r.Temperatures, math.NaN())
+		} else {
+			r.Temperatures = append(r.Temperatures, float64(centi)/100)
+		}
+		offset += 2
+	}
+	for i := 0; i < d.fans; i++ {
+		r.FanRPM = append(r.FanRPM, binary.LittleEndian.Uint16(p[offset:]))
+		r.FanDuty = append(r.FanDuty, p[offset+2])
+		offset += 3
+	}
+	return r, nil
+}
+
+func (d *FrameDecoder) parseStream(p []byte) (StreamBatch, error) {
+	if d.thermistors == 0 && d.fans == 0 {
+		return StreamBatch{}, errors.New("stream before hello")
+	}
+	if len(p) < 5 {
+		return StreamBatch{}, errors.New("short stream header")
+	}
+	first := binary.LittleEndian.Uint16(p[0:])
+	batch := StreamBatch{Dropped: binary.LittleEndian.Uint16(p[2:])}
+	count := int(p[4])
+	sampleBytes := 4 + 2*d.thermistors + 3*d.fans
+	if len(p) < 5+count*sampleBytes {
+		return StreamBatch{}, errors.New("short stream batch")
+	}
+	offset := 5
+	for s := 0; s < count; s++ {
+		sample := StreamSample{
+			TimestampUs: binary.LittleEndian.Uint32(p[offset:]),
+			Sequence:    first + uint16(s),
+		}
+		offset += 4
+		for i := 0; i < d.thermistors; i++ {
+			centi := int16(binary.LittleEndian.Uint16(p[offset:]))
+			if centi == tempNotPresent {
+				sample.Temperatures = append(sample.Temperatures, math.NaN())
+			} else {
+				sample.Temperatures = append(sample.Temperatures, float64(centi)/100)
+			}
+			offset += 2
+		}
+		for i := 0; i < d.fans; i++ {
+			sample.TachPulses = append(sample.TachPulses, binary.LittleEndian.Uint16(p[offset:]))
+			sample.FanDuty = append(sample.FanDuty, p[offset+2])
+			offset += 3
+		}
+		batch.Samples = append(batch.Samples, sample)
+	}
+	return batch, nil
+}
+
+// ToTelemetryData maps a binary record onto the JSON schema processTelemetry already understands.
+func (d *FrameDecoder) ToTelemetryData(r TelemetryRecord) TelemetryData {
+	td := TelemetryData{ClientID: d.clientID, Event: "usb_binary", Units: "C"}
+	temperature := func(i int) float64 {
+		if i >= len(r.Temperatures) || math.IsNaN(r.Temperatures[i]) {
+			return 0
+		}
+		if r.Fahrenheit {
+			return r.Temperatures[i]*1.8 + 32
+		}
+		return r.Temperatures[i]
+	}
+	if r.Fahrenheit {
+		td.Units = "F"
+	}
+	td.Data.Temperature1 = temperature(0)
+	td.Data.Temperature2 = temperature(1)
+	rpm := func(i int) uint {
+		if i >= len(r.FanRPM) {
+			return 0
+		}
+		return uint(r.FanRPM[i])
+	}
+	td.Data.FAN0, td.Data.FAN1, td.Data.FAN2, td.Data.FAN3 = rpm(0), rpm(1), rpm(2), rpm(3)
+	return td
+}
+
+func cobsDecode(encoded []byte) ([]byte, error) {
+	out := make([]byte, 0, len(encoded))
+	for i := 0; i < len(encoded); {
+		code := int(encoded[i])
+		if code == 0 || i+code > len(encoded) {
+			return nil, errors.New("bad COBS block")
+		}
+		out = append(out, encoded[i+1:i+code]...)
+		i += code
+		if code < 0xFF && i < len(encoded) {
+			out = append(out, 0)
+		}
+	}
+	return out, nil
+}
+
+// crc16CCITT is CRC-16/CCITT-FALSE: poly 0x1021, init 0xFFFF, no reflection.
+func crc16CCITT(data []byte) uint16 {
+	crc := uint16(0xFFFF)
+	for _, b := range data {
+		crc ^= uint16(b) << 8
+		for bit := 0; bit < 8; bit++ {
+			if crc&0x8000 != 0 {
+				crc = crc<<1 ^ 0x1021
+			} else {
+				crc <<= 1
+			}
+		}
+	}
+	return crc
+}